@@ -0,0 +1,81 @@
+#ifndef __VST_BENCHMARK_H__
+#define __VST_BENCHMARK_H__
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace bench {
+
+struct Benchmark {
+  char const* name;
+  void (*fn)();
+};
+
+inline std::vector<Benchmark>& getBenchmarks() {
+  static std::vector<Benchmark> benchmarks;
+  return benchmarks;
+}
+
+struct Registration {
+  Registration(char const* const name, void (*const fn)()) {
+    getBenchmarks().push_back({name, fn});
+  }
+};
+
+/**
+ * Bytes and calls requested from the global operator new, see main.cpp. They
+ * are atomic as the concurrent benchmarks allocate from several threads.
+ */
+extern std::atomic<std::size_t> allocated_bytes;
+extern std::atomic<std::size_t> allocations;
+
+/** Prevents the compiler from discarding a computed value */
+template <class ValueType>
+inline void keep(ValueType const& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+/** Returns the wall-clock seconds taken by fn() */
+template <class Fn>
+double time(Fn const& fn) {
+  auto const start = std::chrono::steady_clock::now();
+  fn();
+  std::chrono::duration<double> const elapsed =
+    std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+inline void report(char const* const label, double const value, char const* const unit) {
+  std::printf("  %-48s %14.2f %s\n", label, value, unit);
+}
+
+/**
+ * Runs every registered benchmark whose name contains one of the arguments,
+ * or all of them when there are no arguments.
+ */
+inline int run(int const argc, char** const argv) {
+  for (Benchmark const& benchmark : getBenchmarks()) {
+    bool selected = argc < 2;
+    for (int i = 1; i < argc && !selected; ++i) {
+      selected = std::strstr(benchmark.name, argv[i]) != nullptr;
+    }
+    if (selected) {
+      std::printf("%s\n", benchmark.name);
+      benchmark.fn();
+    }
+  }
+  return 0;
+}
+
+}
+
+#define BENCHMARK(name) \
+  static void name(); \
+  static ::bench::Registration name##_registration(#name, name); \
+  static void name()
+
+#endif
@@ -0,0 +1,52 @@
+#include <cstdlib>
+#include <new>
+
+#include "benchmark.h"
+
+// GCC pairs std::free with the inlined replacement of operator new below
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+std::atomic<std::size_t> bench::allocated_bytes{0};
+std::atomic<std::size_t> bench::allocations{0};
+
+void* operator new(std::size_t const size) {
+  bench::allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  bench::allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* const pointer = std::malloc(size)) return pointer;
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t const size, std::align_val_t const alignment) {
+  bench::allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+  bench::allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* const pointer = std::aligned_alloc(std::size_t(alignment), size)) return pointer;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* const pointer, std::align_val_t) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* const pointer) noexcept {
+  std::free(pointer);
+}
+
+void operator delete(void* const pointer, std::size_t) noexcept {
+  std::free(pointer);
+}
+
+#include "vst/inline_values_bench.cpp"
+#include "vst/compact_avl_node_bench.cpp"
+#include "vst/avl_tree_bench.cpp"
+#include "vst/compare_bench.cpp"
+#include "vst/nearest_neighbor_iterator_bench.cpp"
+#include "vst/pipeline_bench.cpp"
+#include "vst/block_tree_bench.cpp"
+#include "vst/key_search_bench.cpp"
+#include "vst/frozen_tree_bench.cpp"
+#include "vst/concurrent_avl_tree_bench.cpp"
+#include "vst/optimistic_avl_tree_bench.cpp"
+
+int main(int argc, char **argv) {
+  return bench::run(argc, argv);
+}
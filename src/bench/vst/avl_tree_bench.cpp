@@ -0,0 +1,385 @@
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "../benchmark.h"
+#include "../../vst/aggregate.h"
+#include "../../vst/aggregate_avl_tree.h"
+#include "../../vst/avl_node.h"
+#include "../../vst/avl_tree.h"
+#include "../../vst/compare.h"
+#include "../../vst/inline_values.h"
+#include "../../vst/node_allocator.h"
+#include "../../vst/ranked_avl_tree.h"
+
+using namespace vst;
+
+BENCHMARK(AvlTreeBuildFromSorted) {
+  typedef AvlNode<long, long, InlineValues<long>> NodeType;
+  typedef AvlTree<long, long, NodeType, ThreeWayCompare<long>,
+                  PoolNodeAllocator<NodeType, 65536>> TreeType;
+
+  std::vector<std::pair<long,long>> pairs(5000000);
+  for (std::size_t i = 0; i < pairs.size(); ++i) {
+    pairs[i] = std::make_pair(long(3 * i), long(i));
+  }
+
+  {
+    TreeType tree;
+    bench::report("insert (sorted keys)", 1e9 * bench::time([&]() {
+      for (auto const& pair : pairs) {
+        tree.insert(pair.first, pair.second);
+      }
+    }) / pairs.size(), "ns/key");
+  }
+
+  {
+    TreeType tree;
+    bench::report("buildFromSorted", 1e9 * bench::time([&]() {
+      tree.buildFromSorted(pairs.begin(), pairs.end());
+    }) / pairs.size(), "ns/key");
+  }
+}
+
+BENCHMARK(AvlTreeInsertBatch) {
+  typedef AvlNode<long, long, InlineValues<long>> NodeType;
+  typedef AvlTree<long, long, NodeType, ThreeWayCompare<long>,
+                  PoolNodeAllocator<NodeType, 65536>> TreeType;
+
+  std::vector<std::pair<long,long>> pairs(1000000);
+  for (std::size_t i = 0; i < pairs.size(); ++i) {
+    pairs[i] = std::make_pair(long(1000 * i), long(i));
+  }
+
+  // batches of 2000 updates that land in 4 hot regions of the key space
+  std::mt19937 random(42);
+  std::vector<std::vector<std::pair<long,long>>> batches(200);
+  for (auto& batch : batches) {
+    long const regions[] = {
+      long(random() % 1000000000), long(random() % 1000000000),
+      long(random() % 1000000000), long(random() % 1000000000)
+    };
+    for (int i = 0; i < 2000; ++i) {
+      batch.emplace_back(regions[i % 4] + long(random() % 100000), i);
+    }
+  }
+  std::size_t const updates = batches.size() * batches.front().size();
+
+  {
+    TreeType tree;
+    tree.buildFromSorted(pairs.begin(), pairs.end());
+    bench::report("insert", 1e9 * bench::time([&]() {
+      for (auto const& batch : batches) {
+        for (auto const& pair : batch) {
+          tree.insert(pair.first, pair.second);
+        }
+      }
+    }) / updates, "ns/key");
+  }
+
+  {
+    TreeType tree;
+    tree.buildFromSorted(pairs.begin(), pairs.end());
+    bench::report("insertBatch", 1e9 * bench::time([&]() {
+      for (auto const& batch : batches) {
+        tree.insertBatch(batch.begin(), batch.end());
+      }
+    }) / updates, "ns/key");
+  }
+}
+
+BENCHMARK(AvlTreeHintedFind) {
+  AvlTree<long, long, AvlNode<long, long, InlineValues<long>>> tree;
+  std::vector<std::pair<long,long>> pairs(1000000);
+  for (std::size_t i = 0; i < pairs.size(); ++i) {
+    pairs[i] = std::make_pair(long(2 * i), long(i));
+  }
+  tree.buildFromSorted(pairs.begin(), pairs.end());
+
+  // a random walk over the keys, each lookup within a few positions of the last
+  std::mt19937 random(42);
+  std::vector<long> queries(2000000);
+  long key = 1000000;
+  for (long& query : queries) {
+    key += long(random() % 17) - 8;
+    if (key < 0 || key >= 2000000) key = 1000000;
+    query = key;
+  }
+
+  bench::report("findNearestGTE", 1e9 * bench::time([&]() {
+    for (long const query : queries) {
+      bench::keep(tree.findNearestGTE(query));
+    }
+  }) / queries.size(), "ns/key");
+
+  bench::report("findNearestGTE (hinted)", 1e9 * bench::time([&]() {
+    AvlNode<long, long, InlineValues<long>>* hint = nullptr;
+    for (long const query : queries) {
+      hint = tree.findNearestGTE(query, hint);
+      bench::keep(hint);
+    }
+  }) / queries.size(), "ns/key");
+}
+
+BENCHMARK(AvlTreeAppend) {
+  typedef AvlTree<long, long, AvlNode<long, long, InlineValues<long>>> TreeType;
+
+  // timestamps in increasing order, with an occasional late arrival
+  std::mt19937 random(42);
+  std::vector<long> keys(1000000);
+  long key = 0;
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    key += 1 + long(random() % 100);
+    keys[i] = (i % 100 == 0) ? key - 500 : key;
+  }
+
+  {
+    TreeType tree;
+    bench::report("insert", 1e9 * bench::time([&]() {
+      for (long const key : keys) {
+        tree.insert(key, key);
+      }
+    }) / keys.size(), "ns/key");
+  }
+
+  {
+    TreeType tree;
+    bench::report("append", 1e9 * bench::time([&]() {
+      for (long const key : keys) {
+        tree.append(key, key);
+      }
+    }) / keys.size(), "ns/key");
+  }
+}
+
+BENCHMARK(AvlTreeCountRange) {
+  typedef AvlNode<long, long, InlineValues<long>> NodeType;
+  typedef RankedAvlNode<long, long, InlineValues<long>> RankedNodeType;
+
+  std::vector<std::pair<long,long>> pairs(1000000);
+  for (std::size_t i = 0; i < pairs.size(); ++i) {
+    pairs[i] = std::make_pair(long(i), long(i));
+  }
+
+  std::mt19937 random(42);
+  std::vector<std::pair<long,long>> ranges(10000);
+  for (auto& range : ranges) {
+    range.first = long(random() % pairs.size());
+    range.second = range.first + long(random() % 10000);
+  }
+
+  {
+    AvlTree<long, long, NodeType> tree;
+    tree.buildFromSorted(pairs.begin(), pairs.end());
+    bench::report("getRange (drained)", 1e9 * bench::time([&]() {
+      for (auto const& range : ranges) {
+        auto iter = tree.getRange(range.first, range.second);
+        std::size_t count = 0;
+        while (iter->hasNext()) {
+          iter->next();
+          count += 1;
+        }
+        delete iter;
+        bench::keep(count);
+      }
+    }) / ranges.size(), "ns/range");
+  }
+
+  {
+    RankedAvlTree<long, long, InlineValues<long>> tree;
+    tree.buildFromSorted(pairs.begin(), pairs.end());
+    bench::report("countRange", 1e9 * bench::time([&]() {
+      for (auto const& range : ranges) {
+        bench::keep(tree.countRange(range.first, range.second));
+      }
+    }) / ranges.size(), "ns/range");
+  }
+
+  {
+    AvlTree<long, long, NodeType> tree;
+    bench::report("insert", 1e9 * bench::time([&]() {
+      for (auto const& pair : pairs) {
+        tree.insert(pair.first ^ 0x5555, pair.second);
+      }
+    }) / pairs.size(), "ns/key");
+  }
+
+  {
+    AvlTree<long, long, RankedNodeType> tree;
+    bench::report("insert (ranked)", 1e9 * bench::time([&]() {
+      for (auto const& pair : pairs) {
+        tree.insert(pair.first ^ 0x5555, pair.second);
+      }
+    }) / pairs.size(), "ns/key");
+  }
+}
+
+BENCHMARK(AvlTreeAggregate) {
+  std::vector<std::pair<long,long>> pairs(1000000);
+  for (std::size_t i = 0; i < pairs.size(); ++i) {
+    pairs[i] = std::make_pair(long(i), long(i % 1000));
+  }
+
+  std::mt19937 random(42);
+  std::vector<std::pair<long,long>> ranges(10000);
+  for (auto& range : ranges) {
+    range.first = long(random() % pairs.size());
+    range.second = range.first + long(random() % 10000);
+  }
+
+  {
+    AvlTree<long, long, AvlNode<long, long, InlineValues<long>>> tree;
+    tree.buildFromSorted(pairs.begin(), pairs.end());
+    bench::report("getRange (summed)", 1e9 * bench::time([&]() {
+      for (auto const& range : ranges) {
+        auto iter = tree.getRange(range.first, range.second);
+        long sum = 0;
+        while (iter->hasNext()) {
+          sum += iter->next()->getValue();
+        }
+        delete iter;
+        bench::keep(sum);
+      }
+    }) / ranges.size(), "ns/range");
+  }
+
+  {
+    AggregateAvlTree<long, long, SumAggregate<long>, InlineValues<long>> tree;
+    tree.buildFromSorted(pairs.begin(), pairs.end());
+    bench::report("aggregate", 1e9 * bench::time([&]() {
+      for (auto const& range : ranges) {
+        bench::keep(tree.aggregate(range.first, range.second));
+      }
+    }) / ranges.size(), "ns/range");
+  }
+}
+
+BENCHMARK(AvlTreeRangeScan) {
+  AvlTree<long, long, AvlNode<long, long, InlineValues<long>>> tree;
+  std::vector<std::pair<long,long>> pairs(1000000);
+  for (std::size_t i = 0; i < pairs.size(); ++i) {
+    pairs[i] = std::make_pair(long(i), long(i % 1000));
+  }
+  tree.buildFromSorted(pairs.begin(), pairs.end());
+
+  std::mt19937 random(42);
+  std::vector<long> lower_keys(100000);
+  for (long& lower_key : lower_keys) {
+    lower_key = long(random() % pairs.size());
+  }
+
+  bench::report("getRange", 1e9 * bench::time([&]() {
+    for (long const lower_key : lower_keys) {
+      auto iter = tree.getRange(lower_key, lower_key + 100);
+      long sum = 0;
+      while (iter->hasNext()) {
+        sum += iter->next()->getValue();
+      }
+      delete iter;
+      bench::keep(sum);
+    }
+  }) / lower_keys.size(), "ns/range");
+
+  bench::report("lower_bound", 1e9 * bench::time([&]() {
+    for (long const lower_key : lower_keys) {
+      long sum = 0;
+      for (auto iter = tree.lower_bound(lower_key);
+           iter != tree.end() && iter->getKey() <= lower_key + 100; ++iter) {
+        sum += iter->getValue();
+      }
+      bench::keep(sum);
+    }
+  }) / lower_keys.size(), "ns/range");
+}
+
+BENCHMARK(AvlTreeRangeFetch) {
+  AvlTree<long, long, AvlNode<long, long, InlineValues<long>>> tree;
+  std::vector<std::pair<long,long>> pairs(1000000);
+  for (std::size_t i = 0; i < pairs.size(); ++i) {
+    pairs[i] = std::make_pair(long(i), long(i % 1000));
+  }
+  tree.buildFromSorted(pairs.begin(), pairs.end());
+  std::vector<long> keys(pairs.size());
+  std::vector<long> values(pairs.size());
+
+  bench::report("to_vector", 1e9 * bench::time([&]() {
+    auto iter = tree.getRange(0, long(pairs.size()));
+    auto const nodes = iter->to_vector();
+    delete iter;
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+      keys[i] = nodes[i]->getKey();
+      values[i] = nodes[i]->getValue();
+    }
+    bench::keep(keys.data());
+  }) / pairs.size(), "ns/key");
+
+  bench::report("fetch (256 per chunk)", 1e9 * bench::time([&]() {
+    auto iter = tree.getRange(0, long(pairs.size()));
+    std::size_t offset = 0;
+    while (std::size_t const count = iter->fetch(
+        keys.data() + offset, values.data() + offset, nullptr, 256)) {
+      offset += count;
+    }
+    delete iter;
+    bench::keep(keys.data());
+  }) / pairs.size(), "ns/key");
+}
+
+/** The recursive traversal that Tree::inorder used to be, for comparison */
+template <class NodeType>
+void recursiveInorder(std::function<void (NodeType*)> const fn, NodeType* const node) {
+  if (node) {
+    recursiveInorder(fn, node->getLesserChild());
+    fn(node);
+    recursiveInorder(fn, node->getGreaterChild());
+  }
+}
+
+template <class NodeType>
+void recursivePreorder(std::function<void (NodeType*)> const fn, NodeType* const node) {
+  if (node) {
+    fn(node);
+    recursivePreorder(fn, node->getLesserChild());
+    recursivePreorder(fn, node->getGreaterChild());
+  }
+}
+
+BENCHMARK(AvlTreeTraversal) {
+  typedef AvlNode<long, long, InlineValues<long>> NodeType;
+  AvlTree<long, long, NodeType> tree;
+  std::mt19937 random(42);
+  for (int i = 0; i < 1000000; ++i) {
+    tree.insert(long(random()), i);
+  }
+  NodeType* root = tree.getLeast();
+  while (root->getParent()) {
+    root = root->getParent();
+  }
+
+  int const traversals = 5;
+  double const nodes = double(traversals) * tree.getSize();
+  long sum = 0;
+  auto const add = [&](NodeType* const node) {
+    sum += node->getValue();
+  };
+  std::function<void (NodeType*)> const add_fn = add;
+
+  bench::report("preorder (recursive)", 1e9 * bench::time([&]() {
+    for (int i = 0; i < traversals; ++i) recursivePreorder(add_fn, root);
+  }) / nodes, "ns/node");
+  bench::report("preorder", 1e9 * bench::time([&]() {
+    for (int i = 0; i < traversals; ++i) tree.preorder(add);
+  }) / nodes, "ns/node");
+  bench::report("inorder (recursive)", 1e9 * bench::time([&]() {
+    for (int i = 0; i < traversals; ++i) recursiveInorder(add_fn, root);
+  }) / nodes, "ns/node");
+  bench::report("inorder", 1e9 * bench::time([&]() {
+    for (int i = 0; i < traversals; ++i) tree.inorder(add);
+  }) / nodes, "ns/node");
+  bench::report("postorder", 1e9 * bench::time([&]() {
+    for (int i = 0; i < traversals; ++i) tree.postorder(add);
+  }) / nodes, "ns/node");
+  bench::keep(sum);
+}
@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../benchmark.h"
+#include "../../vst/avl_node.h"
+#include "../../vst/avl_tree.h"
+#include "../../vst/block_tree.h"
+#include "../../vst/inline_values.h"
+
+using namespace vst;
+
+template <class NodeType>
+inline long getValueOf(NodeType* const node) {
+  return node->getValue();
+}
+
+template <class NodeType>
+inline long getValueOf(BlockEntry<NodeType> const& entry) {
+  return entry.getValue();
+}
+
+template <class TreeType>
+void benchmarkBlocks(char const* const layout, std::vector<long> const& keys) {
+  std::printf(" %s\n", layout);
+  TreeType tree;
+
+  std::size_t const allocated_bytes = bench::allocated_bytes;
+  bench::report("insert", 1e9 * bench::time([&]() {
+    for (long const key : keys) {
+      tree.insert(key, key);
+    }
+  }) / keys.size(), "ns/key");
+  bench::report("allocated bytes per key",
+    double(bench::allocated_bytes - allocated_bytes) / tree.getSize(), "B");
+
+  std::vector<long> queries(keys);
+  std::shuffle(queries.begin(), queries.end(), std::mt19937(7));
+  bench::report("findNearestGTE", 1e9 * bench::time([&]() {
+    for (long const key : queries) {
+      bench::keep(tree.findNearestGTE(key + 1));
+    }
+  }) / queries.size(), "ns/key");
+
+  std::size_t const ranges = 10000;
+  bench::report("getRange (1000 keys)", 1e9 * bench::time([&]() {
+    for (std::size_t i = 0; i < ranges; ++i) {
+      auto iter = tree.getRange(queries[i], queries[i] + 1000 * 16);
+      long sum = 0;
+      while (iter->hasNext()) {
+        sum += getValueOf(iter->next());
+      }
+      delete iter;
+      bench::keep(sum);
+    }
+  }) / ranges, "ns/range");
+}
+
+BENCHMARK(BlockTreeLookups) {
+  // spread the keys so that ranges of 1000 * 16 hold about 1000 keys
+  std::mt19937 random(42);
+  std::vector<long> keys(4000000);
+  for (long& key : keys) {
+    key = long(random() % (16 * keys.size()));
+  }
+
+  benchmarkBlocks<AvlTree<long, long, AvlNode<long, long, InlineValues<long>>>>(
+    "AvlTree", keys);
+  benchmarkBlocks<BlockTree<long, long, 32>>("BlockTree<32>", keys);
+  benchmarkBlocks<BlockTree<long, long, 64>>("BlockTree<64>", keys);
+}
@@ -0,0 +1,55 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../benchmark.h"
+#include "../../vst/avl_node.h"
+#include "../../vst/avl_tree.h"
+#include "../../vst/compact_avl_tree.h"
+#include "../../vst/inline_values.h"
+
+using namespace vst;
+
+template <class TreeType>
+void benchmarkLookups(char const* const layout, std::size_t const node_size,
+                      std::vector<int> const& keys) {
+  std::printf(" %s (sizeof(node) = %zu bytes)\n", layout, node_size);
+  TreeType tree;
+
+  std::size_t const allocated_bytes = bench::allocated_bytes;
+  for (int const key : keys) {
+    tree.insert(key, key);
+  }
+  bench::report("allocated bytes per node",
+    double(bench::allocated_bytes - allocated_bytes) / tree.getSize(), "B");
+
+  std::vector<int> queries(keys);
+  std::shuffle(queries.begin(), queries.end(), std::mt19937(7));
+  bench::report("find", 1e9 * bench::time([&]() {
+    for (int const key : queries) {
+      bench::keep(tree.find(key));
+    }
+  }) / queries.size(), "ns/key");
+  bench::report("findNearest", 1e9 * bench::time([&]() {
+    for (int const key : queries) {
+      bench::keep(tree.findNearest(key + 1));
+    }
+  }) / queries.size(), "ns/key");
+}
+
+BENCHMARK(CompactAvlNodeLookups) {
+  std::vector<int> keys(2000000);
+  std::mt19937 random(42);
+  for (int& key : keys) {
+    key = random();
+  }
+
+  typedef AvlNode<int, int, InlineValues<int>> PointerNode;
+  benchmarkLookups<AvlTree<int, int, PointerNode>>(
+    "AvlNode", sizeof(PointerNode), keys);
+
+  typedef CompactAvlNode<int, int, InlineValues<int>> CompactNode;
+  benchmarkLookups<CompactAvlTree<int, int, InlineValues<int>>>(
+    "CompactAvlNode", sizeof(CompactNode), keys);
+}
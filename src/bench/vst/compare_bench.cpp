@@ -0,0 +1,63 @@
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "../benchmark.h"
+#include "../../vst/avl_node.h"
+#include "../../vst/avl_tree.h"
+#include "../../vst/compare.h"
+
+using namespace vst;
+
+template <class TreeType>
+void benchmarkCompare(char const* const mode, TreeType& tree,
+                      std::vector<int> const& keys) {
+  std::printf(" %s\n", mode);
+  bench::report("insert", 1e9 * bench::time([&]() {
+    for (int const key : keys) {
+      tree.insert(key, key);
+    }
+  }) / keys.size(), "ns/key");
+
+  bench::report("find", 1e9 * bench::time([&]() {
+    for (int const key : keys) {
+      bench::keep(tree.find(key));
+    }
+  }) / keys.size(), "ns/key");
+
+  bench::report("findNearestGTE", 1e9 * bench::time([&]() {
+    for (int const key : keys) {
+      bench::keep(tree.findNearestGTE(key + 1));
+    }
+  }) / keys.size(), "ns/key");
+
+  std::size_t nodes = 0;
+  double const seconds = bench::time([&]() {
+    for (int lower_key = 0; lower_key < 1000000; lower_key += 1000) {
+      auto iter = tree.getRange(lower_key, lower_key + 999);
+      while (iter->hasNext()) {
+        bench::keep(iter->next());
+        nodes += 1;
+      }
+      delete iter;
+    }
+  });
+  bench::report("getRange", 1e9 * seconds / nodes, "ns/node");
+}
+
+BENCHMARK(CompareFunctorAgainstStdFunction) {
+  std::vector<int> keys(1000000);
+  for (int key = 0; key < int(keys.size()); ++key) {
+    keys[key] = key;
+  }
+  std::shuffle(keys.begin(), keys.end(), std::mt19937(42));
+
+  AvlTree<int, int, AvlNode<int,int>, std::function<int (int,int)>> runtime_tree(
+    [](int const a, int const b) { return (a < b) ? -1 : (b < a) ? 1 : 0; });
+  benchmarkCompare("std::function<int (int,int)>", runtime_tree, keys);
+
+  AvlTree<int, int> static_tree;
+  benchmarkCompare("ThreeWayCompare<int>", static_tree, keys);
+}
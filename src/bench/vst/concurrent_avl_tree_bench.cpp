@@ -0,0 +1,95 @@
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../benchmark.h"
+#include "../../vst/avl_node.h"
+#include "../../vst/avl_tree.h"
+#include "../../vst/concurrent_avl_tree.h"
+
+using namespace vst;
+
+/**
+ * Runs the readers while a writer churns the odd keys, and reports the
+ * lookups per second of all readers together.
+ */
+template <class Lookup, class Write>
+void benchmarkReaders(unsigned int const reader_count, int const key_count,
+                      Lookup const& lookup, Write const& write) {
+  std::size_t const lookups = 500000;
+  std::atomic<bool> done(false);
+  std::thread writer([&]() {
+    std::mt19937 random(42);
+    while (!done.load(std::memory_order_relaxed)) {
+      write(2 * int(random() % (key_count / 2)) + 1, random() % 2);
+    }
+  });
+
+  double const seconds = bench::time([&]() {
+    std::vector<std::thread> readers;
+    for (unsigned int r = 0; r < reader_count; ++r) {
+      readers.emplace_back([&, r]() {
+        std::mt19937 random(r);
+        long sum = 0;
+        for (std::size_t i = 0; i < lookups; ++i) {
+          sum += lookup(int(random() % key_count));
+        }
+        bench::keep(sum);
+      });
+    }
+    for (std::thread& reader : readers) {
+      reader.join();
+    }
+  });
+  done = true;
+  writer.join();
+
+  char label[64];
+  std::snprintf(label, sizeof(label), "%u readers", reader_count);
+  bench::report(label, reader_count * lookups / seconds / 1e6, "M lookups/s");
+}
+
+BENCHMARK(ConcurrentAvlTreeReaders) {
+  int const key_count = 1000000;
+
+  std::printf(" AvlTree behind a std::mutex\n");
+  AvlTree<int, int> locked_tree;
+  std::mutex mutex;
+  for (int key = 0; key < key_count; key += 2) {
+    locked_tree.insert(key, key);
+  }
+  for (unsigned int readers : {1, 2, 4, 8}) {
+    benchmarkReaders(readers, key_count,
+      [&](int const key) {
+        std::lock_guard<std::mutex> const lock(mutex);
+        auto const node = locked_tree.findNearestGTE(key);
+        return (node) ? node->getKey() : 0;
+      },
+      [&](int const key, bool const insert) {
+        std::lock_guard<std::mutex> const lock(mutex);
+        if (insert) locked_tree.insert(key, key);
+        else locked_tree.remove(key);
+      });
+  }
+
+  std::printf(" ConcurrentAvlTree\n");
+  ConcurrentAvlTree<int, int> tree;
+  for (int key = 0; key < key_count; key += 2) {
+    tree.insert(key, key);
+  }
+  for (unsigned int readers : {1, 2, 4, 8}) {
+    benchmarkReaders(readers, key_count,
+      [&](int const key) {
+        auto const guard = tree.pin();
+        auto const node = tree.findNearestGTE(key);
+        return (node) ? node->getKey() : 0;
+      },
+      [&](int const key, bool const insert) {
+        if (insert) tree.insert(key, key);
+        else tree.remove(key);
+      });
+  }
+}
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../benchmark.h"
+#include "../../vst/avl_node.h"
+#include "../../vst/avl_tree.h"
+#include "../../vst/frozen_tree.h"
+#include "../../vst/inline_values.h"
+#include "../../vst/packed_frozen_tree.h"
+
+using namespace vst;
+
+template <class NodeType>
+inline long getKeyOf(NodeType* const node) {
+  return node->getKey();
+}
+
+template <class TreeType>
+inline long getKeyOf(FrozenEntry<TreeType> const& entry) {
+  return entry.getKey();
+}
+
+template <class TreeType>
+inline long getKeyOf(PackedEntry<TreeType> const& entry) {
+  return entry.getKey();
+}
+
+template <class TreeType>
+void benchmarkSnapshot(char const* const layout, TreeType const& tree,
+                       std::vector<long> const& queries) {
+  std::printf(" %s\n", layout);
+
+  bench::report("find", 1e9 * bench::time([&]() {
+    for (long const key : queries) {
+      bench::keep(tree.containsKey(key));
+    }
+  }) / queries.size(), "ns/key");
+
+  bench::report("findNearestGTE", 1e9 * bench::time([&]() {
+    for (long const key : queries) {
+      bench::keep(getKeyOf(tree.findNearestGTE(key - 1)));
+    }
+  }) / queries.size(), "ns/key");
+
+  std::size_t const ranges = 10000;
+  bench::report("getRange (1000 keys)", 1e9 * bench::time([&]() {
+    for (std::size_t i = 0; i < ranges; ++i) {
+      auto iter = tree.getRange(queries[i], queries[i] + 1000 * 16);
+      long sum = 0;
+      while (iter->hasNext()) {
+        sum += getKeyOf(iter->next());
+      }
+      delete iter;
+      bench::keep(sum);
+    }
+  }) / ranges, "ns/range");
+
+  std::size_t const searches = 100000;
+  bench::report("getNearestNeighbors (k = 10)", 1e9 * bench::time([&]() {
+    for (std::size_t i = 0; i < searches; ++i) {
+      auto iter = tree.getNearestNeighbors(queries[i] + 1, 10);
+      long sum = 0;
+      while (iter->hasNext()) {
+        sum += getKeyOf(iter->next());
+      }
+      delete iter;
+      bench::keep(sum);
+    }
+  }) / searches, "ns/search");
+}
+
+BENCHMARK(FrozenTreeLookups) {
+  // spread the keys so that ranges of 1000 * 16 hold about 1000 keys
+  std::mt19937 random(42);
+  std::vector<long> keys(4000000);
+  for (long& key : keys) {
+    key = long(random() % (16 * keys.size()));
+  }
+
+  AvlTree<long, long, AvlNode<long, long, InlineValues<long>>> tree;
+  for (long const key : keys) {
+    tree.insert(key, key);
+  }
+
+  std::vector<long> queries(keys);
+  std::shuffle(queries.begin(), queries.end(), std::mt19937(7));
+
+  benchmarkSnapshot("AvlTree", tree, queries);
+
+  FrozenTree<long, long> frozen;
+  std::printf(" freeze\n");
+  bench::report("freeze", 1e9 * bench::time([&]() {
+    frozen = tree.freeze();
+  }) / tree.getSize(), "ns/key");
+  benchmarkSnapshot("FrozenTree", frozen, queries);
+}
+
+template <class TreeType>
+void benchmarkTimestamps(char const* const layout, TreeType const& tree,
+                         std::size_t const key_bytes,
+                         std::vector<std::uint64_t> const& queries) {
+  std::printf(" %s\n", layout);
+  bench::report("key bytes per key", double(key_bytes) / tree.getKeyCount(), "B");
+
+  bench::report("findNearestGTE", 1e9 * bench::time([&]() {
+    for (std::uint64_t const key : queries) {
+      bench::keep(tree.findNearestGTE(key - 1).getPosition());
+    }
+  }) / queries.size(), "ns/key");
+
+  std::size_t const ranges = 10000;
+  bench::report("getRange (1000 keys)", 1e9 * bench::time([&]() {
+    for (std::size_t i = 0; i < ranges; ++i) {
+      auto iter = tree.getRange(queries[i], queries[i] + 1000 * 500);
+      std::uint64_t sum = 0;
+      while (iter->hasNext()) {
+        sum += iter->next().getValue();
+      }
+      delete iter;
+      bench::keep(sum);
+    }
+  }) / ranges, "ns/range");
+}
+
+BENCHMARK(PackedFrozenTreeTimestamps) {
+  // microsecond timestamps about 500us apart
+  std::mt19937 random(42);
+  std::vector<std::uint64_t> keys(4000000);
+  std::uint64_t timestamp = 1700000000000000ull;
+  for (std::uint64_t& key : keys) {
+    timestamp += 1 + random() % 1000;
+    key = timestamp;
+  }
+
+  AvlTree<std::uint64_t, std::uint64_t,
+          AvlNode<std::uint64_t, std::uint64_t, InlineValues<std::uint64_t>>> tree;
+  for (std::uint64_t const key : keys) {
+    tree.append(key, key);
+  }
+
+  std::vector<std::uint64_t> queries(keys);
+  std::shuffle(queries.begin(), queries.end(), std::mt19937(7));
+
+  FrozenTree<std::uint64_t, std::uint64_t> const frozen = tree.freeze();
+  benchmarkTimestamps("FrozenTree", frozen,
+    frozen.getKeyCount() * (2 * sizeof(std::uint64_t) + sizeof(std::size_t)), queries);
+
+  PackedFrozenTree<std::uint64_t, std::uint64_t> const packed = tree.freezePacked();
+  benchmarkTimestamps("PackedFrozenTree<64>", packed, packed.getKeyBytes(), queries);
+
+  PackedFrozenTree<std::uint64_t, std::uint64_t, 16> const packed_16 =
+    tree.freezePacked<16>();
+  benchmarkTimestamps("PackedFrozenTree<16>", packed_16, packed_16.getKeyBytes(), queries);
+}
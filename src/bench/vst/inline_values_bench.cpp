@@ -0,0 +1,48 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../benchmark.h"
+#include "../../vst/avl_node.h"
+#include "../../vst/avl_tree.h"
+#include "../../vst/inline_values.h"
+
+using namespace vst;
+
+template <class NodeType>
+void benchmarkValues(char const* const layout, std::vector<int> const& keys) {
+  std::printf(" %s (sizeof(node) = %zu bytes)\n", layout, sizeof(NodeType));
+  AvlTree<int, int, NodeType> tree;
+
+  std::size_t const allocated_bytes = bench::allocated_bytes;
+  std::size_t const allocations = bench::allocations;
+  double const seconds = bench::time([&]() {
+    for (int const key : keys) {
+      tree.insert(key, key);
+    }
+  });
+  std::size_t const nodes = tree.getSize();
+
+  bench::report("allocated bytes per node",
+    double(bench::allocated_bytes - allocated_bytes) / nodes, "B");
+  bench::report("allocations per node",
+    double(bench::allocations - allocations) / nodes, "");
+  bench::report("insert", 1e9 * seconds / keys.size(), "ns/key");
+  bench::report("getValue() along the vine", 1e9 * bench::time([&]() {
+    long sum = 0;
+    for (NodeType* node = tree.getLeast(); node; node = node->getGreaterNeighbor()) {
+      sum += node->getValue();
+    }
+    bench::keep(sum);
+  }) / nodes, "ns/node");
+}
+
+BENCHMARK(InlineValuesMemoryPerNode) {
+  std::vector<int> keys(1000000);
+  std::mt19937 random(42);
+  for (int& key : keys) {
+    key = random();
+  }
+  benchmarkValues<AvlNode<int, int>>("std::vector<int>", keys);
+  benchmarkValues<AvlNode<int, int, InlineValues<int>>>("InlineValues<int>", keys);
+}
@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../benchmark.h"
+#include "../../vst/block_tree.h"
+#include "../../vst/key_search.h"
+
+using namespace vst;
+
+/** Same order as ThreeWayCompare, but a different type, so BlockTree does not use KeySearch */
+template <class KeyType>
+struct OpaqueCompare {
+  inline int operator()(KeyType const& a, KeyType const& b) const {
+    return (a < b) ? -1 : (b < a) ? 1 : 0;
+  }
+};
+
+template <class KeyType>
+void benchmarkBlockSearch(char const* const type, std::uint32_t const block_size) {
+  std::printf(" %s, %u keys per block\n", type, block_size);
+  std::size_t const blocks = 4096;
+  std::mt19937 random(42);
+  std::vector<KeyType> keys(blocks * block_size);
+  for (KeyType& key : keys) {
+    key = KeyType(random() % 100000);
+  }
+  for (std::size_t i = 0; i < blocks; ++i) {
+    std::sort(keys.begin() + i * block_size, keys.begin() + (i + 1) * block_size);
+  }
+  std::vector<KeyType> queries(1000000);
+  std::vector<std::uint32_t> offsets(queries.size());
+  for (std::size_t i = 0; i < queries.size(); ++i) {
+    queries[i] = KeyType(random() % 100000);
+    offsets[i] = (random() % blocks) * block_size;
+  }
+
+  bench::report("std::lower_bound", 1e9 * bench::time([&]() {
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+      KeyType const* const block = keys.data() + offsets[i];
+      bench::keep(std::lower_bound(block, block + block_size, queries[i]) - block);
+    }
+  }) / queries.size(), "ns/search");
+
+  bench::report("KeySearch::countScalar", 1e9 * bench::time([&]() {
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+      bench::keep(KeySearch<KeyType>::countScalar(
+        keys.data() + offsets[i], block_size, queries[i], false));
+    }
+  }) / queries.size(), "ns/search");
+
+  bench::report("KeySearch::lowerBound", 1e9 * bench::time([&]() {
+    for (std::size_t i = 0; i < queries.size(); ++i) {
+      bench::keep(KeySearch<KeyType>::lowerBound(
+        keys.data() + offsets[i], block_size, queries[i]));
+    }
+  }) / queries.size(), "ns/search");
+}
+
+template <class TreeType>
+void benchmarkBlockTreeSearch(char const* const mode, std::vector<long> const& keys) {
+  TreeType tree;
+  for (long const key : keys) {
+    tree.insert(key, key);
+  }
+  std::vector<long> queries(keys);
+  std::shuffle(queries.begin(), queries.end(), std::mt19937(7));
+  bench::report(mode, 1e9 * bench::time([&]() {
+    for (long const key : queries) {
+      bench::keep(tree.findNearestGTE(key + 1).getValue());
+    }
+  }) / queries.size(), "ns/key");
+}
+
+BENCHMARK(KeySearchWithinBlocks) {
+  benchmarkBlockSearch<std::int32_t>("int32", 32);
+  benchmarkBlockSearch<std::int32_t>("int32", 64);
+  benchmarkBlockSearch<std::int64_t>("int64", 32);
+  benchmarkBlockSearch<std::int64_t>("int64", 64);
+  benchmarkBlockSearch<double>("double", 32);
+  benchmarkBlockSearch<double>("double", 64);
+
+  std::mt19937 random(42);
+  std::vector<long> keys(1000000);
+  for (long& key : keys) {
+    key = long(random() % (16 * keys.size()));
+  }
+  std::printf(" BlockTree<long, long, 64>::findNearestGTE\n");
+  benchmarkBlockTreeSearch<BlockTree<long, long, 64, OpaqueCompare<long>>>(
+    "binary search (custom compare)", keys);
+  benchmarkBlockTreeSearch<BlockTree<long, long, 64>>(
+    "KeySearch (ThreeWayCompare)", keys);
+}
@@ -0,0 +1,48 @@
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "../benchmark.h"
+#include "../../vst/avl_tree.h"
+#include "../../vst/distance.h"
+
+using namespace vst;
+
+template <class Distance>
+void benchmarkDistance(char const* const mode, AvlTree<int,int> const& tree,
+                       std::vector<int> const& queries, Distance const& distance) {
+  std::size_t nodes = 0;
+  double const seconds = bench::time([&]() {
+    for (int const key : queries) {
+      auto iter = tree.getNearestNeighbors(key, 16, distance);
+      while (iter->hasNext()) {
+        bench::keep(iter->next());
+        nodes += 1;
+      }
+      delete iter;
+    }
+  });
+  std::printf(" %s\n", mode);
+  bench::report("getNearestNeighbors(k = 16)", 1e9 * seconds / queries.size(), "ns/query");
+  bench::report("per neighbor", 1e9 * seconds / nodes, "ns/node");
+}
+
+BENCHMARK(NearestNeighborDistance) {
+  AvlTree<int,int> tree;
+  std::mt19937 random(42);
+  for (int i = 0; i < 1000000; ++i) {
+    tree.insert(random() % 100000000, i);
+  }
+  std::vector<int> queries(200000);
+  for (int& key : queries) {
+    key = random() % 100000000;
+  }
+
+  benchmarkDistance("std::function<double (int,int)>", tree, queries,
+    std::function<double (int,int)>([](int const a, int const b) {
+      return (a < b) ? double(b - a) : double(a - b);
+    }));
+  benchmarkDistance("AbsoluteDifference<int>", tree, queries,
+    AbsoluteDifference<int>());
+}
@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../benchmark.h"
+#include "../../vst/concurrent_avl_tree.h"
+#include "../../vst/optimistic_avl_tree.h"
+#include "../../vst/sharded_tree.h"
+
+using namespace vst;
+
+/**
+ * Thread counts from one to every core, doubling in between.
+ */
+std::vector<unsigned int> getThreadCounts() {
+  std::vector<unsigned int> thread_counts;
+  unsigned int const cores = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned int threads = 1; threads < cores; threads *= 2) {
+    thread_counts.push_back(threads);
+  }
+  thread_counts.push_back(cores);
+  return thread_counts;
+}
+
+/**
+ * Runs the writers, each inserting and then removing its own keys, and
+ * reports the writes per second of all writers together. The keys are random
+ * unless monotone, in which case the writers interleave increasing keys, like
+ * timestamps arriving in order.
+ */
+template <class Insert, class Remove>
+void benchmarkWriters(unsigned int const writer_count, int const key_range, bool const monotone,
+                      Insert const& insert, Remove const& remove) {
+  std::size_t const writes = 200000;
+  double const seconds = bench::time([&]() {
+    std::vector<std::thread> writers;
+    for (unsigned int w = 0; w < writer_count; ++w) {
+      writers.emplace_back([&, w]() {
+        std::mt19937 random(w);
+        std::vector<int> keys(writes / 2);
+        for (std::size_t i = 0; i < keys.size(); ++i) {
+          keys[i] = (monotone)
+            ? int(i * writer_count + w)
+            : int(random() % key_range);
+        }
+        for (int const key : keys) {
+          insert(key);
+        }
+        for (int const key : keys) {
+          remove(key);
+        }
+      });
+    }
+    for (std::thread& writer : writers) {
+      writer.join();
+    }
+  });
+
+  char label[64];
+  std::snprintf(label, sizeof(label), "%u writers", writer_count);
+  bench::report(label, writer_count * writes / seconds / 1e6, "M writes/s");
+}
+
+/**
+ * Runs the threads, each looking up nine random keys for every one it
+ * inserts or removes, and reports the operations per second of all threads
+ * together.
+ */
+template <class Find, class Insert, class Remove>
+void benchmarkMixed(unsigned int const thread_count, int const key_range,
+                    Find const& find, Insert const& insert, Remove const& remove) {
+  std::size_t const operations = 400000;
+  double const seconds = bench::time([&]() {
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0; t < thread_count; ++t) {
+      threads.emplace_back([&, t]() {
+        std::mt19937 random(t);
+        std::size_t found = 0;
+        for (std::size_t i = 0; i < operations; ++i) {
+          int const key = int(random() % key_range);
+          if (i % 20 == 0) {
+            insert(key);
+          }
+          else if (i % 20 == 10) {
+            remove(key);
+          }
+          else {
+            found += find(key);
+          }
+        }
+        bench::keep(found);
+      });
+    }
+    for (std::thread& thread : threads) {
+      thread.join();
+    }
+  });
+
+  char label[64];
+  std::snprintf(label, sizeof(label), "%u threads", thread_count);
+  bench::report(label, thread_count * operations / seconds / 1e6, "M operations/s");
+}
+
+BENCHMARK(OptimisticAvlTreeWriters) {
+  int const key_range = 1 << 24;
+  std::vector<unsigned int> const thread_counts = getThreadCounts();
+  std::vector<int> split_keys;
+  for (int i = 1; i < 64; ++i) {
+    split_keys.push_back(i * (key_range / 64));
+  }
+
+  for (bool const monotone : {false, true}) {
+    std::printf(" %s keys\n", (monotone) ? "Monotone" : "Random");
+
+    std::printf("  ConcurrentAvlTree behind a std::mutex\n");
+    for (unsigned int const threads : thread_counts) {
+      ConcurrentAvlTree<int, int> tree;
+      std::mutex mutex;
+      benchmarkWriters(threads, key_range, monotone,
+        [&](int const key) {
+          std::lock_guard<std::mutex> const lock(mutex);
+          tree.insert(key, key);
+        },
+        [&](int const key) {
+          std::lock_guard<std::mutex> const lock(mutex);
+          tree.remove(key);
+        });
+    }
+
+    std::printf("  ShardedTree (64 shards over the key range)\n");
+    for (unsigned int const threads : thread_counts) {
+      ShardedTree<int, int> tree(split_keys);
+      benchmarkWriters(threads, key_range, monotone,
+        [&](int const key) { tree.insert(key, key); },
+        [&](int const key) { tree.remove(key); });
+    }
+
+    std::printf("  OptimisticAvlTree\n");
+    for (unsigned int const threads : thread_counts) {
+      OptimisticAvlTree<int, int> tree;
+      benchmarkWriters(threads, key_range, monotone,
+        [&](int const key) { tree.insert(key, key); },
+        [&](int const key) { tree.remove(key); });
+    }
+  }
+}
+
+BENCHMARK(OptimisticAvlTreeMixed) {
+  int const key_range = 1 << 20;
+  std::vector<unsigned int> const thread_counts = getThreadCounts();
+
+  std::printf("  ConcurrentAvlTree, writers behind a std::mutex\n");
+  for (unsigned int const threads : thread_counts) {
+    ConcurrentAvlTree<int, int> tree;
+    std::mutex mutex;
+    for (int key = 0; key < key_range; key += 2) {
+      tree.insert(key, key);
+    }
+    benchmarkMixed(threads, key_range,
+      [&](int const key) {
+        auto const guard = tree.pin();
+        return tree.containsKey(key);
+      },
+      [&](int const key) {
+        std::lock_guard<std::mutex> const lock(mutex);
+        tree.insert(key, key);
+      },
+      [&](int const key) {
+        std::lock_guard<std::mutex> const lock(mutex);
+        tree.remove(key);
+      });
+  }
+
+  std::printf("  OptimisticAvlTree\n");
+  for (unsigned int const threads : thread_counts) {
+    OptimisticAvlTree<int, int> tree;
+    for (int key = 0; key < key_range; key += 2) {
+      tree.insert(key, key);
+    }
+    benchmarkMixed(threads, key_range,
+      [&](int const key) {
+        auto const guard = tree.pin();
+        return tree.containsKey(key);
+      },
+      [&](int const key) { tree.insert(key, key); },
+      [&](int const key) { tree.remove(key); });
+  }
+}
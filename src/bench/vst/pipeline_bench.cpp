@@ -0,0 +1,48 @@
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#include "../benchmark.h"
+#include "../../vst/avl_node.h"
+#include "../../vst/avl_tree.h"
+#include "../../vst/inline_values.h"
+#include "../../vst/pipeline.h"
+
+using namespace vst;
+
+BENCHMARK(PipelineRangeScan) {
+  typedef AvlNode<long, long, InlineValues<long>> NodeType;
+  AvlTree<long, long, NodeType> tree;
+  std::vector<std::pair<long,long>> pairs(50000);
+  for (std::size_t i = 0; i < pairs.size(); ++i) {
+    pairs[i] = std::make_pair(long(i), long(i % 1000));
+  }
+  tree.buildFromSorted(pairs.begin(), pairs.end());
+  int const scans = 1000;
+
+  // select -> map -> take over most of a tree that fits in the cache
+  bench::report("Iterator chain", 1e9 * bench::time([&]() {
+    for (int i = 0; i < scans; ++i) {
+      long sum = 0;
+      auto iter = tree.getRange(1000, 45000)
+        ->select([](NodeType* const node) { return node->getValue() % 3 == 0; })
+        ->map<long>([](NodeType* const node) { return 2 * node->getValue(); })
+        ->take(12500);
+      iter->each([&](long const value) { sum += value; return true; });
+      delete iter;
+      bench::keep(sum);
+    }
+  }) / scans, "ns/scan");
+
+  bench::report("Pipeline", 1e9 * bench::time([&]() {
+    for (int i = 0; i < scans; ++i) {
+      long sum = 0;
+      tree.getRangePipeline(1000, 45000)
+        .select([](NodeType* const node) { return node->getValue() % 3 == 0; })
+        .map([](NodeType* const node) { return 2 * node->getValue(); })
+        .take(12500)
+        .each([&](long const value) { sum += value; return true; });
+      bench::keep(sum);
+    }
+  }) / scans, "ns/scan");
+}
@@ -3,8 +3,22 @@
 #include "vst/avl_node_test.cpp"
 #include "vst/iterator_test.cpp"
 #include "vst/range_iterator_test.cpp"
+#include "vst/vine_iterator_test.cpp"
+#include "vst/pipeline_test.cpp"
 #include "vst/nearest_neighbor_iterator_test.cpp"
 #include "vst/avl_tree_test.cpp"
+#include "vst/node_allocator_test.cpp"
+#include "vst/inline_values_test.cpp"
+#include "vst/compact_avl_node_test.cpp"
+#include "vst/ranked_avl_node_test.cpp"
+#include "vst/aggregate_avl_node_test.cpp"
+#include "vst/block_tree_test.cpp"
+#include "vst/key_search_test.cpp"
+#include "vst/frozen_tree_test.cpp"
+#include "vst/packed_frozen_tree_test.cpp"
+#include "vst/concurrent_avl_tree_test.cpp"
+#include "vst/optimistic_avl_tree_test.cpp"
+#include "vst/sharded_tree_test.cpp"
 
 int main(int argc, char **argv) {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../../vst/aggregate.h"
+#include "../../vst/aggregate_avl_node.h"
+#include "../../vst/aggregate_avl_tree.h"
+#include "../../vst/ranked_avl_node.h"
+
+using namespace vst;
+
+TEST(AggregateAvlNodeTest, TestValuesAggregate) {
+  AggregateAvlNode<int, int, SumAggregate<int>> node;
+  ASSERT_TRUE((AggregatesSubtree<AggregateAvlNode<int, int, SumAggregate<int>>>::value));
+  ASSERT_FALSE((AggregatesSubtree<AvlNode<int,int>>::value));
+  ASSERT_EQ(0, node.getValuesAggregate());
+  node.addValue(3)->addValue(4);
+  ASSERT_EQ(7, node.getValuesAggregate());
+}
+
+TEST(AggregateAvlTreeTest, TestRandomUpdates) {
+  AggregateAvlTree<int, long, SumAggregate<long>> sums;
+  AggregateAvlTree<int, long, MaxAggregate<long>> maxima;
+  std::multimap<int,long> expected;
+  std::mt19937 random(17);
+  for (int i = 0; i < 20000; ++i) {
+    int const key = random() % 2000;
+    long const value = long(random() % 1000) - 500;
+    switch (random() % 4) {
+      case 0:
+        sums.remove(key);
+        maxima.remove(key);
+        expected.erase(key);
+        break;
+      case 1:
+        if (expected.count(key)) {
+          long const existing = expected.find(key)->second;
+          ASSERT_TRUE(sums.remove(key, existing));
+          ASSERT_TRUE(maxima.remove(key, existing));
+          expected.erase(expected.find(key));
+        }
+        break;
+      case 2:
+        sums.upsert(key, value);
+        maxima.upsert(key, value);
+        expected.erase(key);
+        expected.emplace(key, value);
+        break;
+      default:
+        sums.insert(key, value);
+        maxima.insert(key, value);
+        expected.emplace(key, value);
+        break;
+    }
+  }
+  ASSERT_TRUE(sums.checkInvariants());
+  ASSERT_TRUE(maxima.checkInvariants());
+
+  for (int i = 0; i < 1000; ++i) {
+    int const lower_key = int(random() % 2200) - 100;
+    int const upper_key = int(random() % 2200) - 100;
+    long sum = 0;
+    long maximum = MaxAggregate<long>::identity();
+    if (lower_key <= upper_key) {
+      for (auto iter = expected.lower_bound(lower_key);
+           iter != expected.upper_bound(upper_key); ++iter) {
+        sum += iter->second;
+        maximum = std::max(maximum, iter->second);
+      }
+    }
+    ASSERT_EQ(sum, sums.aggregate(lower_key, upper_key));
+    ASSERT_EQ(maximum, maxima.aggregate(lower_key, upper_key));
+  }
+}
+
+TEST(AggregateAvlTreeTest, TestBuildAndBatch) {
+  AggregateAvlTree<int, int, MinAggregate<int>> tree;
+  std::vector<std::pair<int,int>> pairs;
+  for (int key = 0; key < 100; ++key) {
+    pairs.emplace_back(key, 100 - key);
+  }
+  tree.buildFromSorted(pairs.begin(), pairs.end());
+  ASSERT_EQ(51, tree.aggregate(10, 49));
+
+  std::vector<std::pair<int,int>> batch = {{20, -5}, {150, -7}, {30, 1}};
+  tree.insertBatch(batch.begin(), batch.end());
+  ASSERT_TRUE(tree.checkInvariants());
+  ASSERT_EQ(-5, tree.aggregate(10, 49));
+  ASSERT_EQ(-7, tree.aggregate(0, 200));
+  ASSERT_EQ(MinAggregate<int>::identity(), tree.aggregate(101, 149));
+}
+
+TEST(AggregateAvlTreeTest, TestWithSubtreeSize) {
+  typedef AvlNode<int, long, std::vector<long>,
+                  SubtreeSize, SubtreeAggregate<SumAggregate<long>>> NodeType;
+  ASSERT_TRUE(CountsSubtree<NodeType>::value);
+  ASSERT_TRUE(AggregatesSubtree<NodeType>::value);
+
+  AvlTree<int, long, NodeType> tree;
+  std::map<int,long> expected;
+  std::mt19937 random(14);
+  for (int i = 0; i < 10000; ++i) {
+    int const key = random() % 1000;
+    if (random() % 3 == 0) {
+      tree.remove(key);
+      expected.erase(key);
+    }
+    else {
+      long const value = long(random() % 100);
+      tree.upsert(key, value);
+      expected[key] = value;
+    }
+  }
+  ASSERT_TRUE(tree.checkInvariants());
+
+  std::size_t index = 0;
+  long sum = 0;
+  for (auto const& pair : expected) {
+    ASSERT_EQ(index, tree.rank(pair.first));
+    ASSERT_EQ(pair.first, tree.select(index)->getKey());
+    sum += pair.second;
+    ASSERT_EQ(sum, tree.aggregate(-1, pair.first));
+    index += 1;
+  }
+}
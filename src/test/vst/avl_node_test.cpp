@@ -35,6 +35,9 @@ protected:
 
   virtual void TearDown() {
     delete parent;
+    delete node;
+    delete lesser_child;
+    delete greater_child;
   }
 
   AvlNode<int,int>* node;
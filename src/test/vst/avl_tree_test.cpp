@@ -1,6 +1,434 @@
 #include <functional>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "../../vst/avl_node.h"
-//#include "../../vst/avl_tree.h"
+#include "../../vst/avl_tree.h"
+
+using namespace vst;
+
+class AvlTreeTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    tree = new AvlTree<int,int>();
+    for (int key = 1; key <= 9; ++key) {
+      tree->insert(key, 10 * key);
+    }
+  }
+
+  virtual void TearDown() {
+    delete tree;
+  }
+
+  AvlTree<int,int>* tree;
+
+  std::function<double (int,int)> distance = [](int const a, int const b) {
+    return (a > b) ? a - b : b - a;
+  };
+};
+
+TEST(NewAvlTreeTest, TestInsertOrGetIntoEmptyTree) {
+  AvlTree<int,int> tree;
+  auto const result = tree.insertOrGet(1, 10);
+  ASSERT_TRUE(result.second);
+  ASSERT_EQ(result.first, tree.getLeast());
+  ASSERT_EQ(1, tree.getSize());
+  ASSERT_TRUE(tree.checkInvariants());
+}
+
+TEST(NewAvlTreeTest, NewTreeShouldBeEmpty) {
+  AvlTree<int,int> tree;
+  ASSERT_EQ(0, tree.getSize());
+  ASSERT_EQ(0, tree.getHeight());
+  ASSERT_EQ(nullptr, tree.getLeast());
+  ASSERT_EQ(nullptr, tree.getGreatest());
+  ASSERT_EQ(nullptr, tree.find(1));
+  ASSERT_FALSE(tree.remove(1));
+  ASSERT_TRUE(tree.checkInvariants());
+}
+
+TEST_F(AvlTreeTest, TestAscendingInsertsStayBalanced) {
+  ASSERT_EQ(9, tree->getSize());
+  ASSERT_EQ(3, tree->getHeight());
+  ASSERT_TRUE(tree->checkInvariants());
+  ASSERT_EQ(1, tree->getLeast()->getKey());
+  ASSERT_EQ(9, tree->getGreatest()->getKey());
+}
+
+TEST_F(AvlTreeTest, TestVine) {
+  auto node = tree->getLeast();
+  for (int key = 1; key <= 9; ++key) {
+    ASSERT_EQ(key, node->getKey());
+    ASSERT_EQ(10 * key, node->getValue());
+    node = node->getGreaterNeighbor();
+  }
+  ASSERT_EQ(nullptr, node);
+}
+
+TEST_F(AvlTreeTest, TestFind) {
+  ASSERT_EQ(5, tree->find(5)->getKey());
+  ASSERT_EQ(nullptr, tree->find(0));
+  ASSERT_EQ(nullptr, tree->find(10));
+  ASSERT_EQ(4, tree->findNearestLTE(4)->getKey());
+  ASSERT_EQ(9, tree->findNearestLTE(15)->getKey());
+  ASSERT_EQ(nullptr, tree->findNearestLTE(0));
+  ASSERT_EQ(1, tree->findNearestGTE(-3)->getKey());
+  ASSERT_EQ(nullptr, tree->findNearestGTE(10));
+}
+
+TEST_F(AvlTreeTest, TestInsertDuplicates) {
+  ASSERT_FALSE(tree->tryInsert(5, 51));
+  tree->insert(5, 52);
+  ASSERT_EQ(10, tree->getSize());
+  ASSERT_EQ(2, tree->find(5)->getValues().size());
+  ASSERT_TRUE(tree->checkInvariants());
+}
+
+TEST_F(AvlTreeTest, TestInsertOrGet) {
+  auto result = tree->insertOrGet(5, 55);
+  ASSERT_FALSE(result.second);
+  ASSERT_EQ(tree->find(5), result.first);
+  ASSERT_EQ(1, result.first->getValues().size());
+  result.first->getValue() += 1;
+  ASSERT_EQ(51, tree->find(5)->getValue());
+
+  result = tree->insertOrGet(10, 100);
+  ASSERT_TRUE(result.second);
+  ASSERT_EQ(10, result.first->getKey());
+  ASSERT_EQ(9, result.first->getLesserNeighbor()->getKey());
+  ASSERT_EQ(10, tree->getSize());
+  ASSERT_TRUE(tree->checkInvariants());
+}
+
+TEST_F(AvlTreeTest, TestUpsert) {
+  tree->insert(5, 51)->insert(5, 52);
+  auto result = tree->upsert(5, 42);
+  ASSERT_FALSE(result.second);
+  ASSERT_EQ(1, result.first->getValues().size());
+  ASSERT_EQ(42, result.first->getValue());
+  ASSERT_EQ(9, tree->getSize());
+
+  result = tree->upsert(0, 7);
+  ASSERT_TRUE(result.second);
+  ASSERT_EQ(result.first, tree->getLeast());
+  ASSERT_EQ(10, tree->getSize());
+  ASSERT_TRUE(tree->checkInvariants());
+}
+
+TEST_F(AvlTreeTest, TestRemove) {
+  ASSERT_TRUE(tree->remove(4));
+  ASSERT_FALSE(tree->remove(4));
+  ASSERT_EQ(nullptr, tree->find(4));
+  ASSERT_EQ(8, tree->getSize());
+  ASSERT_TRUE(tree->checkInvariants());
+  ASSERT_EQ(5, tree->find(3)->getGreaterNeighbor()->getKey());
+  ASSERT_EQ(3, tree->find(5)->getLesserNeighbor()->getKey());
+
+  for (int key = 1; key <= 9; ++key) {
+    tree->remove(key);
+    ASSERT_TRUE(tree->checkInvariants());
+  }
+  ASSERT_EQ(0, tree->getSize());
+  ASSERT_EQ(nullptr, tree->getLeast());
+}
+
+TEST_F(AvlTreeTest, TestClear) {
+  tree->clear();
+  ASSERT_EQ(0, tree->getSize());
+  ASSERT_EQ(0, tree->getHeight());
+  ASSERT_EQ(nullptr, tree->getLeast());
+  ASSERT_EQ(nullptr, tree->find(5));
+  ASSERT_TRUE(tree->checkInvariants());
+
+  tree->insert(2, 20)->insert(1, 10);
+  ASSERT_EQ(2, tree->getSize());
+  ASSERT_EQ(1, tree->getLeast()->getKey());
+  ASSERT_EQ(2, tree->getLeast()->getGreaterNeighbor()->getKey());
+  ASSERT_TRUE(tree->checkInvariants());
+}
+
+TEST_F(AvlTreeTest, TestRemoveValue) {
+  tree->insert(5, 51);
+  ASSERT_FALSE(tree->remove(5, 42));
+  ASSERT_TRUE(tree->remove(5, 50));
+  ASSERT_EQ(9, tree->getSize());
+  ASSERT_EQ(51, tree->find(5)->getValue());
+  ASSERT_TRUE(tree->remove(5, 51));
+  ASSERT_EQ(nullptr, tree->find(5));
+  ASSERT_EQ(8, tree->getSize());
+  ASSERT_TRUE(tree->checkInvariants());
+}
+
+TEST_F(AvlTreeTest, TestTraversals) {
+  std::vector<int> keys;
+  auto const collect = [&](AvlNode<int,int>* const node) {
+    keys.push_back(node->getKey());
+  };
+
+  ASSERT_TRUE(tree->preorder(collect));
+  ASSERT_EQ((std::vector<int> {4, 2, 1, 3, 6, 5, 8, 7, 9}), keys);
+  keys.clear();
+  ASSERT_TRUE(tree->inorder(collect));
+  ASSERT_EQ((std::vector<int> {1, 2, 3, 4, 5, 6, 7, 8, 9}), keys);
+  keys.clear();
+  ASSERT_TRUE(tree->postorder(collect));
+  ASSERT_EQ((std::vector<int> {1, 3, 2, 5, 7, 9, 8, 6, 4}), keys);
+
+  AvlNode<int,int>* const subtree = tree->find(8)->getParent();
+  keys.clear();
+  tree->preorder(collect, subtree);
+  tree->inorder(collect, subtree);
+  tree->postorder(collect, subtree);
+  ASSERT_EQ((std::vector<int> {6, 5, 8, 7, 9, 5, 6, 7, 8, 9, 5, 7, 9, 8, 6}), keys);
+
+  auto const until_5 = [&](AvlNode<int,int>* const node) {
+    keys.push_back(node->getKey());
+    return node->getKey() != 5;
+  };
+  keys.clear();
+  ASSERT_FALSE(tree->preorder(until_5));
+  ASSERT_FALSE(tree->inorder(until_5));
+  ASSERT_FALSE(tree->postorder(until_5));
+  ASSERT_EQ((std::vector<int> {4, 2, 1, 3, 6, 5, 1, 2, 3, 4, 5, 1, 3, 2, 5}), keys);
+}
+
+TEST_F(AvlTreeTest, TestRange) {
+  auto iter = tree->getRange(3, 5);
+  ASSERT_EQ(3, iter->next()->getKey());
+  ASSERT_EQ(4, iter->next()->getKey());
+  ASSERT_EQ(5, iter->next()->getKey());
+  ASSERT_FALSE(iter->hasNext());
+  delete iter;
+}
+
+TEST_F(AvlTreeTest, TestNeighbors) {
+  auto iter = tree->getNeighbors(5, 2, 1);
+  ASSERT_EQ(3, iter->next()->getKey());
+  ASSERT_EQ(4, iter->next()->getKey());
+  ASSERT_EQ(5, iter->next()->getKey());
+  ASSERT_EQ(6, iter->next()->getKey());
+  ASSERT_FALSE(iter->hasNext());
+  delete iter;
+}
+
+TEST_F(AvlTreeTest, TestNearestNeighbors) {
+  tree->remove(4);
+  auto iter = tree->getNearestNeighbors(4, 3, distance);
+  ASSERT_EQ(3, iter->next()->getKey());
+  ASSERT_EQ(5, iter->next()->getKey());
+  ASSERT_EQ(6, iter->next()->getKey());
+  ASSERT_FALSE(iter->hasNext());
+  delete iter;
+
+  auto default_iter = tree->getNearestNeighbors(0, 2);
+  ASSERT_EQ(1, default_iter->next()->getKey());
+  ASSERT_EQ(2, default_iter->next()->getKey());
+  ASSERT_FALSE(default_iter->hasNext());
+  delete default_iter;
+}
+
+TEST(AvlTreeStressTest, TestRandomInsertsAndRemoves) {
+  AvlTree<int,int> tree;
+  std::multimap<int,int> expected;
+  std::mt19937 random(42);
+  std::uniform_int_distribution<int> keys(0, 500);
+
+  for (int i = 0; i < 5000; ++i) {
+    int const key = keys(random);
+    if (random() % 3 == 0) {
+      ASSERT_EQ(expected.count(key) > 0, tree.remove(key));
+      expected.erase(key);
+    }
+    else {
+      tree.insert(key, i);
+      expected.emplace(key, i);
+    }
+    ASSERT_EQ(expected.size(), tree.getSize());
+  }
+
+  ASSERT_TRUE(tree.checkInvariants());
+
+  auto node = tree.getLeast();
+  for (auto iter = expected.begin(); iter != expected.end();
+       iter = expected.upper_bound(iter->first)) {
+    ASSERT_EQ(iter->first, node->getKey());
+    ASSERT_EQ(expected.count(iter->first), node->getValues().size());
+    node = node->getGreaterNeighbor();
+  }
+  ASSERT_EQ(nullptr, node);
+}
+
+TEST(AvlTreeCompareTest, TestRuntimeCompare) {
+  AvlTree<int, int, AvlNode<int,int>, std::function<int (int,int)>> tree(
+    [](int const a, int const b) { return b - a; });
+  for (int key = 1; key <= 5; ++key) {
+    tree.insert(key, key);
+  }
+  ASSERT_EQ(5, tree.getLeast()->getKey());
+  ASSERT_EQ(1, tree.getGreatest()->getKey());
+  ASSERT_EQ(3, tree.findNearestGTE(3)->getKey());
+
+  auto iter = tree.getRange(4, 2);
+  ASSERT_EQ(4, iter->next()->getKey());
+  ASSERT_EQ(3, iter->next()->getKey());
+  ASSERT_EQ(2, iter->next()->getKey());
+  ASSERT_FALSE(iter->hasNext());
+  delete iter;
+  ASSERT_TRUE(tree.checkInvariants());
+}
+
+TEST(AvlTreeBuildTest, TestBuildFromSortedPairs) {
+  std::vector<std::pair<int,int>> pairs;
+  for (int key = 0; key < 1000; ++key) {
+    pairs.emplace_back(2 * key, key);
+    if (key % 10 == 0) {
+      pairs.emplace_back(2 * key, -key);
+    }
+  }
+
+  AvlTree<int,int> tree;
+  tree.insert(1, 1);
+  tree.buildFromSorted(pairs.begin(), pairs.end());
+  ASSERT_EQ(pairs.size(), tree.getSize());
+  ASSERT_EQ(9, tree.getHeight());
+  ASSERT_TRUE(tree.checkInvariants());
+  ASSERT_EQ(nullptr, tree.find(1));
+  ASSERT_EQ(2, tree.find(20)->getValues().size());
+  ASSERT_EQ(-10, tree.find(20)->getValues()[1]);
+  ASSERT_EQ(0, tree.getLeast()->getKey());
+  ASSERT_EQ(1998, tree.getGreatest()->getKey());
+
+  tree.insert(1, 1);
+  ASSERT_TRUE(tree.remove(20));
+  ASSERT_TRUE(tree.checkInvariants());
+}
+
+TEST(AvlTreeBuildTest, TestBuildFromSortedKeysAndValues) {
+  std::vector<int> const keys = {1, 2, 3, 5, 8};
+  std::vector<int> const values = {10, 20, 30, 50, 80};
+
+  AvlTree<int,int> tree;
+  tree.buildFromSorted(keys.begin(), keys.end(), values.begin());
+  ASSERT_EQ(5, tree.getSize());
+  ASSERT_EQ(2, tree.getHeight());
+  ASSERT_TRUE(tree.checkInvariants());
+  ASSERT_EQ(50, tree.find(5)->getValue());
+  ASSERT_EQ(8, tree.findNearestGTE(6)->getKey());
+
+  tree.buildFromSorted(keys.end(), keys.end(), values.end());
+  ASSERT_EQ(0, tree.getSize());
+  ASSERT_EQ(nullptr, tree.getLeast());
+  ASSERT_TRUE(tree.checkInvariants());
+}
+
+TEST(AvlTreeBatchTest, TestInsertBatch) {
+  AvlTree<int,int> tree;
+  std::multimap<int,int> expected;
+  std::mt19937 random(5);
+
+  for (int round = 0; round < 40; ++round) {
+    // alternate batches that are large and small compared to the tree
+    std::size_t const batch_size = (round % 2 == 0) ? 400 : 8;
+    std::vector<std::pair<int,int>> batch;
+    for (std::size_t i = 0; i < batch_size; ++i) {
+      int const key = random() % 3000;
+      batch.emplace_back(key, round);
+      expected.emplace(key, round);
+    }
+
+    auto const least = tree.getLeast();
+    tree.insertBatch(batch.begin(), batch.end());
+    ASSERT_EQ(expected.size(), tree.getSize());
+    ASSERT_TRUE(tree.checkInvariants());
+    if (least) {
+      ASSERT_EQ(least, tree.find(least->getKey()));
+    }
+  }
+
+  auto node = tree.getLeast();
+  for (auto iter = expected.begin(); iter != expected.end();
+       iter = expected.upper_bound(iter->first)) {
+    ASSERT_EQ(iter->first, node->getKey());
+    ASSERT_EQ(expected.count(iter->first), node->getValues().size());
+    node = node->getGreaterNeighbor();
+  }
+  ASSERT_EQ(nullptr, node);
+}
+
+TEST(AvlTreeBatchTest, TestInsertBatchKeepsValueOrder) {
+  AvlTree<int,int> tree;
+  std::vector<std::pair<int,int>> batch = {{3, 1}, {1, 1}, {3, 2}, {2, 1}, {3, 3}};
+  tree.insertBatch(batch.begin(), batch.end());
+  ASSERT_EQ(5, tree.getSize());
+  ASSERT_EQ(3, tree.find(3)->getValues().size());
+  ASSERT_EQ(1, tree.find(3)->getValues()[0]);
+  ASSERT_EQ(3, tree.find(3)->getValues()[2]);
+  ASSERT_TRUE(tree.checkInvariants());
+}
+
+TEST(AvlTreeHintTest, TestHintedLookups) {
+  AvlTree<int,int> tree;
+  std::vector<AvlNode<int,int>*> nodes;
+  for (int key = 0; key < 2000; key += 2) {
+    nodes.push_back(tree.insertOrGet(key, key).first);
+  }
+
+  std::mt19937 random(3);
+  for (int i = 0; i < 5000; ++i) {
+    AvlNode<int,int>* const hint = nodes[random() % nodes.size()];
+    int const key = hint->getKey() + int(random() % 101) - 50
+      + ((i % 10 == 0) ? int(random() % 4001) - 2000 : 0);
+    ASSERT_EQ(tree.findNearest(key), tree.findNearest(key, hint)) << key;
+    ASSERT_EQ(tree.find(key), tree.find(key, hint)) << key;
+    ASSERT_EQ(tree.findNearestGTE(key), tree.findNearestGTE(key, hint)) << key;
+    ASSERT_EQ(tree.findNearestLTE(key), tree.findNearestLTE(key, hint)) << key;
+  }
+}
+
+TEST(AvlTreeHintTest, TestHintedInsert) {
+  AvlTree<int,int> tree;
+  std::multimap<int,int> expected;
+  std::mt19937 random(9);
+  AvlNode<int,int>* hint = nullptr;
+  int key = 0;
+  for (int i = 0; i < 3000; ++i) {
+    key += int(random() % 21) - 8;
+    hint = tree.insert(key, i, hint);
+    expected.emplace(key, i);
+    ASSERT_EQ(key, hint->getKey());
+  }
+  ASSERT_EQ(expected.size(), tree.getSize());
+  ASSERT_TRUE(tree.checkInvariants());
+
+  auto const result = tree.insertOrGet(key, -1, hint);
+  ASSERT_FALSE(result.second);
+  ASSERT_EQ(hint, result.first);
+}
+
+TEST(AvlTreeAppendTest, TestAppend) {
+  AvlTree<int,int> tree;
+  std::multimap<int,int> expected;
+  std::mt19937 random(5);
+  int key = 0;
+  for (int i = 0; i < 3000; ++i) {
+    key += int(random() % 10) - ((i % 50 == 0) ? 20 : 0);
+    ASSERT_EQ(key, tree.append(key, i)->getKey());
+    expected.emplace(key, i);
+    ASSERT_EQ(expected.begin()->first, tree.getLeast()->getKey());
+    ASSERT_EQ(expected.rbegin()->first, tree.getGreatest()->getKey());
+  }
+  ASSERT_EQ(expected.size(), tree.getSize());
+  ASSERT_TRUE(tree.checkInvariants());
+
+  tree.remove(expected.begin()->first);
+  tree.remove(expected.rbegin()->first);
+  ASSERT_TRUE(tree.checkInvariants());
+
+  tree.clear();
+  ASSERT_EQ(nullptr, tree.getLeast());
+  ASSERT_EQ(nullptr, tree.getGreatest());
+}
@@ -0,0 +1,170 @@
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../../vst/block_node.h"
+#include "../../vst/block_tree.h"
+
+using namespace vst;
+
+typedef BlockTree<int, int, 4> SmallBlockTree;
+
+static std::vector<int> collectKeys(Iterator<SmallBlockTree::Entry>* const iter) {
+  std::vector<int> keys;
+  while (iter->hasNext()) {
+    keys.push_back(iter->next().getKey());
+  }
+  delete iter;
+  return keys;
+}
+
+TEST(BlockNodeTest, TestEntries) {
+  BlockNode<int, int, 4> node;
+  node.insert(0, 3, 30);
+  node.insert(0, 1, 10);
+  node.insert(1, 2, 20);
+  ASSERT_EQ(3, node.getCount());
+  ASSERT_EQ(1, node.getKey());
+  ASSERT_EQ(20, node.getValue(1));
+  ASSERT_EQ(3, node.getValues().size());
+
+  BlockNode<int, int, 4> other;
+  node.moveEntries(1, &other);
+  ASSERT_EQ(1, node.getCount());
+  ASSERT_EQ(2, other.getCount());
+  ASSERT_EQ(2, other.getKey());
+  other.erase(0);
+  ASSERT_EQ(3, other.getKey());
+}
+
+TEST(BlockTreeTest, TestRandomInsertsAndRemoves) {
+  SmallBlockTree tree;
+  std::multimap<int,int> expected;
+  std::mt19937 random(21);
+  for (int i = 0; i < 20000; ++i) {
+    int const key = random() % 300;
+    if (random() % 3 == 0) {
+      if (random() % 2 == 0) {
+        ASSERT_EQ(expected.count(key) > 0, tree.remove(key));
+        expected.erase(key);
+      }
+      else if (expected.count(key)) {
+        ASSERT_TRUE(tree.remove(key, expected.find(key)->second));
+        expected.erase(expected.find(key));
+      }
+    }
+    else if (expected.count(key) < 12) {
+      tree.insert(key, i);
+      expected.emplace(key, i);
+    }
+  }
+  ASSERT_EQ(expected.size(), tree.getSize());
+  ASSERT_TRUE(tree.checkInvariants());
+
+  auto entry = tree.getLeast();
+  for (auto const& pair : expected) {
+    ASSERT_EQ(pair.first, entry.getKey());
+    ASSERT_EQ(pair.second, entry.getValue());
+    entry = entry.getGreaterNeighbor();
+  }
+  ASSERT_FALSE(entry);
+
+  for (int key = -1; key <= 301; ++key) {
+    auto const gte = expected.lower_bound(key);
+    auto const lte = expected.upper_bound(key);
+    if (gte == expected.end()) {
+      ASSERT_FALSE(tree.findNearestGTE(key));
+    }
+    else {
+      ASSERT_EQ(gte->first, tree.findNearestGTE(key).getKey());
+      ASSERT_EQ(gte->second, tree.findNearestGTE(key).getValue());
+    }
+    if (lte == expected.begin()) {
+      ASSERT_FALSE(tree.findNearestLTE(key));
+    }
+    else {
+      ASSERT_EQ(std::prev(lte)->second, tree.findNearestLTE(key).getValue());
+    }
+    ASSERT_EQ(expected.count(key) > 0, tree.containsKey(key));
+  }
+}
+
+TEST(BlockTreeTest, TestAscendingInsertsFillBlocks) {
+  SmallBlockTree tree;
+  for (int key = 0; key < 100; ++key) {
+    tree.insert(key, key);
+  }
+  ASSERT_TRUE(tree.checkInvariants());
+  int blocks = 0;
+  for (auto node = tree.getLeast().getNode(); node; node = node->getGreaterNeighbor()) {
+    ASSERT_EQ(4, node->getCount());
+    blocks += 1;
+  }
+  ASSERT_EQ(25, blocks);
+}
+
+TEST(BlockTreeTest, TestDuplicates) {
+  SmallBlockTree tree;
+  for (int i = 0; i < 4; ++i) {
+    tree.insert(5, i);
+  }
+  tree.insert(7, 0);
+  tree.insert(3, 0);
+  ASSERT_TRUE(tree.checkInvariants());
+  ASSERT_EQ(0, tree.find(5).getValue());
+  ASSERT_EQ(6, tree.getSize());
+  ASSERT_TRUE(tree.remove(5, 2));
+  ASSERT_EQ((std::vector<int> {3, 5, 5, 5, 7}), collectKeys(tree.getRange(0, 10)));
+}
+
+TEST(BlockTreeTest, TestKeysSpanningBlocks) {
+  SmallBlockTree tree;
+  tree.insert(3, 0);
+  tree.insert(7, 0);
+  for (int i = 0; i < 10; ++i) {
+    tree.insert(5, i);
+  }
+  tree.insert(6, 0);
+  tree.insert(4, 0);
+  ASSERT_TRUE(tree.checkInvariants());
+  ASSERT_EQ(14, tree.getSize());
+
+  // the values of the key stay in insertion order across its blocks
+  std::vector<int> values;
+  for (auto entry = tree.find(5); entry && entry.getKey() == 5; entry = entry.getGreaterNeighbor()) {
+    values.push_back(entry.getValue());
+  }
+  ASSERT_EQ((std::vector<int> {0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), values);
+  ASSERT_EQ(5, tree.findNearestGTE(5).getKey());
+  ASSERT_EQ(0, tree.findNearestGTE(5).getValue());
+  ASSERT_EQ(9, tree.findNearestLTE(5).getValue());
+  ASSERT_EQ(6, tree.findNearestGT(5).getKey());
+  ASSERT_EQ(4, tree.findNearestLTE(4).getKey());
+  ASSERT_EQ((std::vector<int> {4, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 6}),
+            collectKeys(tree.getRange(4, 6)));
+
+  ASSERT_TRUE(tree.remove(5, 6));
+  ASSERT_FALSE(tree.remove(5, 6));
+  ASSERT_TRUE(tree.checkInvariants());
+  ASSERT_TRUE(tree.remove(5));
+  ASSERT_TRUE(tree.checkInvariants());
+  ASSERT_FALSE(tree.containsKey(5));
+  ASSERT_EQ((std::vector<int> {3, 4, 6, 7}), collectKeys(tree.getRange(0, 10)));
+}
+
+TEST(BlockTreeTest, TestQueries) {
+  SmallBlockTree tree;
+  for (int key = 1; key <= 9; ++key) {
+    tree.insert(key, 10 * key);
+  }
+  ASSERT_EQ((std::vector<int> {3, 4, 5, 6}), collectKeys(tree.getRange(3, 6)));
+  ASSERT_TRUE(collectKeys(tree.getRange(10, 20)).empty());
+  ASSERT_EQ((std::vector<int> {3, 4, 5, 6, 7}), collectKeys(tree.getNeighbors(5, 2, 2)));
+  ASSERT_EQ((std::vector<int> {8, 9}), collectKeys(tree.getNeighbors(10, 2, 2)));
+  ASSERT_EQ((std::vector<int> {5, 6, 4, 7}), collectKeys(tree.getNearestNeighbors(5, 4)));
+  ASSERT_EQ((std::vector<int> {9, 8}), collectKeys(tree.getNearestNeighbors(20, 2)));
+  ASSERT_TRUE(collectKeys(SmallBlockTree().getNearestNeighbors(5, 4)).empty());
+}
@@ -0,0 +1,109 @@
+#include <map>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include "../../vst/avl_node.h"
+#include "../../vst/compact_avl_node.h"
+#include "../../vst/compact_avl_tree.h"
+#include "../../vst/compact_node_pool.h"
+#include "../../vst/inline_values.h"
+
+using namespace vst;
+
+typedef CompactAvlNode<int,int> CompactNode;
+
+TEST(CompactAvlNodeTest, TestSize) {
+  ASSERT_LT(sizeof(CompactNode), sizeof(AvlNode<int,int>));
+  ASSERT_EQ(40, (sizeof(CompactAvlNode<int, int, InlineValues<int>>)));
+}
+
+TEST(CompactAvlNodeTest, TestLinks) {
+  CompactNode::Pool pool;
+  CompactNode* const parent = pool.allocate();
+  CompactNode* const node = pool.allocate();
+  CompactNode* const lesser_child = pool.allocate();
+
+  ASSERT_EQ(parent, pool.getNode(CompactNode::Pool::getIndex(parent)));
+  ASSERT_EQ(node, CompactNode::Pool::getNode(parent, CompactNode::Pool::getIndex(node)));
+  ASSERT_EQ(nullptr, node->getLesserChild());
+  ASSERT_EQ(nullptr, node->getParent());
+  ASSERT_EQ(0, node->getHeight());
+
+  node->setHeight(CompactNode::MAX_HEIGHT);
+  node->setParent(parent)->setLesserChild(lesser_child)->setLesserNeighbor(lesser_child);
+  parent->setLesserChild(node)->setLesserNeighbor(node);
+  lesser_child->setParent(node)->setGreaterNeighbor(node)->setHeight(5);
+  ASSERT_EQ(CompactNode::MAX_HEIGHT, node->getHeight());
+  ASSERT_EQ(parent, node->getParent());
+  ASSERT_EQ(lesser_child, node->getLesserChild());
+  ASSERT_EQ(nullptr, node->getGreaterChild());
+  ASSERT_EQ(node, parent->getLesserNeighbor());
+  ASSERT_EQ(5, node->getMaxChildHeight());
+  ASSERT_EQ(6, node->getBalance());
+  ASSERT_TRUE(parent->isBranch());
+  ASSERT_TRUE(lesser_child->isLeaf());
+
+  node->setHeight(7);
+  ASSERT_EQ(lesser_child, node->getLesserChild());
+  node->setLesserChild(nullptr);
+  ASSERT_EQ(7, node->getHeight());
+
+  pool.deallocate(lesser_child);
+  ASSERT_EQ(lesser_child, pool.allocate());
+  pool.deallocate(lesser_child);
+  pool.deallocate(node);
+  pool.deallocate(parent);
+}
+
+TEST(CompactAvlNodeTest, TestPoolsAreIndependent) {
+  CompactNode::Pool pool;
+  CompactNode::Pool other_pool;
+  CompactNode* const node = pool.allocate();
+  CompactNode* const other_node = other_pool.allocate();
+  ASSERT_EQ(1, pool.getChunkCount());
+  ASSERT_EQ(1, other_pool.getChunkCount());
+
+  // each pool numbers its nodes from the start
+  ASSERT_EQ(CompactNode::Pool::getIndex(node), CompactNode::Pool::getIndex(other_node));
+  ASSERT_EQ(other_node, other_pool.getNode(CompactNode::Pool::getIndex(other_node)));
+  node->setGreaterNeighbor(pool.allocate());
+  ASSERT_EQ(pool.getNode(2), node->getGreaterNeighbor());
+
+  // the chunks follow the pool when it moves
+  CompactNode::Pool moved_pool(std::move(pool));
+  ASSERT_EQ(0, pool.getChunkCount());
+  ASSERT_EQ(moved_pool.getNode(2), node->getGreaterNeighbor());
+  CompactNode* const third_node = moved_pool.allocate();
+  ASSERT_EQ(3, CompactNode::Pool::getIndex(third_node));
+
+  moved_pool.release();
+  ASSERT_EQ(0, moved_pool.getChunkCount());
+}
+
+TEST(CompactAvlTreeTest, TestRandomInsertsAndRemoves) {
+  CompactAvlTree<int,int> tree;
+  std::multimap<int,int> expected;
+  std::mt19937 random(11);
+  for (int i = 0; i < 20000; ++i) {
+    int const key = random() % 5000;
+    if (random() % 3 == 0) {
+      ASSERT_EQ(expected.count(key) > 0, tree.remove(key));
+      expected.erase(key);
+    }
+    else {
+      tree.insert(key, i);
+      expected.emplace(key, i);
+    }
+  }
+  ASSERT_EQ(expected.size(), tree.getSize());
+  ASSERT_TRUE(tree.checkInvariants());
+
+  auto node = tree.getLeast();
+  for (auto iter = expected.begin(); iter != expected.end();
+       iter = expected.upper_bound(iter->first)) {
+    ASSERT_EQ(iter->first, node->getKey());
+    node = node->getGreaterNeighbor();
+  }
+  ASSERT_EQ(nullptr, node);
+}
@@ -0,0 +1,225 @@
+#include <atomic>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../../vst/concurrent_avl_tree.h"
+#include "../../vst/epoch.h"
+
+using namespace vst;
+
+TEST(EpochDomainTest, TestPinnedReadersHoldBackTheEpoch) {
+  EpochDomain domain;
+  ASSERT_EQ(0, domain.getEpoch());
+  ASSERT_TRUE(domain.tryAdvance());
+  ASSERT_EQ(1, domain.getEpoch());
+  {
+    EpochGuard const guard(domain);
+    // the reader announced the current epoch, which may advance once
+    ASSERT_TRUE(domain.tryAdvance());
+    ASSERT_FALSE(domain.tryAdvance());
+    ASSERT_EQ(2, domain.getEpoch());
+  }
+  ASSERT_TRUE(domain.tryAdvance());
+  ASSERT_EQ(3, domain.getEpoch());
+}
+
+TEST(ConcurrentAvlTreeTest, TestSingleThreaded) {
+  ConcurrentAvlTree<int, int> tree;
+  std::multimap<int, int> expected;
+  std::mt19937 random(5);
+  for (int i = 0; i < 5000; ++i) {
+    int const key = random() % 500;
+    int const value = random() % 4;
+    switch (random() % 4) {
+    case 0:
+      ASSERT_EQ(expected.count(key) > 0, tree.remove(key));
+      expected.erase(key);
+      break;
+    case 1: {
+      bool found = false;
+      auto const range = expected.equal_range(key);
+      for (auto iter = range.first; iter != range.second; ++iter) {
+        if (iter->second == value) {
+          expected.erase(iter);
+          found = true;
+          break;
+        }
+      }
+      ASSERT_EQ(found, tree.remove(key, value));
+      break;
+    }
+    case 2:
+      ASSERT_EQ(expected.count(key) == 0, tree.upsert(key, value));
+      expected.erase(key);
+      expected.emplace(key, value);
+      break;
+    default:
+      tree.insert(key, value);
+      expected.emplace(key, value);
+    }
+    ASSERT_TRUE(tree.checkInvariants());
+    ASSERT_EQ(expected.size(), tree.getSize());
+  }
+
+  auto const guard = tree.pin();
+  for (int key = -1; key <= 500; ++key) {
+    auto const node = tree.find(key);
+    ASSERT_EQ(expected.count(key), (node) ? node->getValues().size() : 0);
+    auto const lower = expected.lower_bound(key);
+    auto const gte = tree.findNearestGTE(key);
+    ASSERT_EQ(lower == expected.end(), gte == nullptr);
+    if (gte) {
+      ASSERT_EQ(lower->first, gte->getKey());
+    }
+  }
+
+  auto iter = tree.getRange(100, 200);
+  int previous = 99;
+  while (iter->hasNext()) {
+    int const key = iter->next()->getKey();
+    ASSERT_LT(previous, key);
+    ASSERT_LE(key, 200);
+    ASSERT_TRUE(expected.count(key));
+    previous = key;
+  }
+  delete iter;
+}
+
+TEST(ConcurrentAvlTreeTest, TestRemovedNodesOutliveReaders) {
+  ConcurrentAvlTree<int, int> tree;
+  for (int key = 0; key < 1000; ++key) {
+    tree.insert(key, key);
+  }
+  {
+    auto const guard = tree.pin();
+    auto const node = tree.find(500);
+    for (int key = 0; key < 1000; key += 2) {
+      tree.remove(key);
+    }
+    ASSERT_EQ(500, tree.getRetiredCount());
+    // the removed node still leads back into the tree
+    ASSERT_EQ(501, node->getGreaterNeighbor()->getKey());
+    ASSERT_EQ(499, node->getLesserNeighbor()->getKey());
+  }
+  for (int i = 0; i < 3; ++i) {
+    tree.collect();
+  }
+  ASSERT_EQ(0, tree.getRetiredCount());
+  ASSERT_TRUE(tree.checkInvariants());
+}
+
+TEST(ConcurrentAvlTreeTest, TestReadersDuringWrites) {
+  // even keys stay in the tree while the writer churns the odd ones
+  int const key_count = 2000;
+  ConcurrentAvlTree<int, int> tree;
+  for (int key = 0; key < key_count; key += 2) {
+    tree.insert(key, key);
+  }
+
+  std::atomic<bool> done(false);
+  std::atomic<int> failures(0);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 4; ++r) {
+    readers.emplace_back([&, r]() {
+      std::mt19937 random(r);
+      while (!done.load()) {
+        auto const guard = tree.pin();
+        int const key = 2 * int(random() % (key_count / 2));
+        auto const node = tree.find(key);
+        if (!node || node->getValue() != key) failures += 1;
+        auto const gte = tree.findNearestGTE(key - 1);
+        if (!gte || gte->getKey() < key - 1 || gte->getKey() > key) failures += 1;
+        auto const lte = tree.findNearestLTE(key + 1);
+        if (!lte || lte->getKey() < key || lte->getKey() > key + 1) failures += 1;
+
+        auto iter = tree.getRange(key, key + 40);
+        int expected_key = key;
+        int previous = key - 1;
+        while (iter->hasNext()) {
+          int const next_key = iter->next()->getKey();
+          if (next_key <= previous) failures += 1;
+          if (next_key % 2 == 0) {
+            if (next_key != expected_key) failures += 1;
+            expected_key += 2;
+          }
+          previous = next_key;
+        }
+        delete iter;
+        if (expected_key != std::min(key + 42, key_count)) failures += 1;
+      }
+    });
+  }
+
+  std::mt19937 random(42);
+  for (int i = 0; i < 200000; ++i) {
+    int const key = 2 * int(random() % (key_count / 2)) + 1;
+    if (random() % 2) {
+      tree.insert(key, key);
+    }
+    else {
+      tree.remove(key);
+    }
+  }
+  done = true;
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+
+  ASSERT_EQ(0, failures.load());
+  ASSERT_TRUE(tree.checkInvariants());
+}
+
+TEST(ConcurrentAvlTreeTest, TestReadersDuringValueRemovals) {
+  // the writer adds and removes the values of the odd keys one at a time
+  int const key_count = 2000;
+  ConcurrentAvlTree<int, int> tree;
+  for (int key = 0; key < key_count; key += 2) {
+    tree.insert(key, key);
+  }
+
+  std::atomic<bool> done(false);
+  std::atomic<int> failures(0);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 4; ++r) {
+    readers.emplace_back([&, r]() {
+      std::mt19937 random(r);
+      while (!done.load()) {
+        auto const guard = tree.pin();
+        int const key = int(random() % key_count);
+        auto iter = tree.getRange(key, key + 20);
+        while (iter->hasNext()) {
+          auto const node = iter->next();
+          auto const& values = node->getValues();
+          if (values.empty() || values.size() > 2) failures += 1;
+          for (int const value : values) {
+            if (value != node->getKey() && value != -node->getKey()) failures += 1;
+          }
+        }
+        delete iter;
+      }
+    });
+  }
+
+  std::mt19937 random(42);
+  for (int i = 0; i < 200000; ++i) {
+    int const key = 2 * int(random() % (key_count / 2)) + 1;
+    int const value = (random() % 2) ? key : -key;
+    if (random() % 2) {
+      if (!tree.remove(key, value)) tree.insert(key, value);
+    }
+    else {
+      tree.remove(key, value);
+    }
+  }
+  done = true;
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+
+  ASSERT_EQ(0, failures.load());
+  ASSERT_TRUE(tree.checkInvariants());
+}
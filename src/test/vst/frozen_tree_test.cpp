@@ -0,0 +1,129 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../../vst/avl_node.h"
+#include "../../vst/avl_tree.h"
+#include "../../vst/frozen_tree.h"
+
+using namespace vst;
+
+typedef AvlTree<int, int, AvlNode<int,int>> LiveTree;
+typedef FrozenTree<int, int> FrozenIntTree;
+
+template <class ElementType>
+static std::vector<int> collectKeys(Iterator<ElementType>* const iter) {
+  std::vector<int> keys;
+  while (iter->hasNext()) {
+    ElementType const element = iter->next();
+    if constexpr (std::is_pointer_v<ElementType>) {
+      keys.push_back(element->getKey());
+    }
+    else {
+      keys.push_back(element.getKey());
+    }
+  }
+  delete iter;
+  return keys;
+}
+
+TEST(FrozenTreeTest, EmptySnapshotShouldBeEmpty) {
+  LiveTree tree;
+  FrozenIntTree const frozen = tree.freeze();
+  ASSERT_TRUE(frozen.checkInvariants());
+  ASSERT_EQ(0, frozen.getSize());
+  ASSERT_FALSE(frozen.getLeast());
+  ASSERT_FALSE(frozen.getGreatest());
+  ASSERT_FALSE(frozen.find(1));
+  ASSERT_FALSE(frozen.findNearestGTE(1));
+  ASSERT_FALSE(frozen.findNearestLTE(1));
+  ASSERT_TRUE(collectKeys(frozen.getRange(0, 10)).empty());
+  ASSERT_TRUE(collectKeys(frozen.getNeighbors(0, 2, 2)).empty());
+  ASSERT_TRUE(collectKeys(frozen.getNearestNeighbors(0, 2)).empty());
+}
+
+TEST(FrozenTreeTest, TestValuesAndVine) {
+  LiveTree tree;
+  for (int key : {5, 1, 3, 9, 7}) {
+    tree.insert(key, 10 * key);
+  }
+  tree.insert(3, 31);
+  FrozenIntTree const frozen = tree.freeze();
+  tree.insert(4, 40);
+  ASSERT_TRUE(frozen.checkInvariants());
+  ASSERT_EQ(6, frozen.getSize());
+  ASSERT_EQ(5, frozen.getKeyCount());
+
+  FrozenIntTree::Entry entry = frozen.find(3);
+  ASSERT_TRUE(entry);
+  ASSERT_EQ(30, entry.getValue());
+  ASSERT_EQ((std::vector<int>{30, 31}),
+            std::vector<int>(entry.getValues().begin(), entry.getValues().end()));
+  ASSERT_FALSE(frozen.find(4));
+  ASSERT_EQ(1, entry.getLesserNeighbor().getKey());
+  ASSERT_EQ(5, entry.getGreaterNeighbor().getKey());
+  ASSERT_FALSE(frozen.getLeast().getLesserNeighbor());
+  ASSERT_FALSE(frozen.getGreatest().getGreaterNeighbor());
+  ASSERT_EQ(2, frozen.rank(4));
+  ASSERT_EQ(1, frozen.findNearestLT(3).getKey());
+  ASSERT_EQ(5, frozen.findNearestGT(3).getKey());
+}
+
+TEST(FrozenTreeTest, TestQueriesMatchLiveTree) {
+  // keys are multiples of 4, so no two keys are equally distant from an odd
+  // query
+  std::mt19937 random(42);
+  for (int size : {1, 2, 3, 5, 6, 7, 8, 15, 16, 33, 100, 1000}) {
+    LiveTree tree;
+    while (int(tree.getSize()) < size) {
+      int const key = 4 * int(random() % (8 * size));
+      if (!tree.containsKey(key)) tree.insert(key, key);
+    }
+    FrozenIntTree const frozen = tree.freeze();
+    ASSERT_TRUE(frozen.checkInvariants());
+    ASSERT_EQ(tree.getLeast()->getKey(), frozen.getLeast().getKey());
+    ASSERT_EQ(tree.getGreatest()->getKey(), frozen.getGreatest().getKey());
+
+    for (int query = -5; query < 32 * size + 5; ++query) {
+      ASSERT_EQ(tree.containsKey(query), frozen.containsKey(query));
+
+      auto const gte = tree.findNearestGTE(query);
+      ASSERT_EQ(gte != nullptr, static_cast<bool>(frozen.findNearestGTE(query)));
+      if (gte) {
+        ASSERT_EQ(gte->getKey(), frozen.findNearestGTE(query).getKey());
+      }
+
+      auto const lte = tree.findNearestLTE(query);
+      ASSERT_EQ(lte != nullptr, static_cast<bool>(frozen.findNearestLTE(query)));
+      if (lte) {
+        ASSERT_EQ(lte->getKey(), frozen.findNearestLTE(query).getKey());
+      }
+
+      ASSERT_EQ(collectKeys(tree.getRange(query, query + 20)),
+                collectKeys(frozen.getRange(query, query + 20)));
+      ASSERT_EQ(collectKeys(tree.getNeighbors(query, 2, 3)),
+                collectKeys(frozen.getNeighbors(query, 2, 3)));
+      ASSERT_EQ(collectKeys(tree.getNeighbors(query, 0, 0)),
+                collectKeys(frozen.getNeighbors(query, 0, 0)));
+      if (query % 2 != 0) {
+        ASSERT_EQ(collectKeys(tree.getNearestNeighbors(query, 5)),
+                  collectKeys(frozen.getNearestNeighbors(query, 5)));
+      }
+    }
+  }
+}
+
+TEST(FrozenTreeTest, TestStringKeys) {
+  AvlTree<std::string, int, AvlNode<std::string, int>> tree;
+  for (char const* key : {"pear", "apple", "fig", "kiwi", "date"}) {
+    tree.insert(key, 1);
+  }
+  auto const frozen = tree.freeze();
+  ASSERT_TRUE(frozen.checkInvariants());
+  ASSERT_TRUE(frozen.containsKey("fig"));
+  ASSERT_FALSE(frozen.containsKey("grape"));
+  ASSERT_EQ("kiwi", frozen.findNearestGTE("grape").getKey());
+  ASSERT_EQ("fig", frozen.findNearestLTE("grape").getKey());
+}
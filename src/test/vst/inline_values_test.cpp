@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include "../../vst/avl_node.h"
+#include "../../vst/avl_tree.h"
+#include "../../vst/inline_values.h"
+
+using namespace vst;
+
+TEST(InlineValuesTest, NewValuesShouldBeEmpty) {
+  InlineValues<int> values;
+  ASSERT_TRUE(values.empty());
+  ASSERT_EQ(0, values.size());
+  ASSERT_EQ(values.begin(), values.end());
+}
+
+TEST(InlineValuesTest, TestFirstValueIsInline) {
+  InlineValues<int> values;
+  values.push_back(42);
+  ASSERT_TRUE(values.isInline());
+  ASSERT_EQ(1, values.size());
+  ASSERT_EQ(42, values.front());
+}
+
+TEST(InlineValuesTest, TestDuplicatesSpillToHeap) {
+  InlineValues<int> values;
+  for (int i = 0; i < 9; ++i) {
+    values.push_back(i);
+  }
+  ASSERT_FALSE(values.isInline());
+  ASSERT_EQ(9, values.size());
+  int expected = 0;
+  for (int const value : values) {
+    ASSERT_EQ(expected, value);
+    expected += 1;
+  }
+
+  values.erase(values.begin() + 3);
+  ASSERT_EQ(8, values.size());
+  ASSERT_EQ(4, values[3]);
+  ASSERT_EQ(8, values[7]);
+
+  while (!values.empty()) {
+    values.erase(values.begin());
+  }
+  values.push_back(7);
+  ASSERT_EQ(1, values.size());
+  ASSERT_EQ(7, values.front());
+}
+
+TEST(InlineValuesTest, TestCopyAndMove) {
+  InlineValues<int> values;
+  values.push_back(1);
+  values.push_back(2);
+  values.push_back(3);
+
+  InlineValues<int> copy(values);
+  ASSERT_EQ(3, copy.size());
+  ASSERT_EQ(3, copy[2]);
+  ASSERT_NE(values.begin(), copy.begin());
+
+  InlineValues<int> moved(std::move(copy));
+  ASSERT_EQ(3, moved.size());
+  ASSERT_EQ(2, moved[1]);
+  ASSERT_TRUE(copy.empty());
+}
+
+TEST(InlineValuesTest, TestAvlTree) {
+  typedef AvlNode<int, int, InlineValues<int>> NodeType;
+  AvlTree<int, int, NodeType> tree;
+  for (int key = 0; key < 100; ++key) {
+    tree.insert(key, key);
+  }
+  tree.insert(5, 50)->insert(5, 500);
+  ASSERT_EQ(102, tree.getSize());
+  ASSERT_TRUE(tree.find(4)->getValues().isInline());
+  ASSERT_EQ(3, tree.find(5)->getValues().size());
+  ASSERT_TRUE(tree.remove(5, 50));
+  ASSERT_EQ(500, tree.find(5)->getValues()[1]);
+  ASSERT_TRUE(tree.checkInvariants());
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../../vst/block_tree.h"
+#include "../../vst/key_search.h"
+
+using namespace vst;
+
+template <class KeyType>
+void assertBoundsMatchStd(std::vector<KeyType> const& keys) {
+  std::uint32_t const count = keys.size();
+  KeyType const* const data = keys.data();
+  std::vector<KeyType> queries(keys);
+  queries.push_back(KeyType(0));
+  queries.push_back(std::numeric_limits<KeyType>::lowest());
+  queries.push_back(std::numeric_limits<KeyType>::max());
+  for (KeyType const key : keys) {
+    queries.push_back(KeyType(key + 1));
+    queries.push_back(KeyType(key - 1));
+  }
+  for (KeyType const key : queries) {
+    std::uint32_t const lower = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+    std::uint32_t const upper = std::upper_bound(keys.begin(), keys.end(), key) - keys.begin();
+    ASSERT_EQ(lower, KeySearch<KeyType>::lowerBound(data, count, key));
+    ASSERT_EQ(upper, KeySearch<KeyType>::upperBound(data, count, key));
+  }
+}
+
+template <class KeyType>
+void assertBoundsMatchStd() {
+  std::mt19937 random(42);
+  for (std::uint32_t count = 0; count <= 70; ++count) {
+    std::vector<KeyType> keys(count);
+    for (KeyType& key : keys) {
+      // few distinct keys, so that there are duplicates, and both signs
+      key = KeyType(long(random() % 64) - 16);
+    }
+    std::sort(keys.begin(), keys.end());
+    assertBoundsMatchStd(keys);
+  }
+
+  // spans the window within which the keys are counted
+  std::vector<KeyType> keys(1000);
+  for (std::uint32_t i = 0; i < keys.size(); ++i) {
+    keys[i] = KeyType(i / 3);
+  }
+  assertBoundsMatchStd(keys);
+}
+
+TEST(KeySearchTest, TestArithmeticKeys) {
+  ASSERT_TRUE(KeySearch<std::int32_t>::VECTORIZED);
+  ASSERT_TRUE(KeySearch<std::uint64_t>::VECTORIZED);
+  ASSERT_TRUE(KeySearch<double>::VECTORIZED);
+  ASSERT_FALSE(KeySearch<std::int16_t>::VECTORIZED);
+  assertBoundsMatchStd<std::int32_t>();
+  assertBoundsMatchStd<std::uint32_t>();
+  assertBoundsMatchStd<std::int64_t>();
+  assertBoundsMatchStd<std::uint64_t>();
+  assertBoundsMatchStd<float>();
+  assertBoundsMatchStd<double>();
+  assertBoundsMatchStd<std::int16_t>();
+}
+
+TEST(KeySearchTest, TestUnsignedKeysAcrossSignBit) {
+  std::vector<std::uint32_t> keys = {0, 1, 0x7fffffffu, 0x80000000u, 0x80000001u,
+                                     0xfffffffeu, 0xffffffffu, 0xffffffffu,
+                                     0xffffffffu};
+  assertBoundsMatchStd(keys);
+  ASSERT_EQ(3u, KeySearch<std::uint32_t>::lowerBound(keys.data(), keys.size(), 0x80000000u));
+  ASSERT_EQ(6u, KeySearch<std::uint32_t>::upperBound(keys.data(), keys.size(), 0xfffffffeu));
+}
+
+TEST(KeySearchTest, TestScalarCountMatchesDispatch) {
+  std::vector<std::int64_t> keys(67);
+  for (std::uint32_t i = 0; i < keys.size(); ++i) {
+    keys[i] = 2 * i;
+  }
+  for (std::int64_t key = -1; key <= 135; ++key) {
+    for (bool const or_equal : {false, true}) {
+      ASSERT_EQ(
+        KeySearch<std::int64_t>::countScalar(keys.data(), keys.size(), key, or_equal),
+        KeySearch<std::int64_t>::count(keys.data(), keys.size(), key, or_equal));
+    }
+  }
+}
+
+TEST(KeySearchTest, TestNonArithmeticKeys) {
+  std::vector<std::string> keys = {"a", "b", "b", "d"};
+  ASSERT_FALSE(KeySearch<std::string>::VECTORIZED);
+  ASSERT_EQ(1u, KeySearch<std::string>::lowerBound(keys.data(), keys.size(), "b"));
+  ASSERT_EQ(3u, KeySearch<std::string>::upperBound(keys.data(), keys.size(), "b"));
+  ASSERT_EQ(3u, KeySearch<std::string>::lowerBound(keys.data(), keys.size(), "c"));
+  ASSERT_EQ(4u, KeySearch<std::string>::upperBound(keys.data(), keys.size(), "e"));
+}
+
+TEST(KeySearchTest, TestBlockTreeLookups) {
+  BlockTree<double, int, 16> tree;
+  for (int i = 0; i < 500; ++i) {
+    tree.insert(0.5 * (i % 250), i);
+  }
+  ASSERT_TRUE(tree.checkInvariants());
+  for (int i = 0; i < 250; ++i) {
+    double const key = 0.5 * i;
+    ASSERT_TRUE(tree.containsKey(key));
+    ASSERT_EQ(key, tree.findNearestGTE(key - 0.25).getKey());
+    ASSERT_EQ(key, tree.findNearestLTE(key + 0.25).getKey());
+    if (i + 1 < 250) {
+      ASSERT_EQ(key + 0.5, tree.findNearestGT(key).getKey());
+    }
+    ASSERT_FALSE(tree.containsKey(key + 0.25));
+  }
+}
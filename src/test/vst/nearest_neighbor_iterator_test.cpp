@@ -49,10 +49,11 @@ protected:
 };
 
 TEST_F(NearestNeighborIteratorTest, TestNearestNeighbor) {
-  NearestNeighborIterator<AvlNode<int,int>, int>* iter;
+  typedef std::function<double (int,int)> Distance;
+  NearestNeighborIterator<AvlNode<int,int>*, int, Distance>* iter;
 
-  iter = new NearestNeighborIterator<AvlNode<int,int>, int>();
-  iter->setKey(3)->setDistance(distance)->setLimit(3)->setNode(fourth);
+  iter = new NearestNeighborIterator<AvlNode<int,int>*, int, Distance>();
+  iter->setKey(3)->setDistance(distance)->setLimit(3)->setCursor(fourth);
   ASSERT_TRUE(iter->hasNext());
   ASSERT_EQ(third, iter->next());
   ASSERT_TRUE(iter->hasNext());
@@ -62,3 +63,22 @@ TEST_F(NearestNeighborIteratorTest, TestNearestNeighbor) {
   ASSERT_FALSE(iter->hasNext());
   delete iter;
 }
+
+TEST_F(NearestNeighborIteratorTest, TestAbsoluteDifference) {
+  auto iter = new NearestNeighborIterator<AvlNode<int,int>*, int>();
+  iter->setKey(5)->setLimit(2)->setCursor(first);
+  ASSERT_TRUE(iter->hasNext());
+  ASSERT_EQ(fifth, iter->next());
+  ASSERT_TRUE(iter->hasNext());
+  ASSERT_EQ(fourth, iter->next());
+  ASSERT_FALSE(iter->hasNext());
+  delete iter;
+
+  ASSERT_EQ(3.0, AbsoluteDifference<unsigned int>()(2u, 5u));
+  ASSERT_EQ(3.0, AbsoluteDifference<unsigned int>()(5u, 2u));
+}
+
+TEST(NewNearestNeighborIteratorTest, NewIteratorShouldBeEmpty) {
+  NearestNeighborIterator<AvlNode<int,int>*, int> iter;
+  ASSERT_FALSE(iter.hasNext());
+}
@@ -0,0 +1,79 @@
+#include <map>
+#include <memory_resource>
+#include <random>
+
+#include <gtest/gtest.h>
+
+#include "../../vst/avl_node.h"
+#include "../../vst/avl_tree.h"
+#include "../../vst/node_allocator.h"
+
+using namespace vst;
+
+TEST(PoolNodeAllocatorTest, TestChunks) {
+  PoolNodeAllocator<AvlNode<int,int>, 4> allocator;
+  ASSERT_EQ(0, allocator.getChunkCount());
+
+  AvlNode<int,int>* nodes[5];
+  for (int i = 0; i < 5; ++i) {
+    nodes[i] = allocator.allocate();
+    ASSERT_EQ(nullptr, nodes[i]->getLesserChild());
+    ASSERT_EQ(0, nodes[i]->getHeight());
+  }
+  ASSERT_EQ(2, allocator.getChunkCount());
+  ASSERT_EQ(sizeof(AvlNode<int,int>),
+    reinterpret_cast<char*>(nodes[1]) - reinterpret_cast<char*>(nodes[0]));
+
+  for (int i = 0; i < 5; ++i) {
+    allocator.deallocate(nodes[i]);
+  }
+}
+
+TEST(PoolNodeAllocatorTest, TestFreedNodesAreReused) {
+  PoolNodeAllocator<AvlNode<int,int>, 4> allocator;
+  AvlNode<int,int>* const node = allocator.allocate();
+  node->setKey(3)->addValue(4);
+  allocator.deallocate(node);
+
+  AvlNode<int,int>* const reused = allocator.allocate();
+  ASSERT_EQ(node, reused);
+  ASSERT_TRUE(reused->getValues().empty());
+  ASSERT_EQ(1, allocator.getChunkCount());
+  allocator.deallocate(reused);
+
+  allocator.release();
+  ASSERT_EQ(0, allocator.getChunkCount());
+}
+
+template <class TreeType>
+void insertAndRemove(TreeType& tree) {
+  std::multimap<int,int> expected;
+  std::mt19937 random(7);
+  for (int i = 0; i < 3000; ++i) {
+    int const key = random() % 400;
+    if (random() % 3 == 0) {
+      ASSERT_EQ(expected.count(key) > 0, tree.remove(key));
+      expected.erase(key);
+    }
+    else {
+      tree.insert(key, i);
+      expected.emplace(key, i);
+    }
+  }
+  ASSERT_EQ(expected.size(), tree.getSize());
+  ASSERT_TRUE(tree.checkInvariants());
+}
+
+TEST(PoolNodeAllocatorTest, TestAvlTree) {
+  AvlTree<int, int, AvlNode<int,int>, ThreeWayCompare<int>,
+    PoolNodeAllocator<AvlNode<int,int>, 64>> tree;
+  insertAndRemove(tree);
+}
+
+TEST(PmrNodeAllocatorTest, TestAvlTree) {
+  std::pmr::monotonic_buffer_resource resource;
+  AvlTree<int, int, AvlNode<int,int>, ThreeWayCompare<int>,
+    PmrNodeAllocator<AvlNode<int,int>>> tree{
+      ThreeWayCompare<int>(), PmrNodeAllocator<AvlNode<int,int>>(&resource)};
+  insertAndRemove(tree);
+}
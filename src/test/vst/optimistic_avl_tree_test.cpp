@@ -0,0 +1,328 @@
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../../vst/optimistic_avl_tree.h"
+
+using namespace vst;
+
+typedef OptimisticAvlTree<int, int> IntOptimisticTree;
+
+TEST(OptimisticAvlTreeTest, TestLookups) {
+  IntOptimisticTree tree;
+  ASSERT_TRUE(tree.checkInvariants());
+  for (int key : {50, 10, 400, 250, 260}) {
+    tree.insert(key, key);
+  }
+  tree.insert(50, 51);
+  ASSERT_TRUE(tree.checkInvariants());
+  ASSERT_EQ(6, tree.getSize());
+
+  auto const guard = tree.pin();
+  ASSERT_EQ(2, tree.find(50).getValues().size());
+  ASSERT_FALSE(tree.containsKey(100));
+  ASSERT_EQ(10, tree.getLeast().getKey());
+  ASSERT_EQ(400, tree.getGreatest().getKey());
+  ASSERT_EQ(250, tree.findNearestGTE(60).getKey());
+  ASSERT_EQ(50, tree.findNearestLTE(240).getKey());
+  ASSERT_EQ(250, tree.findNearestLTE(250).getKey());
+  ASSERT_FALSE(tree.findNearestGTE(401));
+  ASSERT_FALSE(tree.findNearestLTE(9));
+
+  std::vector<int> keys;
+  auto iter = tree.getRange(20, 400);
+  while (iter->hasNext()) {
+    keys.push_back(iter->next().getKey());
+  }
+  delete iter;
+  ASSERT_EQ((std::vector<int>{50, 250, 260, 400}), keys);
+
+  keys.clear();
+  auto neighbors = tree.getNearestNeighbors(254, 3);
+  while (neighbors->hasNext()) {
+    keys.push_back(neighbors->next().getKey());
+  }
+  delete neighbors;
+  ASSERT_EQ((std::vector<int>{250, 260, 400}), keys);
+
+  ASSERT_FALSE(tree.upsert(50, 52));
+  ASSERT_EQ(1, tree.find(50).getValues().size());
+  ASSERT_TRUE(tree.upsert(60, 60));
+  ASSERT_TRUE(tree.remove(250));
+  ASSERT_FALSE(tree.remove(250));
+  ASSERT_TRUE(tree.remove(50, 52));
+  ASSERT_FALSE(tree.remove(50, 52));
+  ASSERT_EQ(4, tree.getSize());
+  ASSERT_TRUE(tree.checkInvariants());
+}
+
+TEST(OptimisticAvlTreeTest, TestAgainstMap) {
+  IntOptimisticTree tree;
+  std::map<int, std::vector<int>> expected;
+  std::mt19937 random(7);
+  for (int i = 0; i < 20000; ++i) {
+    int const key = random() % 500;
+    int const value = random() % 4;
+    switch (random() % 4) {
+      case 0:
+        tree.insert(key, value);
+        expected[key].push_back(value);
+        break;
+      case 1:
+        ASSERT_EQ(!expected.count(key), tree.upsert(key, value));
+        expected[key] = {value};
+        break;
+      case 2:
+        ASSERT_EQ(expected.erase(key) > 0, tree.remove(key));
+        break;
+      default: {
+        auto const found = expected.find(key);
+        bool removed = false;
+        if (found != expected.end()) {
+          auto const iter = std::find(found->second.begin(), found->second.end(), value);
+          if (iter != found->second.end()) {
+            found->second.erase(iter);
+            if (found->second.empty()) expected.erase(found);
+            removed = true;
+          }
+        }
+        ASSERT_EQ(removed, tree.remove(key, value));
+      }
+    }
+    if (i % 1000 == 0) {
+      ASSERT_TRUE(tree.checkInvariants());
+    }
+  }
+  ASSERT_TRUE(tree.checkInvariants());
+
+  std::size_t size = 0;
+  for (auto const& entry : expected) {
+    size += entry.second.size();
+  }
+  ASSERT_EQ(size, tree.getSize());
+
+  auto const guard = tree.pin();
+  auto iter = tree.getRange(-1, 500);
+  for (auto const& entry : expected) {
+    ASSERT_TRUE(iter->hasNext());
+    auto const next = iter->next();
+    ASSERT_EQ(entry.first, next.getKey());
+    ASSERT_EQ(entry.second, next.getValues());
+  }
+  ASSERT_FALSE(iter->hasNext());
+  delete iter;
+
+  for (int key = -1; key <= 500; ++key) {
+    auto const gte = expected.lower_bound(key);
+    auto const entry = tree.findNearestGTE(key);
+    ASSERT_EQ(gte != expected.end(), static_cast<bool>(entry));
+    if (entry) {
+      ASSERT_EQ(gte->first, entry.getKey());
+    }
+    auto const lte = expected.upper_bound(key);
+    auto const lesser = tree.findNearestLTE(key);
+    ASSERT_EQ(lte != expected.begin(), static_cast<bool>(lesser));
+    if (lesser) {
+      ASSERT_EQ(std::prev(lte)->first, lesser.getKey());
+    }
+  }
+}
+
+TEST(OptimisticAvlTreeTest, TestConcurrentWriters) {
+  int const key_count = 20000;
+  IntOptimisticTree tree;
+
+  // each writer owns the keys congruent to its index, and ends up keeping
+  // those divisible by 3
+  unsigned int const writer_count = 4;
+  std::atomic<bool> done(false);
+  std::atomic<int> failures(0);
+  std::thread reader([&]() {
+    while (!done.load()) {
+      auto const guard = tree.pin();
+      int previous = -1;
+      auto iter = tree.getRange(0, key_count);
+      while (iter->hasNext()) {
+        int const key = iter->next().getKey();
+        if (key <= previous) failures += 1;
+        previous = key;
+      }
+      delete iter;
+    }
+  });
+
+  std::vector<std::thread> writers;
+  for (unsigned int w = 0; w < writer_count; ++w) {
+    writers.emplace_back([&, w]() {
+      for (int round = 0; round < 3; ++round) {
+        for (int key = w; key < key_count; key += writer_count) {
+          tree.insert(key, key);
+        }
+        for (int key = w; key < key_count; key += writer_count) {
+          if (key % 3 != 0 && !tree.remove(key)) failures += 1;
+        }
+      }
+    });
+  }
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+  done = true;
+  reader.join();
+
+  ASSERT_EQ(0, failures.load());
+  ASSERT_TRUE(tree.checkInvariants());
+  std::set<int> keys;
+  {
+    auto const guard = tree.pin();
+    auto iter = tree.getRange(0, key_count);
+    while (iter->hasNext()) {
+      auto const entry = iter->next();
+      ASSERT_EQ(3, entry.getValues().size());
+      keys.insert(entry.getKey());
+    }
+    delete iter;
+  }
+  ASSERT_EQ((key_count + 2) / 3, keys.size());
+  ASSERT_EQ(3 * keys.size(), tree.getSize());
+  for (int const key : keys) {
+    ASSERT_EQ(0, key % 3);
+  }
+}
+
+TEST(OptimisticAvlTreeTest, TestConcurrentValueRemovals) {
+  int const key_count = 8000;
+  IntOptimisticTree tree;
+
+  // each writer owns the keys congruent to its index, adding two values to
+  // each and removing them one at a time, and ends up keeping the value of
+  // the keys divisible by 3
+  unsigned int const writer_count = 4;
+  std::atomic<bool> done(false);
+  std::atomic<int> failures(0);
+  std::thread reader([&]() {
+    while (!done.load()) {
+      auto const guard = tree.pin();
+      auto iter = tree.getRange(0, key_count);
+      while (iter->hasNext()) {
+        auto const entry = iter->next();
+        auto const& values = entry.getValues();
+        if (values.empty()) failures += 1;
+        for (int const value : values) {
+          if (value != entry.getKey() && value != -entry.getKey()) failures += 1;
+        }
+      }
+      delete iter;
+    }
+  });
+
+  std::vector<std::thread> writers;
+  for (unsigned int w = 0; w < writer_count; ++w) {
+    writers.emplace_back([&, w]() {
+      for (int round = 0; round < 3; ++round) {
+        for (int key = w; key < key_count; key += writer_count) {
+          tree.insert(key, key);
+          tree.insert(key, -key);
+        }
+        for (int key = w; key < key_count; key += writer_count) {
+          if (!tree.remove(key, -key)) failures += 1;
+          if (key % 3 != 0 && !tree.remove(key, key)) failures += 1;
+        }
+      }
+    });
+  }
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+  done = true;
+  reader.join();
+
+  ASSERT_EQ(0, failures.load());
+  ASSERT_TRUE(tree.checkInvariants());
+  ASSERT_EQ(3 * ((key_count + 2) / 3), tree.getSize());
+}
+
+TEST(OptimisticAvlTreeTest, TestScansDuringContendedWrites) {
+  int const key_count = 4000;
+  IntOptimisticTree tree;
+  // the multiples of 10 stay put, so every scan must see all of them
+  for (int key = 0; key < key_count; key += 10) {
+    tree.insert(key, -1);
+  }
+
+  // the writers share every other key, each adding and removing a value of
+  // its own, and end up keeping their values of the keys divisible by 4
+  unsigned int const writer_count = 4;
+  std::atomic<bool> done(false);
+  std::atomic<int> failures(0);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 2; ++r) {
+    readers.emplace_back([&]() {
+      while (!done.load()) {
+        auto const guard = tree.pin();
+        int previous = -1;
+        int stable = 0;
+        auto iter = tree.getRange(0, key_count);
+        while (iter->hasNext()) {
+          int const key = iter->next().getKey();
+          if (key <= previous) failures += 1;
+          if (key % 10 == 0) stable += 1;
+          previous = key;
+        }
+        delete iter;
+        if (stable != key_count / 10) failures += 1;
+      }
+    });
+  }
+
+  std::vector<std::thread> writers;
+  for (unsigned int w = 0; w < writer_count; ++w) {
+    writers.emplace_back([&, w]() {
+      std::mt19937 random(w);
+      for (int round = 0; round < 4; ++round) {
+        std::vector<int> keys;
+        for (int key = 0; key < key_count; key += 2) {
+          if (key % 10 != 0) keys.push_back(key);
+        }
+        std::shuffle(keys.begin(), keys.end(), random);
+        for (int const key : keys) {
+          tree.insert(key, int(w));
+        }
+        std::shuffle(keys.begin(), keys.end(), random);
+        for (int const key : keys) {
+          if (key % 4 != 0 && !tree.remove(key, int(w))) failures += 1;
+        }
+      }
+    });
+  }
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+  done = true;
+  for (std::thread& reader : readers) {
+    reader.join();
+  }
+
+  ASSERT_EQ(0, failures.load());
+  ASSERT_TRUE(tree.checkInvariants());
+  auto const guard = tree.pin();
+  for (int key = 0; key < key_count; key += 2) {
+    auto const entry = tree.find(key);
+    if (key % 10 == 0) {
+      ASSERT_EQ(1, entry.getValues().size());
+    }
+    else if (key % 4 == 0) {
+      std::multiset<int> const values(entry.getValues().begin(), entry.getValues().end());
+      ASSERT_EQ((std::multiset<int>{0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3}), values);
+    }
+    else {
+      ASSERT_FALSE(entry);
+    }
+  }
+}
@@ -0,0 +1,134 @@
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../../vst/avl_node.h"
+#include "../../vst/avl_tree.h"
+#include "../../vst/packed_frozen_tree.h"
+
+using namespace vst;
+
+template <class KeyType, std::uint32_t BlockSize>
+void assertPackedMatchesFrozen(AvlTree<KeyType, int, AvlNode<KeyType, int>> const& tree,
+                               std::vector<KeyType> const& queries) {
+  auto const frozen = tree.freeze();
+  auto const packed = tree.template freezePacked<BlockSize>();
+  ASSERT_TRUE(packed.checkInvariants());
+  ASSERT_EQ(frozen.getSize(), packed.getSize());
+  ASSERT_EQ(frozen.getKeyCount(), packed.getKeyCount());
+
+  for (KeyType const query : queries) {
+    ASSERT_EQ(frozen.containsKey(query), packed.containsKey(query));
+
+    auto const gte = frozen.findNearestGTE(query);
+    ASSERT_EQ(static_cast<bool>(gte), static_cast<bool>(packed.findNearestGTE(query)));
+    if (gte) {
+      ASSERT_EQ(gte.getPosition(), packed.findNearestGTE(query).getPosition());
+      ASSERT_EQ(gte.getKey(), packed.findNearestGTE(query).getKey());
+      ASSERT_EQ(gte.getValue(), packed.findNearestGTE(query).getValue());
+    }
+
+    auto const lte = frozen.findNearestLTE(query);
+    ASSERT_EQ(static_cast<bool>(lte), static_cast<bool>(packed.findNearestLTE(query)));
+    if (lte) {
+      ASSERT_EQ(lte.getKey(), packed.findNearestLTE(query).getKey());
+    }
+
+    auto const gt = frozen.findNearestGT(query);
+    ASSERT_EQ(static_cast<bool>(gt), static_cast<bool>(packed.findNearestGT(query)));
+    if (gt) {
+      ASSERT_EQ(gt.getKey(), packed.findNearestGT(query).getKey());
+    }
+  }
+}
+
+TEST(PackedFrozenTreeTest, EmptySnapshotShouldBeEmpty) {
+  AvlTree<std::uint64_t, int, AvlNode<std::uint64_t, int>> tree;
+  auto const packed = tree.freezePacked();
+  ASSERT_TRUE(packed.checkInvariants());
+  ASSERT_EQ(0, packed.getSize());
+  ASSERT_FALSE(packed.getLeast());
+  ASSERT_FALSE(packed.find(0));
+  ASSERT_FALSE(packed.findNearestGTE(0));
+  ASSERT_FALSE(packed.findNearestLTE(0));
+  auto iter = packed.getRange(0, 100);
+  ASSERT_FALSE(iter->hasNext());
+  delete iter;
+}
+
+TEST(PackedFrozenTreeTest, UnorderedKeysShouldThrow) {
+  // keys in descending order along the vine
+  struct Descending {
+    int operator()(std::uint64_t const a, std::uint64_t const b) const {
+      return (a < b) ? 1 : (b < a) ? -1 : 0;
+    }
+  };
+  AvlTree<std::uint64_t, int, AvlNode<std::uint64_t, int>, Descending> tree;
+  for (std::uint64_t key = 0; key < 200; ++key) {
+    tree.insert(key, 0);
+  }
+  ASSERT_THROW((PackedFrozenTree<std::uint64_t, int, 64>(tree.getLeast())), std::invalid_argument);
+}
+
+TEST(PackedFrozenTreeTest, TestTimestamps) {
+  AvlTree<std::uint64_t, int, AvlNode<std::uint64_t, int>> tree;
+  std::mt19937 random(42);
+  std::uint64_t timestamp = 1700000000000000ull;
+  std::vector<std::uint64_t> queries;
+  for (int i = 0; i < 5000; ++i) {
+    timestamp += 1 + random() % 1000;
+    tree.insert(timestamp, i);
+    queries.push_back(timestamp);
+    queries.push_back(timestamp + 1);
+    queries.push_back(timestamp - 1);
+  }
+  queries.push_back(0);
+  queries.push_back(std::numeric_limits<std::uint64_t>::max());
+  assertPackedMatchesFrozen<std::uint64_t, 64>(tree, queries);
+  assertPackedMatchesFrozen<std::uint64_t, 7>(tree, queries);
+
+  // 10-bit deltas in place of 64-bit keys
+  auto const packed = tree.freezePacked();
+  ASSERT_LT(packed.getKeyBytes() * 4, packed.getKeyCount() * sizeof(std::uint64_t));
+
+  std::vector<int> values;
+  auto iter = packed.getRange(queries[300], queries[3 * 200]);
+  while (iter->hasNext()) {
+    values.push_back(iter->next().getValue());
+  }
+  delete iter;
+  ASSERT_EQ(101, values.size());
+  for (int i = 0; i < 101; ++i) {
+    ASSERT_EQ(100 + i, values[i]);
+  }
+}
+
+TEST(PackedFrozenTreeTest, TestWideAndSignedKeys) {
+  AvlTree<std::uint64_t, int, AvlNode<std::uint64_t, int>> wide_tree;
+  std::vector<std::uint64_t> wide_keys = {
+    0, 1, 3, std::uint64_t(1) << 40, std::numeric_limits<std::uint64_t>::max() - 1,
+    std::numeric_limits<std::uint64_t>::max()};
+  for (std::uint64_t const key : wide_keys) {
+    wide_tree.insert(key, 1);
+  }
+  wide_tree.insert(3, 2);
+  assertPackedMatchesFrozen<std::uint64_t, 4>(wide_tree, wide_keys);
+  ASSERT_EQ(2, wide_tree.freezePacked().find(3).getValues().size());
+
+  AvlTree<int, int, AvlNode<int, int>> signed_tree;
+  std::vector<int> queries;
+  for (int key = -3000; key < 3000; key += 7) {
+    signed_tree.insert(key, key);
+    queries.push_back(key);
+    queries.push_back(key + 3);
+  }
+  signed_tree.insert(std::numeric_limits<int>::min(), 0);
+  signed_tree.insert(std::numeric_limits<int>::max(), 0);
+  queries.push_back(std::numeric_limits<int>::min());
+  queries.push_back(std::numeric_limits<int>::max());
+  assertPackedMatchesFrozen<int, 16>(signed_tree, queries);
+}
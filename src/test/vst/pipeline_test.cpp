@@ -0,0 +1,63 @@
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../../vst/avl_node.h"
+#include "../../vst/avl_tree.h"
+#include "../../vst/pipeline.h"
+
+using namespace vst;
+
+class PipelineTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    for (int key = 1; key <= 9; ++key) {
+      tree.insert(key, 10 * key);
+    }
+  }
+
+  static int getKey(AvlNode<int,int>* const node) {
+    return node->getKey();
+  }
+
+  AvlTree<int,int> tree;
+};
+
+TEST_F(PipelineTest, TestVine) {
+  auto const keys = makeVinePipeline(tree.getLeast()).map(getKey).to_vector();
+  ASSERT_EQ((std::vector<int> {1, 2, 3, 4, 5, 6, 7, 8, 9}), keys);
+  ASSERT_TRUE((makeVinePipeline<AvlNode<int,int>>(nullptr).to_vector().empty()));
+}
+
+TEST_F(PipelineTest, TestRange) {
+  auto const range = tree.getRangePipeline(3, 6);
+  ASSERT_EQ((std::vector<int> {3, 4, 5, 6}), range.map(getKey).to_vector());
+  ASSERT_EQ((std::vector<int> {3, 4, 5, 6}), range.map(getKey).to_vector());
+  ASSERT_TRUE(tree.getRangePipeline(10, 20).to_vector().empty());
+}
+
+TEST_F(PipelineTest, TestOperators) {
+  auto const keys = tree.getRangePipeline(1, 9).map(getKey);
+  auto const even = [](int const key) { return key % 2 == 0; };
+  auto const less_than_5 = [](int const key) { return key < 5; };
+  ASSERT_EQ((std::vector<int> {2, 4, 6, 8}), keys.select(even).to_vector());
+  ASSERT_EQ((std::vector<int> {1, 3, 5, 7, 9}), keys.exclude(even).to_vector());
+  ASSERT_EQ((std::vector<int> {1, 2, 3}), keys.take(3).to_vector());
+  ASSERT_TRUE(keys.take(0).to_vector().empty());
+  ASSERT_EQ((std::vector<int> {1, 2, 3, 4}), keys.takeWhile(less_than_5).to_vector());
+  ASSERT_EQ((std::vector<int> {7, 8, 9}), keys.drop(6).to_vector());
+  ASSERT_EQ((std::vector<int> {5, 6, 7, 8, 9}), keys.dropWhile(less_than_5).to_vector());
+  ASSERT_EQ((std::vector<int> {60, 80}),
+    keys.drop(4).select(even).take(2).map([](int const key) { return 10 * key; })
+      .to_vector());
+}
+
+TEST_F(PipelineTest, TestEach) {
+  auto const keys = tree.getRangePipeline(1, 9).map(getKey);
+  int sum = 0;
+  ASSERT_TRUE(keys.each([&](int const key) { sum += key; return true; }));
+  ASSERT_EQ(45, sum);
+  sum = 0;
+  ASSERT_FALSE(keys.each([&](int const key) { sum += key; return key < 3; }));
+  ASSERT_EQ(6, sum);
+}
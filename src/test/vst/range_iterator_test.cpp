@@ -49,10 +49,11 @@ protected:
 };
 
 TEST_F(RangeIteratorTest, TestSequence) {
-  RangeIterator<AvlNode<int,int>,int>* iter;
+  typedef std::function<int (int,int)> Compare;
+  RangeIterator<AvlNode<int,int>*,int,Compare>* iter;
 
-  iter = new RangeIterator<AvlNode<int,int>,int>();
-  iter->setNode(first)->setCompare(compare)->setUpperKey(100);
+  iter = new RangeIterator<AvlNode<int,int>*,int,Compare>();
+  iter->setCursor(first)->setCompare(compare)->setUpperKey(100);
   ASSERT_TRUE(iter->hasNext());
   ASSERT_EQ(first, iter->next());
   ASSERT_TRUE(iter->hasNext());
@@ -66,8 +67,8 @@ TEST_F(RangeIteratorTest, TestSequence) {
   ASSERT_FALSE(iter->hasNext());
   delete iter;
 
-  iter = new RangeIterator<AvlNode<int,int>,int>();
-  iter->setNode(second)->setCompare(compare)->setUpperKey(4);
+  iter = new RangeIterator<AvlNode<int,int>*,int,Compare>();
+  iter->setCursor(second)->setCompare(compare)->setUpperKey(4);
   ASSERT_TRUE(iter->hasNext());
   ASSERT_EQ(second, iter->next());
   ASSERT_TRUE(iter->hasNext());
@@ -79,7 +80,38 @@ TEST_F(RangeIteratorTest, TestSequence) {
 }
 
 TEST(RangeIteratorTest, NewRangeIteratorShouldBeEmpty) {
-  auto iter = new RangeIterator<AvlNode<int,int>, int>();
+  auto iter = new RangeIterator<AvlNode<int,int>*, int>();
   ASSERT_FALSE(iter->hasNext());
   delete iter;
 }
+
+TEST_F(RangeIteratorTest, TestFetch) {
+  typedef std::function<int (int,int)> Compare;
+  first->addValue(10);
+  second->addValue(20);
+  third->addValue(30)->addValue(31);
+  fourth->addValue(40);
+  fifth->addValue(50);
+
+  RangeIterator<AvlNode<int,int>*,int,Compare> iter;
+  iter.setCursor(first)->setCompare(compare)->setUpperKey(4);
+  ASSERT_EQ(first, iter.next());
+  ASSERT_TRUE(iter.hasNext());
+
+  int keys[2];
+  int values[2];
+  std::size_t value_counts[2];
+  ASSERT_EQ(2, iter.fetch(keys, values, value_counts, 2));
+  ASSERT_EQ(2, keys[0]);
+  ASSERT_EQ(3, keys[1]);
+  ASSERT_EQ(20, values[0]);
+  ASSERT_EQ(30, values[1]);
+  ASSERT_EQ(1, value_counts[0]);
+  ASSERT_EQ(2, value_counts[1]);
+
+  ASSERT_EQ(1, iter.fetch(keys, values, nullptr, 2));
+  ASSERT_EQ(4, keys[0]);
+  ASSERT_EQ(40, values[0]);
+  ASSERT_EQ(0, iter.fetch(keys, values, nullptr, 2));
+  ASSERT_FALSE(iter.hasNext());
+}
@@ -0,0 +1,75 @@
+#include <iterator>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../../vst/ranked_avl_node.h"
+#include "../../vst/ranked_avl_tree.h"
+
+using namespace vst;
+
+TEST(RankedAvlNodeTest, TestCountsSubtree) {
+  ASSERT_TRUE((CountsSubtree<RankedAvlNode<int,int>>::value));
+  ASSERT_FALSE((CountsSubtree<AvlNode<int,int>>::value));
+  ASSERT_EQ(1, (RankedAvlNode<int,int>().getSubtreeSize()));
+}
+
+TEST(RankedAvlTreeTest, TestRankSelectAndCountRange) {
+  RankedAvlTree<int,int> tree;
+  std::set<int> expected;
+  std::mt19937 random(13);
+  for (int i = 0; i < 20000; ++i) {
+    int const key = random() % 5000;
+    if (random() % 3 == 0) {
+      tree.remove(key);
+      expected.erase(key);
+    }
+    else {
+      tree.insert(key, i);
+      expected.insert(key);
+    }
+  }
+  ASSERT_TRUE(tree.checkInvariants());
+
+  std::size_t index = 0;
+  for (int const key : expected) {
+    ASSERT_EQ(index, tree.rank(key));
+    ASSERT_EQ(key, tree.select(index)->getKey());
+    index += 1;
+  }
+  ASSERT_EQ(nullptr, tree.select(expected.size()));
+
+  for (int i = 0; i < 1000; ++i) {
+    int const lower_key = int(random() % 5200) - 100;
+    int const upper_key = int(random() % 5200) - 100;
+    std::size_t const count = (lower_key > upper_key) ? 0 : std::distance(
+      expected.lower_bound(lower_key), expected.upper_bound(upper_key));
+    ASSERT_EQ(count, tree.countRange(lower_key, upper_key));
+    ASSERT_EQ(std::size_t(std::distance(expected.begin(), expected.lower_bound(lower_key))),
+              tree.rank(lower_key));
+  }
+}
+
+TEST(RankedAvlTreeTest, TestBuildAndBatch) {
+  RankedAvlTree<int,int> tree;
+  std::vector<std::pair<int,int>> pairs;
+  for (int key = 0; key < 1000; key += 2) {
+    pairs.emplace_back(key, key);
+  }
+  tree.buildFromSorted(pairs.begin(), pairs.end());
+  ASSERT_TRUE(tree.checkInvariants());
+  ASSERT_EQ(250, tree.rank(500));
+
+  std::vector<std::pair<int,int>> batch;
+  for (int key = 1; key < 1000; key += 2) {
+    batch.emplace_back(key, key);
+  }
+  tree.insertBatch(batch.begin(), batch.end());
+  ASSERT_TRUE(tree.checkInvariants());
+  ASSERT_EQ(500, tree.rank(500));
+  ASSERT_EQ(900, tree.select(900)->getKey());
+  ASSERT_EQ(101, tree.countRange(100, 200));
+}
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../../vst/avl_tree.h"
+#include "../../vst/sharded_tree.h"
+
+using namespace vst;
+
+typedef ShardedTree<int, int> IntShardedTree;
+
+template <class IteratorType>
+std::vector<int> collectShardedKeys(IteratorType* const iter) {
+  std::vector<int> keys;
+  while (iter->hasNext()) {
+    keys.push_back(iter->next().getKey());
+  }
+  delete iter;
+  return keys;
+}
+
+TEST(ShardedTreeTest, TestLookupsAcrossShards) {
+  IntShardedTree tree({100, 200, 300});
+  ASSERT_EQ(4, tree.getShardCount());
+
+  for (int key : {10, 50, 250, 260, 400}) {
+    tree.insert(key, key);
+  }
+  tree.insert(50, 51);
+  ASSERT_TRUE(tree.checkInvariants());
+  ASSERT_EQ(6, tree.getSize());
+  ASSERT_EQ((std::vector<std::size_t>{3, 0, 2, 1}), tree.getShardSizes());
+
+  ASSERT_EQ((std::vector<int>{50, 51}), tree.find(50).getValues());
+  ASSERT_FALSE(tree.containsKey(100));
+  // shard 1 is empty, and shard 2 starts past the key
+  ASSERT_EQ(250, tree.findNearestGTE(60).getKey());
+  ASSERT_EQ(50, tree.findNearestLTE(240).getKey());
+  ASSERT_EQ(400, tree.findNearestGTE(261).getKey());
+  ASSERT_FALSE(tree.findNearestGTE(401));
+  ASSERT_FALSE(tree.findNearestLTE(9));
+
+  ASSERT_EQ((std::vector<int>{50, 250, 260, 400}), collectShardedKeys(tree.getRange(20, 400)));
+  ASSERT_EQ((std::vector<int>{10, 50, 250, 260}), collectShardedKeys(tree.getNeighbors(100, 2, 2)));
+  ASSERT_EQ((std::vector<int>{50, 250, 260}), collectShardedKeys(tree.getNeighbors(250, 1, 1)));
+  ASSERT_EQ((std::vector<int>{260, 250, 400}), collectShardedKeys(tree.getNearestNeighbors(301, 3)));
+
+  ASSERT_FALSE(tree.upsert(50, 52));
+  ASSERT_TRUE(tree.upsert(150, 150));
+  ASSERT_TRUE(tree.remove(250));
+  ASSERT_FALSE(tree.remove(50, 51));
+  ASSERT_TRUE(tree.remove(50, 52));
+  ASSERT_EQ(4, tree.getSize());
+  ASSERT_TRUE(tree.checkInvariants());
+}
+
+TEST(ShardedTreeTest, TestQueriesMatchSingleTree) {
+  std::mt19937 random(25);
+  std::uniform_int_distribution<int> keys(0, 10000);
+  std::vector<int> sample;
+  for (int i = 0; i < 100; ++i) {
+    sample.push_back(4 * keys(random));
+  }
+  IntShardedTree tree(IntShardedTree::sampleSplitKeys(sample, 8));
+  ASSERT_EQ(8, tree.getShardCount());
+  AvlTree<int, int> expected;
+  for (int i = 0; i < 5000; ++i) {
+    int const key = 4 * keys(random);
+    tree.insert(key, i);
+    expected.insert(key, i);
+  }
+  ASSERT_TRUE(tree.checkInvariants());
+  ASSERT_EQ(expected.getSize(), tree.getSize());
+
+  auto const expectedKeys = [](auto* const iter) {
+    std::vector<int> keys;
+    while (iter->hasNext()) {
+      keys.push_back(iter->next()->getKey());
+    }
+    delete iter;
+    return keys;
+  };
+
+  for (int i = 0; i < 200; ++i) {
+    // odd keys are absent, and never tie for the nearest
+    int const key = 4 * keys(random) + 1;
+    int const upper_key = key + 4 * keys(random);
+    ASSERT_EQ(expectedKeys(expected.getRange(key, upper_key)),
+              collectShardedKeys(tree.getRange(key, upper_key)));
+    ASSERT_EQ(expectedKeys(expected.getNeighbors(key, 5, 3)),
+              collectShardedKeys(tree.getNeighbors(key, 5, 3)));
+    ASSERT_EQ(expectedKeys(expected.getNearestNeighbors(key, 7)),
+              collectShardedKeys(tree.getNearestNeighbors(key, 7)));
+  }
+}
+
+TEST(ShardedTreeTest, TestRebalance) {
+  // every key falls in the last shard
+  IntShardedTree tree({-300, -200, -100});
+  for (int key = 0; key < 1000; ++key) {
+    tree.insert(key, key);
+  }
+  tree.insert(500, -500);
+  tree.rebalance();
+  ASSERT_TRUE(tree.checkInvariants());
+  for (std::size_t const shard_size : tree.getShardSizes()) {
+    ASSERT_NEAR(250, shard_size, 2);
+  }
+  ASSERT_EQ((std::vector<int>{500, -500}), tree.find(500).getValues());
+
+  // all the lookups go to the keys of the first shard, which is split up
+  for (int i = 0; i < 10; ++i) {
+    for (int key = 0; key < 250; ++key) {
+      ASSERT_TRUE(tree.containsKey(key));
+    }
+  }
+  tree.rebalance();
+  ASSERT_TRUE(tree.checkInvariants());
+  std::vector<int> const split_keys = tree.getSplitKeys();
+  ASSERT_LT(split_keys[1], 250);
+  ASSERT_EQ(1001, tree.getSize());
+  ASSERT_EQ(1000, collectShardedKeys(tree.getRange(0, 1000)).size());
+}
+
+TEST(ShardedTreeTest, TestRangeAcrossWritesAndRebalances) {
+  IntShardedTree tree({500});
+  for (int key = 0; key < 1000; ++key) {
+    tree.insert(key, key);
+  }
+
+  // the iterator copies whole chunks, so the keys up to the end of the chunk
+  // it is in have been copied already, including the last one, which it
+  // would resume from
+  auto iter = tree.getRange(0, 999);
+  std::vector<int> keys;
+  while (keys.size() < 100) {
+    keys.push_back(iter->next().getKey());
+  }
+  for (int key = 120; key <= 200; ++key) {
+    ASSERT_TRUE(tree.remove(key));
+  }
+  while (keys.size() < 300) {
+    keys.push_back(iter->next().getKey());
+  }
+  tree.rebalance();
+  ASSERT_TRUE(tree.checkInvariants());
+  while (iter->hasNext()) {
+    keys.push_back(iter->next().getKey());
+  }
+  delete iter;
+
+  std::vector<int> expected;
+  for (int key = 0; key < 1000; ++key) {
+    if (key < static_cast<int>(2 * ShardedIterator<IntShardedTree>::CHUNK_SIZE) || key > 200) {
+      expected.push_back(key);
+    }
+  }
+  ASSERT_EQ(expected, keys);
+}
+
+TEST(ShardedTreeTest, TestConcurrentWriters) {
+  int const key_count = 20000;
+  IntShardedTree tree(IntShardedTree::sampleSplitKeys({0, key_count}, 16));
+
+  // each writer owns the keys congruent to its index, and ends up keeping
+  // those divisible by 3
+  unsigned int const writer_count = 4;
+  std::atomic<bool> done(false);
+  std::atomic<int> failures(0);
+  std::thread reader([&]() {
+    while (!done.load()) {
+      int previous = -1;
+      auto iter = tree.getRange(0, key_count);
+      while (iter->hasNext()) {
+        int const key = iter->next().getKey();
+        if (key <= previous) failures += 1;
+        previous = key;
+      }
+      delete iter;
+      auto neighbors = tree.getNearestNeighbors(key_count / 2, 10);
+      if (neighbors->to_vector().size() > 10) failures += 1;
+      delete neighbors;
+    }
+  });
+
+  std::vector<std::thread> writers;
+  for (unsigned int w = 0; w < writer_count; ++w) {
+    writers.emplace_back([&, w]() {
+      for (int round = 0; round < 3; ++round) {
+        for (int key = w; key < key_count; key += writer_count) {
+          tree.insert(key, key);
+        }
+        for (int key = w; key < key_count; key += writer_count) {
+          if (key % 3 != 0) tree.remove(key);
+        }
+        if (w == 0) tree.rebalance();
+      }
+    });
+  }
+  for (std::thread& writer : writers) {
+    writer.join();
+  }
+  done = true;
+  reader.join();
+
+  ASSERT_EQ(0, failures.load());
+  ASSERT_TRUE(tree.checkInvariants());
+  std::set<int> keys;
+  auto iter = tree.getRange(0, key_count);
+  while (iter->hasNext()) {
+    auto const entry = iter->next();
+    ASSERT_EQ(3, entry.getValues().size());
+    keys.insert(entry.getKey());
+  }
+  delete iter;
+  ASSERT_EQ((key_count + 2) / 3, keys.size());
+  ASSERT_EQ(3 * keys.size(), tree.getSize());
+  for (int const key : keys) {
+    ASSERT_EQ(0, key % 3);
+  }
+}
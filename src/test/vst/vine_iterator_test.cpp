@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "../../vst/avl_node.h"
+#include "../../vst/avl_tree.h"
+#include "../../vst/vine_iterator.h"
+
+using namespace vst;
+
+class VineIteratorTest : public ::testing::Test {
+protected:
+  virtual void SetUp() {
+    for (int key = 2; key <= 10; key += 2) {
+      tree.insert(key, 10 * key);
+    }
+  }
+
+  AvlTree<int,int> tree;
+};
+
+TEST(NewVineIteratorTest, EmptyTreeShouldHaveNoNodes) {
+  AvlTree<int,int> tree;
+  ASSERT_EQ(tree.begin(), tree.end());
+  ASSERT_EQ(tree.rbegin(), tree.rend());
+  ASSERT_EQ(tree.end(), tree.lower_bound(1));
+}
+
+TEST_F(VineIteratorTest, TestRangeFor) {
+  std::vector<int> keys;
+  for (auto& node : tree) {
+    keys.push_back(node.getKey());
+  }
+  ASSERT_EQ((std::vector<int> {2, 4, 6, 8, 10}), keys);
+  ASSERT_EQ(5, std::distance(tree.begin(), tree.end()));
+}
+
+TEST_F(VineIteratorTest, TestReverse) {
+  std::vector<int> keys;
+  for (auto iter = tree.rbegin(); iter != tree.rend(); ++iter) {
+    keys.push_back(iter->getKey());
+  }
+  ASSERT_EQ((std::vector<int> {10, 8, 6, 4, 2}), keys);
+
+  auto iter = tree.end();
+  --iter;
+  ASSERT_EQ(10, iter->getKey());
+  ASSERT_EQ(tree.getGreatest(), (iter--).getNode());
+  ASSERT_EQ(8, (*iter).getKey());
+}
+
+TEST_F(VineIteratorTest, TestBounds) {
+  ASSERT_EQ(4, tree.lower_bound(4)->getKey());
+  ASSERT_EQ(6, tree.upper_bound(4)->getKey());
+  ASSERT_EQ(6, tree.lower_bound(5)->getKey());
+  ASSERT_EQ(6, tree.upper_bound(5)->getKey());
+  ASSERT_EQ(2, tree.lower_bound(-1)->getKey());
+  ASSERT_EQ(tree.end(), tree.upper_bound(10));
+
+  auto range = tree.equal_range(6);
+  ASSERT_EQ(1, std::distance(range.first, range.second));
+  ASSERT_EQ(60, range.first->getValue());
+  range = tree.equal_range(7);
+  ASSERT_EQ(range.first, range.second);
+
+  std::vector<int> keys;
+  std::transform(tree.lower_bound(3), tree.upper_bound(8), std::back_inserter(keys),
+    [](AvlNode<int,int> const& node) { return node.getKey(); });
+  ASSERT_EQ((std::vector<int> {4, 6, 8}), keys);
+
+  auto const found = std::find_if(tree.begin(), tree.end(),
+    [](AvlNode<int,int> const& node) { return node.getValue() > 50; });
+  ASSERT_EQ(6, found->getKey());
+}
@@ -0,0 +1,5 @@
+#include "aggregate.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
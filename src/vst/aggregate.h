@@ -0,0 +1,68 @@
+#ifndef __VST_AGGREGATE_H__
+#define __VST_AGGREGATE_H__
+
+#include <limits>
+
+namespace vst {
+
+/**
+ * Aggregation policies of SubtreeAggregate. Each one describes a monoid over
+ * its value_type: lift() maps a single value into it, combine() must be
+ * associative (though not necessarily commutative, as values are combined in
+ * key order), and identity() must leave any aggregate unchanged.
+ */
+
+template <class ValueType>
+struct SumAggregate {
+  typedef ValueType value_type;
+
+  static inline value_type identity() {
+    return value_type();
+  }
+
+  static inline value_type lift(ValueType const& value) {
+    return value;
+  }
+
+  static inline value_type combine(value_type const& a, value_type const& b) {
+    return a + b;
+  }
+};
+
+template <class ValueType>
+struct MinAggregate {
+  typedef ValueType value_type;
+
+  static inline value_type identity() {
+    return std::numeric_limits<value_type>::max();
+  }
+
+  static inline value_type lift(ValueType const& value) {
+    return value;
+  }
+
+  static inline value_type combine(value_type const& a, value_type const& b) {
+    return (b < a) ? b : a;
+  }
+};
+
+template <class ValueType>
+struct MaxAggregate {
+  typedef ValueType value_type;
+
+  static inline value_type identity() {
+    return std::numeric_limits<value_type>::lowest();
+  }
+
+  static inline value_type lift(ValueType const& value) {
+    return value;
+  }
+
+  static inline value_type combine(value_type const& a, value_type const& b) {
+    return (a < b) ? b : a;
+  }
+};
+
+}
+
+#endif
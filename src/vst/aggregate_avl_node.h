@@ -0,0 +1,79 @@
+#ifndef __VST_AGGREGATE_AVL_NODE_H__
+#define __VST_AGGREGATE_AVL_NODE_H__
+
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "avl_node.h"
+
+namespace vst {
+
+/**
+ * Augmentation of AvlNode that holds the aggregate of every value of its
+ * subtree, in key order, under the Aggregate policy (see aggregate.h), which
+ * lets a tree answer Tree::aggregate in logarithmic time.
+ *
+ * Values changed in place through a node returned by the tree are not
+ * reflected in the aggregates; change them through the tree instead.
+ */
+template <class Aggregate>
+struct SubtreeAggregate {
+  template <class NodeType>
+  class Mixin {
+  public:
+    typedef Aggregate AggregateType;
+    typedef typename Aggregate::value_type AggregateValue;
+
+    inline NodeType* setAggregate(AggregateValue const& aggregate) {
+      this->aggregate = aggregate;
+      return static_cast<NodeType*>(this);
+    }
+
+    /**
+     * Returns the aggregate of the values of the whole subtree.
+     */
+    inline AggregateValue const& getAggregate() const {
+      return aggregate;
+    }
+
+    /**
+     * Returns the aggregate of the values of this node alone.
+     */
+    AggregateValue getValuesAggregate() const {
+      AggregateValue result = Aggregate::identity();
+      for (auto const& value : static_cast<NodeType const*>(this)->getValues()) {
+        result = Aggregate::combine(result, Aggregate::lift(value));
+      }
+      return result;
+    }
+
+  private:
+    AggregateValue aggregate = Aggregate::identity();
+  };
+};
+
+/**
+ * AvlNode that aggregates its subtree. Add SubtreeSize to the augmentations
+ * of an AvlNode to also count it.
+ */
+template <class KeyType, class ValueType, class Aggregate,
+          class ValuesType = std::vector<ValueType>>
+using AggregateAvlNode =
+  AvlNode<KeyType, ValueType, ValuesType, SubtreeAggregate<Aggregate>>;
+
+/**
+ * Whether the nodes of NodeType aggregate their subtree, like
+ * AggregateAvlNode.
+ */
+template <class NodeType, class = void>
+struct AggregatesSubtree : std::false_type {};
+
+template <class NodeType>
+struct AggregatesSubtree<NodeType,
+    std::void_t<decltype(std::declval<NodeType const&>().getAggregate())>>
+  : std::true_type {};
+
+}
+
+#endif
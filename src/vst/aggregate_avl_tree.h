@@ -0,0 +1,30 @@
+#ifndef __VST_AGGREGATE_AVL_TREE_H__
+#define __VST_AGGREGATE_AVL_TREE_H__
+
+#include <vector>
+
+#include "aggregate_avl_node.h"
+#include "avl_tree.h"
+#include "compare.h"
+#include "node_allocator.h"
+
+namespace vst {
+
+/**
+ * AvlTree whose nodes aggregate the values of their subtrees, for range
+ * aggregation queries.
+ */
+template <class KeyType, class ValueType, class Aggregate,
+          class ValuesType = std::vector<ValueType>,
+          class Compare = ThreeWayCompare<KeyType>,
+          class Allocator = HeapNodeAllocator<
+            AggregateAvlNode<KeyType, ValueType, Aggregate, ValuesType>>>
+using AggregateAvlTree = AvlTree<
+  KeyType, ValueType,
+  AggregateAvlNode<KeyType, ValueType, Aggregate, ValuesType>,
+  Compare,
+  Allocator>;
+
+}
+
+#endif
@@ -1,29 +1,34 @@
 #ifndef __VST_AVL_NODE__
 #define __VST_AVL_NODE__
 
+#include <vector>
+
 #include "node.h"
 
 namespace vst {
 
-template <class KeyType, class ValueType>
-class AvlNode : public Node<AvlNode<KeyType, ValueType>, KeyType, ValueType> {
+/**
+ * The links and balance of a node of an AvlTree, shared by the node classes
+ * that AvlTree balances. NodeType is the class that derives from it.
+ */
+template <class NodeType, class KeyType, class ValueType, class ValuesType>
+class AvlNodeBase : public Node<NodeType, KeyType, ValueType, ValuesType> {
 public:
 
-  AvlNode() : Node<AvlNode<KeyType, ValueType>, KeyType, ValueType>() {
+  AvlNodeBase() : Node<NodeType, KeyType, ValueType, ValuesType>() {
     // empty constructor
   }
 
-  ~AvlNode() {
+  ~AvlNodeBase() {
     // empty destructor
   }
 
-  inline AvlNode<KeyType, ValueType>* setParent(
-      AvlNode<KeyType, ValueType>* const parent) {
+  inline NodeType* setParent(NodeType* const parent) {
     this->parent = parent;
-    return this;
+    return static_cast<NodeType*>(this);
   }
 
-  inline AvlNode<KeyType, ValueType>* getParent() const {
+  inline NodeType* getParent() const {
     return parent;
   }
 
@@ -43,7 +48,33 @@ public:
   }
 
 private:
-  AvlNode<KeyType, ValueType>* parent = nullptr;
+  NodeType* parent = nullptr;
+};
+
+/**
+ * Each of the Augmentations adds what a node keeps about its subtree, such as
+ * its size (SubtreeSize) or the aggregate of its values (SubtreeAggregate),
+ * which AvlTree maintains through insertions, removals and rotations, and
+ * they may be combined. An augmentation is a class whose nested Mixin
+ * template, given the node type, is a base of the node.
+ */
+template <class KeyType, class ValueType,
+          class ValuesType = std::vector<ValueType>,
+          class... Augmentations>
+class AvlNode
+  : public AvlNodeBase<AvlNode<KeyType, ValueType, ValuesType, Augmentations...>,
+                       KeyType, ValueType, ValuesType>,
+    public Augmentations::template Mixin<
+      AvlNode<KeyType, ValueType, ValuesType, Augmentations...>>... {
+public:
+
+  AvlNode() {
+    // empty constructor
+  }
+
+  ~AvlNode() {
+    // empty destructor
+  }
 };
 
 }
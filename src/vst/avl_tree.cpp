@@ -0,0 +1,5 @@
+#include "avl_tree.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
@@ -0,0 +1,540 @@
+#ifndef __VST_AVL_TREE_H__
+#define __VST_AVL_TREE_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#ifdef VST_CHECK_INVARIANTS
+#include <cassert>
+#endif
+
+#include "aggregate_avl_node.h"
+#include "avl_node.h"
+#include "ranked_avl_node.h"
+#include "tree.h"
+
+namespace vst {
+
+/**
+ * Height-balanced Tree whose rotations keep every descent logarithmic. The
+ * vine is relinked on every insertion and removal, while rotations leave it
+ * untouched since they do not change the in-order sequence of the nodes.
+ *
+ * Define VST_CHECK_INVARIANTS to verify the whole structure after every
+ * insertion and removal (meant for stress runs, as it costs O(n) per call).
+ */
+template <class KeyType, class ValueType,
+          class NodeType = AvlNode<KeyType, ValueType>,
+          class Compare = ThreeWayCompare<KeyType>,
+          class Allocator = HeapNodeAllocator<NodeType>>
+class AvlTree : public Tree<NodeType, KeyType, ValueType, Compare, Allocator> {
+public:
+
+  AvlTree() {
+    // empty constructor
+  }
+
+  AvlTree(Compare compare, Allocator allocator = Allocator())
+    : Tree<NodeType, KeyType, ValueType, Compare, Allocator>(
+        std::move(compare), std::move(allocator)) {
+    // empty constructor
+  }
+
+  ~AvlTree() {
+    // empty destructor
+  }
+
+  void addDescendant(NodeType* ancestor, NodeType* const descendant) {
+    KeyType const key = descendant->getKey();
+    while (true) {
+      if (this->compare(key, ancestor->getKey()) < 0) {
+        if (!ancestor->getLesserChild()) {
+          attachLesserChild(ancestor, descendant);
+          break;
+        }
+        ancestor = ancestor->getLesserChild();
+      }
+      else {
+        if (!ancestor->getGreaterChild()) {
+          attachGreaterChild(ancestor, descendant);
+          break;
+        }
+        ancestor = ancestor->getGreaterChild();
+      }
+    }
+#ifdef VST_CHECK_INVARIANTS
+    assert(checkInvariants());
+#endif
+  }
+
+  /**
+   * Inserts the key/value pairs in [first, last), in any order.
+   *
+   * The batch is sorted first, so that each key lands next to the previous
+   * one. A small batch is merged key by key, each insertion being hinted with
+   * the node of the previous key, so that it only costs a local search. A batch that is large
+   * compared to the tree is spliced into the vine in a single merge pass, and
+   * the tree is then rebuilt from the vine in linear time (see
+   * buildFromSorted). Either way, existing nodes are kept.
+   */
+  template <class PairIterator>
+  AvlTree* insertBatch(PairIterator const first, PairIterator const last) {
+    std::vector<std::pair<KeyType, ValueType>> batch(first, last);
+    std::stable_sort(batch.begin(), batch.end(),
+      [this](std::pair<KeyType, ValueType> const& a,
+             std::pair<KeyType, ValueType> const& b) {
+        return this->compare(a.first, b.first) < 0;
+      });
+
+    if (batch.size() * (this->getHeight() + 1) > this->size) {
+      mergeBatch(batch);
+    }
+    else {
+      NodeType* node = nullptr;
+      for (auto const& pair : batch) {
+        node = this->insert(pair.first, pair.second, node);
+      }
+    }
+#ifdef VST_CHECK_INVARIANTS
+    assert(checkInvariants());
+#endif
+    return this;
+  }
+
+  void removeNode(NodeType* const node) {
+    NodeType* const greater_neighbor = node->getGreaterNeighbor();
+    this->unlinkNeighbors(node);
+
+    NodeType* ancestor;
+    if (node->getLesserChild() && node->getGreaterChild()) {
+      // The greater neighbor is the least node of the greater subtree, so it
+      // has no lesser child and may be moved into the place of the node.
+      NodeType* const successor = greater_neighbor;
+      if (successor->getParent() == node) {
+        ancestor = successor;
+      }
+      else {
+        ancestor = successor->getParent();
+        ancestor->setLesserChild(successor->getGreaterChild());
+        if (successor->getGreaterChild()) {
+          successor->getGreaterChild()->setParent(ancestor);
+        }
+        successor->setGreaterChild(node->getGreaterChild());
+        node->getGreaterChild()->setParent(successor);
+      }
+      successor->setLesserChild(node->getLesserChild());
+      node->getLesserChild()->setParent(successor);
+      successor->setHeight(node->getHeight());
+      replaceChild(node->getParent(), node, successor);
+    }
+    else {
+      ancestor = node->getParent();
+      replaceChild(ancestor, node, (node->getLesserChild())
+        ? node->getLesserChild()
+        : node->getGreaterChild());
+    }
+
+    this->destroyNode(node);
+    rebalance(ancestor);
+#ifdef VST_CHECK_INVARIANTS
+    assert(checkInvariants());
+#endif
+  }
+
+  void updateValues(NodeType* node) {
+    if constexpr (AggregatesSubtree<NodeType>::value) {
+      for (; node; node = node->getParent()) {
+        updateNode(node);
+      }
+    }
+  }
+
+  /**
+   * Replaces the contents of the tree with the key/value pairs in [first,
+   * last), which must be sorted by key. Pairs with equal keys share a node.
+   *
+   * Rather than inserting one key at a time, the nodes are first created and
+   * chained along the vine, and then assembled in order into a tree whose
+   * subtrees differ in size by at most one node, all in linear time.
+   */
+  template <class PairIterator>
+  AvlTree* buildFromSorted(PairIterator first, PairIterator const last) {
+    this->clear();
+    NodeType* greatest = nullptr;
+    std::size_t count = 0;
+    for (; first != last; ++first) {
+      greatest = appendSorted(greatest, first->first, first->second, count);
+    }
+    buildFromVine(count);
+    return this;
+  }
+
+  /**
+   * Like buildFromSorted(first, last), but takes the keys and their values
+   * from parallel sequences.
+   */
+  template <class KeyIterator, class ValueIterator>
+  AvlTree* buildFromSorted(
+      KeyIterator first,
+      KeyIterator const last,
+      ValueIterator values) {
+    this->clear();
+    NodeType* greatest = nullptr;
+    std::size_t count = 0;
+    for (; first != last; ++first, ++values) {
+      greatest = appendSorted(greatest, *first, *values, count);
+    }
+    buildFromVine(count);
+    return this;
+  }
+
+  /**
+   * Verifies the ordering, parent pointers, heights and balance factors of
+   * every node, that the vine matches the in-order traversal of the tree and
+   * ends at the cached least and greatest nodes, and that the size matches
+   * the number of values.
+   */
+  bool checkInvariants() const {
+    return checkInvariants(true);
+  }
+
+protected:
+
+  /**
+   * Like checkInvariants, but lets neighboring nodes have equal keys unless
+   * they must be distinct, for subclasses whose nodes hold several keys.
+   */
+  bool checkInvariants(bool const distinct_keys) const {
+    if (!this->root) {
+      return this->size == 0 && !this->least_node && !this->greatest_node;
+    }
+    if (this->root->getParent()) return false;
+    if (this->least_node != this->getLeast(this->root)) return false;
+    if (this->greatest_node != this->getGreatest(this->root)) return false;
+    std::size_t size = 0;
+    return checkSubtree(this->root, nullptr, nullptr, distinct_keys, size) >= 0
+      && size == this->size;
+  }
+
+  /**
+   * Links the new node into the tree and the vine right after the given one,
+   * without comparing keys, for subclasses whose nodes hold several keys.
+   */
+  void addSuccessor(NodeType* const node, NodeType* const successor) {
+    if (node->getGreaterChild()) {
+      attachLesserChild(this->getLeast(node->getGreaterChild()), successor);
+    }
+    else {
+      attachGreaterChild(node, successor);
+    }
+#ifdef VST_CHECK_INVARIANTS
+    assert(checkInvariants());
+#endif
+  }
+
+private:
+
+  void attachLesserChild(NodeType* const parent, NodeType* const child) {
+    // the links of the child are set before any link to it, for the readers
+    // of a ConcurrentAvlTree
+    child->setParent(parent);
+    this->linkNeighbors(parent->getLesserNeighbor(), child, parent);
+    parent->setLesserChild(child);
+    updateNode(child);
+    rebalance(parent);
+  }
+
+  void attachGreaterChild(NodeType* const parent, NodeType* const child) {
+    child->setParent(parent);
+    this->linkNeighbors(parent, child, parent->getGreaterNeighbor());
+    parent->setGreaterChild(child);
+    updateNode(child);
+    rebalance(parent);
+  }
+
+  /**
+   * Splices the sorted batch into the vine and rebuilds the tree from it.
+   */
+  void mergeBatch(std::vector<std::pair<KeyType, ValueType>> const& batch) {
+    NodeType* node = this->getLeast();
+    NodeType* greatest = nullptr;
+    std::size_t count = 0;
+    this->root = nullptr;
+
+    for (auto const& pair : batch) {
+      while (node && this->compare(node->getKey(), pair.first) < 0) {
+        greatest = appendNode(greatest, node, count);
+        node = node->getGreaterNeighbor();
+      }
+      if (node && this->compare(node->getKey(), pair.first) == 0) {
+        this->size += 1;
+        node->addValue(pair.second);
+      }
+      else {
+        greatest = appendSorted(greatest, pair.first, pair.second, count);
+      }
+    }
+
+    while (node) {
+      greatest = appendNode(greatest, node, count);
+      node = node->getGreaterNeighbor();
+    }
+
+    buildFromVine(count);
+  }
+
+  /**
+   * Chains the node after the greatest one along the vine being rebuilt,
+   * keeping the greater neighbor of the node intact until it is visited.
+   */
+  NodeType* appendNode(NodeType* const greatest, NodeType* const node, std::size_t& count) {
+    node->setLesserNeighbor(greatest);
+    if (greatest) {
+      greatest->setGreaterNeighbor(node);
+    }
+    else {
+      this->root = this->least_node = node;
+    }
+    this->greatest_node = node;
+    count += 1;
+    return node;
+  }
+
+  /**
+   * Adds the value to the greatest node if it has the same key, otherwise
+   * chains a new node after it along the vine, returning the greatest node.
+   */
+  NodeType* appendSorted(
+      NodeType* const greatest,
+      KeyType const& key,
+      ValueType const& value,
+      std::size_t& count) {
+    this->size += 1;
+    if (greatest && this->compare(greatest->getKey(), key) == 0) {
+      greatest->addValue(value);
+      return greatest;
+    }
+    return appendNode(greatest, this->buildNode(key, value), count);
+  }
+
+  /**
+   * Turns the vine of count nodes that starts at the root into a balanced
+   * tree, by building each subtree from the next nodes of the vine in order.
+   */
+  void buildFromVine(std::size_t const count) {
+    NodeType* next = this->root;
+    this->root = buildSubtree(next, count);
+    if (this->root) this->root->setParent(nullptr);
+#ifdef VST_CHECK_INVARIANTS
+    assert(checkInvariants());
+#endif
+  }
+
+  NodeType* buildSubtree(NodeType*& next, std::size_t const count) {
+    if (count == 0) return nullptr;
+    std::size_t const lesser_count = (count - 1) / 2;
+    NodeType* const lesser_child = buildSubtree(next, lesser_count);
+    NodeType* const node = next;
+    next = next->getGreaterNeighbor();
+    NodeType* const greater_child = buildSubtree(next, count - 1 - lesser_count);
+    node->setLesserChild(lesser_child);
+    node->setGreaterChild(greater_child);
+    if (lesser_child) lesser_child->setParent(node);
+    if (greater_child) greater_child->setParent(node);
+    updateNode(node);
+    return node;
+  }
+
+  /**
+   * Recomputes the height of the node from its children, along with the size
+   * or aggregate of its subtree if it keeps them.
+   */
+  inline void updateNode(NodeType* const node) {
+    node->setHeight(node->getMaxChildHeight() + 1);
+    if constexpr (CountsSubtree<NodeType>::value) {
+      std::size_t subtree_size = 1;
+      if (node->getLesserChild()) subtree_size += node->getLesserChild()->getSubtreeSize();
+      if (node->getGreaterChild()) subtree_size += node->getGreaterChild()->getSubtreeSize();
+      node->setSubtreeSize(subtree_size);
+    }
+    if constexpr (AggregatesSubtree<NodeType>::value) {
+      node->setAggregate(aggregateSubtree(node));
+    }
+  }
+
+  /**
+   * Combines the aggregates of the children with the values of the node.
+   */
+  auto aggregateSubtree(NodeType const* const node) const {
+    typedef typename NodeType::AggregateType Aggregate;
+    typename Aggregate::value_type aggregate = node->getValuesAggregate();
+    if (node->getLesserChild()) {
+      aggregate = Aggregate::combine(node->getLesserChild()->getAggregate(), aggregate);
+    }
+    if (node->getGreaterChild()) {
+      aggregate = Aggregate::combine(aggregate, node->getGreaterChild()->getAggregate());
+    }
+    return aggregate;
+  }
+
+  void replaceChild(
+      NodeType* const parent,
+      NodeType* const child,
+      NodeType* const replacement) {
+    if (replacement) replacement->setParent(parent);
+    if (!parent) {
+      this->root = replacement;
+    }
+    else if (parent->getLesserChild() == child) {
+      parent->setLesserChild(replacement);
+    }
+    else {
+      parent->setGreaterChild(replacement);
+    }
+  }
+
+  NodeType* promoteLesserChild(NodeType* const node) {
+    NodeType* const child = node->getLesserChild();
+    NodeType* const grandchild = child->getGreaterChild();
+    replaceChild(node->getParent(), node, child);
+    node->setLesserChild(grandchild);
+    if (grandchild) grandchild->setParent(node);
+    child->setGreaterChild(node);
+    node->setParent(child);
+    updateNode(node);
+    updateNode(child);
+    return child;
+  }
+
+  NodeType* promoteGreaterChild(NodeType* const node) {
+    NodeType* const child = node->getGreaterChild();
+    NodeType* const grandchild = child->getLesserChild();
+    replaceChild(node->getParent(), node, child);
+    node->setGreaterChild(grandchild);
+    if (grandchild) grandchild->setParent(node);
+    child->setLesserChild(node);
+    node->setParent(child);
+    updateNode(node);
+    updateNode(child);
+    return child;
+  }
+
+  /**
+   * Restores the balance of the subtree rooted at the node, returning the
+   * root of the subtree once balanced.
+   */
+  NodeType* balance(NodeType* const node) {
+    updateNode(node);
+    int const balance = node->getBalance();
+    if (balance > 1) {
+      if (node->getLesserChild()->getBalance() < 0) {
+        promoteGreaterChild(node->getLesserChild());
+      }
+      return promoteLesserChild(node);
+    }
+    if (balance < -1) {
+      if (node->getGreaterChild()->getBalance() > 0) {
+        promoteLesserChild(node->getGreaterChild());
+      }
+      return promoteGreaterChild(node);
+    }
+    return node;
+  }
+
+  /**
+   * Walks from the node toward the root, restoring the balance of each
+   * ancestor. Once a subtree keeps its former height, nothing above it can
+   * have changed and the walk stops, except for the subtree sizes and
+   * aggregates of nodes that keep them, which are updated up to the root.
+   */
+  void rebalance(NodeType* node) {
+    while (node) {
+      int const height = node->getHeight();
+      NodeType* const parent = node->getParent();
+      bool const unchanged = balance(node)->getHeight() == height;
+      node = parent;
+      if (unchanged) break;
+    }
+    if constexpr (CountsSubtree<NodeType>::value
+                  || AggregatesSubtree<NodeType>::value) {
+      for (; node; node = node->getParent()) {
+        updateNode(node);
+      }
+    }
+  }
+
+  /**
+   * Returns the height of the subtree, or -2 if it violates an invariant. The
+   * lesser and greater bounds are the nearest ancestors the subtree descends
+   * from on its greater and lesser sides, respectively, which are also the
+   * neighbors of its least and greatest nodes.
+   */
+  int checkSubtree(
+      NodeType* const node,
+      NodeType* const lesser_bound,
+      NodeType* const greater_bound,
+      bool const distinct_keys,
+      std::size_t& size) const {
+
+    // comparisons of a lesser node with a greater one from here up are out of order
+    int const disorder = (distinct_keys) ? 0 : 1;
+    if (lesser_bound
+        && this->compare(lesser_bound->getKey(), node->getKey()) >= disorder) {
+      return -2;
+    }
+    if (greater_bound
+        && this->compare(node->getKey(), greater_bound->getKey()) >= disorder) {
+      return -2;
+    }
+    if (node->getValues().empty()) return -2;
+    size += node->getValues().size();
+
+    NodeType* const lesser_child = node->getLesserChild();
+    NodeType* const greater_child = node->getGreaterChild();
+
+    int lesser_height = -1;
+    if (lesser_child) {
+      if (lesser_child->getParent() != node) return -2;
+      lesser_height = checkSubtree(lesser_child, lesser_bound, node, distinct_keys, size);
+      if (lesser_height < -1) return -2;
+    }
+
+    int greater_height = -1;
+    if (greater_child) {
+      if (greater_child->getParent() != node) return -2;
+      greater_height = checkSubtree(greater_child, node, greater_bound, distinct_keys, size);
+      if (greater_height < -1) return -2;
+    }
+
+    NodeType* const lesser_neighbor = (lesser_child)
+      ? this->getGreatest(lesser_child)
+      : lesser_bound;
+    NodeType* const greater_neighbor = (greater_child)
+      ? this->getLeast(greater_child)
+      : greater_bound;
+    if (node->getLesserNeighbor() != lesser_neighbor) return -2;
+    if (node->getGreaterNeighbor() != greater_neighbor) return -2;
+
+    int const height = 1 + ((lesser_height > greater_height)
+      ? lesser_height
+      : greater_height);
+    if (node->getHeight() != height) return -2;
+    if constexpr (CountsSubtree<NodeType>::value) {
+      std::size_t const subtree_size = 1
+        + ((lesser_child) ? lesser_child->getSubtreeSize() : 0)
+        + ((greater_child) ? greater_child->getSubtreeSize() : 0);
+      if (node->getSubtreeSize() != subtree_size) return -2;
+    }
+    if constexpr (AggregatesSubtree<NodeType>::value) {
+      if (!(node->getAggregate() == aggregateSubtree(node))) return -2;
+    }
+    if (!node->isBalanced()) return -2;
+    return height;
+  }
+};
+
+}
+
+#endif
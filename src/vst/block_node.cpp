@@ -0,0 +1,5 @@
+#include "block_node.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
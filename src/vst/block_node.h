@@ -0,0 +1,291 @@
+#ifndef __VST_BLOCK_NODE_H__
+#define __VST_BLOCK_NODE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace vst {
+
+/**
+ * Node of a BlockTree, which holds a sorted block of up to BlockSize key/value
+ * entries instead of a single key. Its key is that of its first entry, so it
+ * has the same interface as AvlNode and AvlTree balances it unchanged, while
+ * the keys of the block are contiguous for searches and scans.
+ */
+template <class KeyType, class ValueType, std::uint32_t BlockSize = 32>
+class BlockNode {
+public:
+  static constexpr std::uint32_t CAPACITY = BlockSize;
+
+  /**
+   * The values of the block, in the form AvlTree::checkInvariants expects.
+   */
+  class Values {
+  public:
+    Values(ValueType const* const first, ValueType const* const last)
+      : first(first),
+        last(last) {
+      // empty constructor
+    }
+
+    inline ValueType const* begin() const {
+      return first;
+    }
+
+    inline ValueType const* end() const {
+      return last;
+    }
+
+    inline std::size_t size() const {
+      return last - first;
+    }
+
+    inline bool empty() const {
+      return first == last;
+    }
+
+  private:
+    ValueType const* first;
+    ValueType const* last;
+  };
+
+  BlockNode() {
+    // empty constructor
+  }
+
+  ~BlockNode() {
+    // empty destructor
+  }
+
+  inline KeyType getKey() const {
+    return keys[0];
+  }
+
+  inline KeyType const& getKey(std::uint32_t const index) const {
+    return keys[index];
+  }
+
+  inline ValueType const& getValue(std::uint32_t const index) const {
+    return values[index];
+  }
+
+  inline ValueType& getValue(std::uint32_t const index) {
+    return values[index];
+  }
+
+  inline Values getValues() const {
+    return Values(values, values + count);
+  }
+
+  inline std::uint32_t getCount() const {
+    return count;
+  }
+
+  inline KeyType const* getKeys() const {
+    return keys;
+  }
+
+  /**
+   * Inserts the entry before the one at the index, of which there must be
+   * fewer than BlockSize.
+   */
+  void insert(std::uint32_t const index, KeyType const& key, ValueType const& value) {
+    for (std::uint32_t i = count; i > index; --i) {
+      keys[i] = std::move(keys[i - 1]);
+      values[i] = std::move(values[i - 1]);
+    }
+    keys[index] = key;
+    values[index] = value;
+    count += 1;
+  }
+
+  void erase(std::uint32_t const index) {
+    count -= 1;
+    for (std::uint32_t i = index; i < count; ++i) {
+      keys[i] = std::move(keys[i + 1]);
+      values[i] = std::move(values[i + 1]);
+    }
+  }
+
+  /**
+   * Moves the entries from the index on to the end of the other block.
+   */
+  void moveEntries(std::uint32_t const index, BlockNode* const other) {
+    for (std::uint32_t i = index; i < count; ++i) {
+      other->keys[other->count] = std::move(keys[i]);
+      other->values[other->count] = std::move(values[i]);
+      other->count += 1;
+    }
+    count = index;
+  }
+
+  inline BlockNode* setGreaterChild(BlockNode* const greater_child) {
+    this->greater_child = greater_child;
+    return this;
+  }
+
+  inline BlockNode* getGreaterChild() const {
+    return greater_child;
+  }
+
+  inline BlockNode* setLesserChild(BlockNode* const lesser_child) {
+    this->lesser_child = lesser_child;
+    return this;
+  }
+
+  inline BlockNode* getLesserChild() const {
+    return lesser_child;
+  }
+
+  inline BlockNode* setGreaterNeighbor(BlockNode* const greater_neighbor) {
+    this->greater_neighbor = greater_neighbor;
+    return this;
+  }
+
+  inline BlockNode* getGreaterNeighbor() const {
+    return greater_neighbor;
+  }
+
+  inline BlockNode* setLesserNeighbor(BlockNode* const lesser_neighbor) {
+    this->lesser_neighbor = lesser_neighbor;
+    return this;
+  }
+
+  inline BlockNode* getLesserNeighbor() const {
+    return lesser_neighbor;
+  }
+
+  inline BlockNode* setParent(BlockNode* const parent) {
+    this->parent = parent;
+    return this;
+  }
+
+  inline BlockNode* getParent() const {
+    return parent;
+  }
+
+  inline bool isLeaf() const {
+    return !lesser_child && !greater_child;
+  }
+
+  inline bool isBranch() const {
+    return !lesser_child != !greater_child;
+  }
+
+  int getMaxChildHeight() const {
+    int const lesser_child_height = (lesser_child)
+      ? lesser_child->getHeight()
+      : -1;
+    int const greater_child_height = (greater_child)
+      ? greater_child->getHeight()
+      : -1;
+    return (lesser_child_height > greater_child_height)
+      ? lesser_child_height
+      : greater_child_height;
+  }
+
+  inline BlockNode* setHeight(int const height) {
+    this->height = height;
+    return this;
+  }
+
+  inline int getHeight() const {
+    return height;
+  }
+
+  int getBalance() const {
+    int const lesser_child_height = (lesser_child)
+      ? lesser_child->getHeight()
+      : -1;
+    int const greater_child_height = (greater_child)
+      ? greater_child->getHeight()
+      : -1;
+    return lesser_child_height - greater_child_height;
+  }
+
+  inline bool isBalanced() const {
+    int const balance = getBalance();
+    return -1 <= balance && balance <= 1;
+  }
+
+private:
+  BlockNode* greater_child = nullptr;
+  BlockNode* lesser_child = nullptr;
+  BlockNode* greater_neighbor = nullptr;
+  BlockNode* lesser_neighbor = nullptr;
+  BlockNode* parent = nullptr;
+  int height = 0;
+  std::uint32_t count = 0;
+  KeyType keys[BlockSize];
+  ValueType values[BlockSize];
+};
+
+/**
+ * Position of an entry within the vine of blocks, which is what the queries
+ * of a BlockTree return in place of a node. An entry without a node is past
+ * either end of the vine, and converts to false.
+ */
+template <class NodeType>
+class BlockEntry {
+public:
+
+  BlockEntry() {
+    // empty constructor
+  }
+
+  BlockEntry(NodeType* const node, std::uint32_t const index)
+    : node(node),
+      index(index) {
+    // empty constructor
+  }
+
+  inline NodeType* getNode() const {
+    return node;
+  }
+
+  inline std::uint32_t getIndex() const {
+    return index;
+  }
+
+  inline auto getKey() const {
+    return node->getKey(index);
+  }
+
+  inline auto getValue() const {
+    return node->getValue(index);
+  }
+
+  inline BlockEntry getGreaterNeighbor() const {
+    if (index + 1 < node->getCount()) return BlockEntry(node, index + 1);
+    return BlockEntry(node->getGreaterNeighbor(), 0);
+  }
+
+  BlockEntry getLesserNeighbor() const {
+    if (index > 0) return BlockEntry(node, index - 1);
+    NodeType* const lesser_neighbor = node->getLesserNeighbor();
+    return (lesser_neighbor)
+      ? BlockEntry(lesser_neighbor, lesser_neighbor->getCount() - 1)
+      : BlockEntry();
+  }
+
+  inline explicit operator bool() const {
+    return node != nullptr;
+  }
+
+  inline bool operator==(BlockEntry const& other) const {
+    return node == other.node && (!node || index == other.index);
+  }
+
+  inline bool operator!=(BlockEntry const& other) const {
+    return !(*this == other);
+  }
+
+private:
+  NodeType* node = nullptr;
+  std::uint32_t index = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,420 @@
+#ifndef __VST_BLOCK_TREE_H__
+#define __VST_BLOCK_TREE_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "avl_tree.h"
+#include "block_node.h"
+#include "compare.h"
+#include "distance.h"
+#include "key_search.h"
+#include "nearest_neighbor_iterator.h"
+#include "node_allocator.h"
+#include "range_iterator.h"
+
+namespace vst {
+
+/**
+ * Cache-conscious variant of AvlTree whose nodes are sorted blocks of up to
+ * BlockSize entries (see BlockNode), chained along the vine like the leaves
+ * of a B+ tree. A descent only reads the first key of each block, of which
+ * there are BlockSize times fewer than keys, and then searches one
+ * contiguous block, while range scans read whole blocks in order.
+ *
+ * Queries return a BlockEntry in place of a node. Entries with equal keys
+ * are kept in insertion order, like the values of a node, and a run of them
+ * longer than a block spans several, so that blocks may start with the last
+ * key of the block before them. Lookups of a key descend to the last block
+ * that starts with a lesser key, which is the first that may hold it.
+ */
+template <class KeyType, class ValueType,
+          std::uint32_t BlockSize = 32,
+          class Compare = ThreeWayCompare<KeyType>,
+          class Allocator = HeapNodeAllocator<BlockNode<KeyType, ValueType, BlockSize>>>
+class BlockTree
+  : protected AvlTree<KeyType, ValueType,
+                      BlockNode<KeyType, ValueType, BlockSize>,
+                      Compare, Allocator> {
+  typedef AvlTree<KeyType, ValueType, BlockNode<KeyType, ValueType, BlockSize>,
+                  Compare, Allocator> Base;
+
+public:
+  typedef BlockNode<KeyType, ValueType, BlockSize> NodeType;
+  typedef BlockEntry<NodeType> Entry;
+
+  static_assert(BlockSize >= 2, "BlockSize must be at least 2");
+
+  BlockTree() {
+    // empty constructor
+  }
+
+  BlockTree(Compare compare, Allocator allocator = Allocator())
+    : Base(std::move(compare), std::move(allocator)) {
+    // empty constructor
+  }
+
+  ~BlockTree() {
+    // empty destructor
+  }
+
+  using Base::getSize;
+  using Base::getHeight;
+  using Base::clear;
+
+  inline Entry getLeast() const {
+    return Entry(this->least_node, 0);
+  }
+
+  inline Entry getGreatest() const {
+    return (this->greatest_node)
+      ? Entry(this->greatest_node, this->greatest_node->getCount() - 1)
+      : Entry();
+  }
+
+  /**
+   * Inserts the entry after any other of the same key. When the block it
+   * belongs to is full, the block is split in two at the distinct key nearest
+   * its middle, except that keys appended past the greatest one, or past a
+   * block of equal keys, start a new block, so that blocks filled in
+   * increasing order stay full.
+   */
+  BlockTree* insert(KeyType const key, ValueType const value) {
+    NodeType* const node = findBlock(key, true);
+    if (!node) {
+      NodeType* const block = this->allocator.allocate();
+      block->insert(0, key, value);
+      this->root = this->least_node = this->greatest_node = block;
+      this->size = 1;
+      return this;
+    }
+
+    std::uint32_t const index = getUpperIndex(node, key);
+    if (node->getCount() < BlockSize) {
+      node->insert(index, key, value);
+      this->size += 1;
+    }
+    else {
+      split(node, index, key, value);
+    }
+    return this;
+  }
+
+  /**
+   * Returns the first entry of the key, if there is one.
+   */
+  Entry find(KeyType const key) const {
+    Entry const entry = findNearestGTE(key);
+    return (entry && this->compare(entry.getKey(), key) == 0) ? entry : Entry();
+  }
+
+  inline bool containsKey(KeyType const key) const {
+    return static_cast<bool>(find(key));
+  }
+
+  /**
+   * Returns the first entry of a key no less than the given one.
+   */
+  Entry findNearestGTE(KeyType const key) const {
+    NodeType* const node = findBlock(key, false);
+    if (!node) return Entry();
+    return getEntry(node, getLowerIndex(node, key));
+  }
+
+  /**
+   * Returns the last entry of a key no greater than the given one.
+   */
+  Entry findNearestLTE(KeyType const key) const {
+    Entry const entry = findNearestGT(key);
+    return (entry) ? entry.getLesserNeighbor() : getGreatest();
+  }
+
+  /**
+   * Returns the first entry of a key greater than the given one.
+   */
+  Entry findNearestGT(KeyType const key) const {
+    NodeType* const node = findBlock(key, true);
+    if (!node) return Entry();
+    return getEntry(node, getUpperIndex(node, key));
+  }
+
+  bool remove(KeyType const key) {
+    bool removed = false;
+    for (Entry entry = find(key); entry; entry = find(key)) {
+      erase(entry);
+      removed = true;
+    }
+    return removed;
+  }
+
+  bool remove(KeyType const key, ValueType const value) {
+    for (Entry entry = find(key);
+         entry && this->compare(entry.getKey(), key) == 0;
+         entry = entry.getGreaterNeighbor()) {
+      if (entry.getValue() == value) {
+        erase(entry);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  auto getRange(KeyType const lower_key, KeyType const upper_key) const {
+    auto iter = new RangeIterator<Entry, KeyType, Compare>();
+    if (Entry const entry = findNearestGTE(lower_key)) {
+      iter->setCursor(entry)->setCompare(this->compare)->setUpperKey(upper_key);
+    }
+    return iter;
+  }
+
+  /**
+   * Like Tree::getNeighbors, with the entries of the key in place of its node.
+   */
+  auto getNeighbors(
+      KeyType const key,
+      unsigned int const n_less,
+      unsigned int const n_greater) const {
+
+    auto iter = new RangeIterator<Entry, KeyType, Compare>();
+
+    if (this->root) {
+      Entry const lower_entry = findNearestGTE(key);
+      Entry lesser_neighbor = (lower_entry)
+        ? lower_entry.getLesserNeighbor()
+        : getGreatest();
+      Entry greater_neighbor = findNearestGT(key);
+
+      if (lesser_neighbor) {
+        for (unsigned int n = 1; n < n_less; ++n) {
+          Entry const next = lesser_neighbor.getLesserNeighbor();
+          if (!next) break;
+          lesser_neighbor = next;
+        }
+      }
+
+      if (greater_neighbor) {
+        for (unsigned int n = 1; n < n_greater; ++n) {
+          Entry const next = greater_neighbor.getGreaterNeighbor();
+          if (!next) break;
+          greater_neighbor = next;
+        }
+      }
+
+      Entry const least_neighbor = (lesser_neighbor)
+        ? lesser_neighbor
+        : lower_entry;
+
+      KeyType const upper_key = (greater_neighbor)
+        ? greater_neighbor.getKey()
+        : getGreatest().getKey();
+
+      iter->setCursor(least_neighbor)->setCompare(this->compare)->setUpperKey(upper_key);
+    }
+
+    return iter;
+  }
+
+  template <class Distance = AbsoluteDifference<KeyType>>
+  auto getNearestNeighbors(
+      KeyType const key,
+      unsigned int const k_neighbors,
+      Distance const& distance = Distance()) const {
+
+    auto iter = new NearestNeighborIterator<Entry, KeyType, Distance>();
+
+    if (this->root) {
+      Entry const entry = findNearestGTE(key);
+      iter->setKey(key)->setDistance(distance)->setLimit(k_neighbors)
+        ->setCursor((entry) ? entry : getGreatest());
+    }
+
+    return iter;
+  }
+
+  /**
+   * Verifies the invariants of AvlTree over the blocks, whose first keys may
+   * be equal, and that the entries are sorted within and across blocks.
+   */
+  bool checkInvariants() const {
+    if (!Base::checkInvariants(false)) return false;
+    for (NodeType* node = this->least_node; node; node = node->getGreaterNeighbor()) {
+      for (std::uint32_t i = 1; i < node->getCount(); ++i) {
+        if (this->compare(node->getKey(i - 1), node->getKey(i)) > 0) return false;
+      }
+      NodeType* const greater_neighbor = node->getGreaterNeighbor();
+      if (greater_neighbor
+          && this->compare(node->getKey(node->getCount() - 1), greater_neighbor->getKey()) > 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+
+  /**
+   * Returns the last block whose first key is less than the given one (or no
+   * greater, when inclusive), or the least block if there is none.
+   */
+  NodeType* findBlock(KeyType const key, bool const inclusive) const {
+    NodeType* block = this->least_node;
+    NodeType* node = this->root;
+    while (node) {
+      int const comparison = this->compare(node->getKey(), key);
+      if (comparison < 0 || (inclusive && comparison == 0)) {
+        block = node;
+        node = node->getGreaterChild();
+      }
+      else {
+        node = node->getLesserChild();
+      }
+    }
+    return block;
+  }
+
+  /**
+   * Returns the index of the first entry of the block whose key is no less
+   * than the given one. Under the natural order of the keys, the block is
+   * searched by KeySearch, which vectorizes arithmetic keys.
+   */
+  std::uint32_t getLowerIndex(NodeType* const node, KeyType const& key) const {
+    if constexpr (std::is_same_v<Compare, ThreeWayCompare<KeyType>>) {
+      return KeySearch<KeyType>::lowerBound(node->getKeys(), node->getCount(), key);
+    }
+    std::uint32_t first = 0;
+    std::uint32_t count = node->getCount();
+    while (count > 0) {
+      std::uint32_t const half = count / 2;
+      if (this->compare(node->getKey(first + half), key) < 0) {
+        first += half + 1;
+        count -= half + 1;
+      }
+      else {
+        count = half;
+      }
+    }
+    return first;
+  }
+
+  /**
+   * Returns the index of the first entry of the block whose key is greater
+   * than the given one.
+   */
+  std::uint32_t getUpperIndex(NodeType* const node, KeyType const& key) const {
+    if constexpr (std::is_same_v<Compare, ThreeWayCompare<KeyType>>) {
+      return KeySearch<KeyType>::upperBound(node->getKeys(), node->getCount(), key);
+    }
+    std::uint32_t first = 0;
+    std::uint32_t count = node->getCount();
+    while (count > 0) {
+      std::uint32_t const half = count / 2;
+      if (this->compare(node->getKey(first + half), key) <= 0) {
+        first += half + 1;
+        count -= half + 1;
+      }
+      else {
+        count = half;
+      }
+    }
+    return first;
+  }
+
+  /**
+   * Returns the entry at the index, which may be one past the end of the
+   * block, in which case it is the first entry of the next block.
+   */
+  inline Entry getEntry(NodeType* const node, std::uint32_t const index) const {
+    return (index < node->getCount())
+      ? Entry(node, index)
+      : Entry(node->getGreaterNeighbor(), 0);
+  }
+
+  /**
+   * Returns the index of the entry nearest the middle of the full block that
+   * follows an entry with a lesser key, or 0 if all its keys are equal.
+   */
+  std::uint32_t getSplitIndex(NodeType* const node) const {
+    for (std::uint32_t offset = 0; offset < BlockSize / 2; ++offset) {
+      std::uint32_t const upper = BlockSize / 2 + offset;
+      if (upper < BlockSize
+          && this->compare(node->getKey(upper - 1), node->getKey(upper)) < 0) {
+        return upper;
+      }
+      std::uint32_t const lower = BlockSize / 2 - offset;
+      if (lower > 0
+          && this->compare(node->getKey(lower - 1), node->getKey(lower)) < 0) {
+        return lower;
+      }
+    }
+    return 0;
+  }
+
+  /**
+   * Inserts the entry at the index of the full block by moving the entries
+   * from the split index on into a new block that follows it.
+   */
+  void split(
+      NodeType* const node,
+      std::uint32_t const index,
+      KeyType const& key,
+      ValueType const& value) {
+    std::uint32_t first = getSplitIndex(node);
+    if (index == BlockSize
+        && (first == 0
+            || (node == this->greatest_node
+                && this->compare(node->getKey(BlockSize - 1), key) < 0))) {
+      // the entry starts the new block alone, which continues the run of
+      // equal keys of the block if it has one
+      first = BlockSize;
+    }
+
+    NodeType* const successor = this->allocator.allocate();
+    node->moveEntries(first, successor);
+    if (first == 0) {
+      // every key of the block is greater, so the entry starts it alone
+      node->insert(0, key, value);
+    }
+    else if (first < BlockSize
+        && (index < first
+            || (index == first && this->compare(key, node->getKey(first - 1)) == 0))) {
+      node->insert(index, key, value);
+    }
+    else {
+      successor->insert(index - first, key, value);
+    }
+    this->size += 1;
+    this->addSuccessor(node, successor);
+  }
+
+  /**
+   * Removes the entry, and then removes its block if it has become empty, or
+   * merges it with a neighbor if both fit in half a block.
+   */
+  void erase(Entry const entry) {
+    NodeType* const node = entry.getNode();
+    node->erase(entry.getIndex());
+    this->size -= 1;
+    if (node->getCount() == 0) {
+      this->removeNode(node);
+      return;
+    }
+
+    NodeType* const lesser_neighbor = node->getLesserNeighbor();
+    NodeType* const greater_neighbor = node->getGreaterNeighbor();
+    if (lesser_neighbor
+        && lesser_neighbor->getCount() + node->getCount() <= BlockSize / 2) {
+      node->moveEntries(0, lesser_neighbor);
+      this->removeNode(node);
+    }
+    else if (greater_neighbor
+        && node->getCount() + greater_neighbor->getCount() <= BlockSize / 2) {
+      greater_neighbor->moveEntries(0, node);
+      this->removeNode(greater_neighbor);
+    }
+  }
+};
+
+}
+
+#endif
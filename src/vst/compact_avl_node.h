@@ -0,0 +1,181 @@
+#ifndef __VST_COMPACT_AVL_NODE_H__
+#define __VST_COMPACT_AVL_NODE_H__
+
+#include <cstdint>
+#include <vector>
+
+#include "compact_node_pool.h"
+
+namespace vst {
+
+/**
+ * AvlNode whose links are 29-bit indices into its CompactNodePool, with the
+ * height packed into the three spare bits of each child link. The five links
+ * and the height take 20 bytes instead of the 44 of an AvlNode.
+ *
+ * It has the same interface as AvlNode, so AvlTree runs on it unchanged, but
+ * it may only be linked to nodes allocated from its pool (see CompactAvlTree).
+ */
+template <class KeyType, class ValueType,
+          class ValuesType = std::vector<ValueType>>
+class CompactAvlNode {
+public:
+  typedef CompactNodePool<CompactAvlNode<KeyType, ValueType, ValuesType>> Pool;
+
+  static constexpr std::uint32_t INDEX_BITS = 29;
+  static constexpr std::uint32_t MAX_INDEX = (1u << INDEX_BITS) - 1;
+  static constexpr int MAX_HEIGHT = 63;
+
+  CompactAvlNode() {
+    // empty constructor
+  }
+
+  ~CompactAvlNode() {
+    // empty destructor
+  }
+
+  inline CompactAvlNode* setKey(KeyType const key) {
+    this->key = key;
+    return this;
+  }
+
+  inline KeyType getKey() const {
+    return key;
+  }
+
+  inline CompactAvlNode* addValue(ValueType const value) {
+    values.push_back(value);
+    return this;
+  }
+
+  bool removeValue(ValueType const value) {
+    for (auto iter = values.begin(); iter != values.end(); ++iter) {
+      if (*iter == value) {
+        values.erase(iter);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  inline const ValuesType& getValues() const {
+    return values;
+  }
+
+  inline ValueType getValue() const {
+    return values.front();
+  }
+
+  inline ValueType& getValue() {
+    return values.front();
+  }
+
+  inline CompactAvlNode* setValue(ValueType const value) {
+    values.clear();
+    values.push_back(value);
+    return this;
+  }
+
+  inline CompactAvlNode* setGreaterChild(CompactAvlNode* const greater_child) {
+    this->greater_child = (this->greater_child & ~MAX_INDEX) | Pool::getIndex(greater_child);
+    return this;
+  }
+
+  inline CompactAvlNode* getGreaterChild() const {
+    return Pool::getNode(this, greater_child & MAX_INDEX);
+  }
+
+  inline CompactAvlNode* setLesserChild(CompactAvlNode* const lesser_child) {
+    this->lesser_child = (this->lesser_child & ~MAX_INDEX) | Pool::getIndex(lesser_child);
+    return this;
+  }
+
+  inline CompactAvlNode* getLesserChild() const {
+    return Pool::getNode(this, lesser_child & MAX_INDEX);
+  }
+
+  inline CompactAvlNode* setGreaterNeighbor(CompactAvlNode* const greater_neighbor) {
+    this->greater_neighbor = Pool::getIndex(greater_neighbor);
+    return this;
+  }
+
+  inline CompactAvlNode* getGreaterNeighbor() const {
+    return Pool::getNode(this, greater_neighbor);
+  }
+
+  inline CompactAvlNode* setLesserNeighbor(CompactAvlNode* const lesser_neighbor) {
+    this->lesser_neighbor = Pool::getIndex(lesser_neighbor);
+    return this;
+  }
+
+  inline CompactAvlNode* getLesserNeighbor() const {
+    return Pool::getNode(this, lesser_neighbor);
+  }
+
+  inline CompactAvlNode* setParent(CompactAvlNode* const parent) {
+    this->parent = Pool::getIndex(parent);
+    return this;
+  }
+
+  inline CompactAvlNode* getParent() const {
+    return Pool::getNode(this, parent);
+  }
+
+  inline bool isLeaf() const {
+    return !(lesser_child & MAX_INDEX) && !(greater_child & MAX_INDEX);
+  }
+
+  inline bool isBranch() const {
+    return !(lesser_child & MAX_INDEX) != !(greater_child & MAX_INDEX);
+  }
+
+  int getMaxChildHeight() const {
+    int const lesser_child_height = (lesser_child & MAX_INDEX)
+      ? getLesserChild()->getHeight()
+      : -1;
+    int const greater_child_height = (greater_child & MAX_INDEX)
+      ? getGreaterChild()->getHeight()
+      : -1;
+    return (lesser_child_height > greater_child_height)
+      ? lesser_child_height
+      : greater_child_height;
+  }
+
+  inline CompactAvlNode* setHeight(int const height) {
+    lesser_child = (lesser_child & MAX_INDEX) | (std::uint32_t(height & 7) << INDEX_BITS);
+    greater_child = (greater_child & MAX_INDEX) | (std::uint32_t(height >> 3) << INDEX_BITS);
+    return this;
+  }
+
+  inline int getHeight() const {
+    return int(lesser_child >> INDEX_BITS) | int(greater_child >> INDEX_BITS) << 3;
+  }
+
+  int getBalance() const {
+    int const lesser_child_height = (lesser_child & MAX_INDEX)
+      ? getLesserChild()->getHeight()
+      : -1;
+    int const greater_child_height = (greater_child & MAX_INDEX)
+      ? getGreaterChild()->getHeight()
+      : -1;
+    return lesser_child_height - greater_child_height;
+  }
+
+  inline bool isBalanced() const {
+    int const balance = getBalance();
+    return -1 <= balance && balance <= 1;
+  }
+
+private:
+  ValuesType values;
+  KeyType key;
+  std::uint32_t greater_child = 0;
+  std::uint32_t lesser_child = 0;
+  std::uint32_t greater_neighbor = 0;
+  std::uint32_t lesser_neighbor = 0;
+  std::uint32_t parent = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef __VST_COMPACT_AVL_TREE_H__
+#define __VST_COMPACT_AVL_TREE_H__
+
+#include <vector>
+
+#include "avl_tree.h"
+#include "compare.h"
+#include "compact_avl_node.h"
+#include "compact_node_pool.h"
+
+namespace vst {
+
+/**
+ * AvlTree whose nodes live in a contiguous pool of its own and link to each
+ * other by 32-bit indices.
+ */
+template <class KeyType, class ValueType,
+          class ValuesType = std::vector<ValueType>,
+          class Compare = ThreeWayCompare<KeyType>>
+using CompactAvlTree = AvlTree<
+  KeyType, ValueType,
+  CompactAvlNode<KeyType, ValueType, ValuesType>,
+  Compare,
+  CompactNodePool<CompactAvlNode<KeyType, ValueType, ValuesType>>>;
+
+}
+
+#endif
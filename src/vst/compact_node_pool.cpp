@@ -0,0 +1,5 @@
+#include "compact_node_pool.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
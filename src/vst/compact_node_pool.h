@@ -0,0 +1,161 @@
+#ifndef __VST_COMPACT_NODE_POOL_H__
+#define __VST_COMPACT_NODE_POOL_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+namespace vst {
+
+/**
+ * Contiguous storage for nodes that refer to each other by 32-bit indices
+ * rather than pointers, such as CompactAvlNode. Each tree has a pool of its
+ * own, and index 0 is reserved for the null node.
+ *
+ * Nodes are carved from chunks of ChunkBytes bytes that are aligned to their
+ * size. Each chunk begins with a header holding the index of its first node
+ * and the state of the pool that owns it, so a node finds both its own index
+ * and the node at any index of its pool with constant arithmetic, without a
+ * reference to its tree. Destroyed nodes are reused through a free list
+ * threaded through their indices, and the chunks are kept until release() is
+ * called, at the latest when the tree is destroyed.
+ *
+ * The pool also serves as the allocator policy of Tree. Like the trees that
+ * use it, it is not thread-safe, but separate pools may be used from separate
+ * threads.
+ */
+template <class NodeType, std::size_t ChunkBytes = (1 << 20)>
+class CompactNodePool {
+  struct State;
+
+  struct ChunkHeader {
+    State const* state;
+    std::uint32_t first_index;
+  };
+
+public:
+
+  static_assert((ChunkBytes & (ChunkBytes - 1)) == 0,
+    "ChunkBytes must be a power of two");
+
+  static constexpr std::size_t NODE_OFFSET =
+    (sizeof(ChunkHeader) + alignof(NodeType) - 1)
+      / alignof(NodeType) * alignof(NodeType);
+
+  static constexpr std::uint32_t NODES_PER_CHUNK =
+    (ChunkBytes - NODE_OFFSET) / sizeof(NodeType);
+
+  CompactNodePool()
+    : state(new State()) {
+    // empty constructor
+  }
+
+  CompactNodePool(CompactNodePool const&) = delete;
+  CompactNodePool& operator=(CompactNodePool const&) = delete;
+
+  /**
+   * The chunks refer to the state of the pool, which moves along with it.
+   */
+  CompactNodePool(CompactNodePool&& other)
+    : state(std::move(other.state)) {
+    other.state.reset(new State());
+  }
+
+  ~CompactNodePool() {
+    release();
+  }
+
+  /**
+   * Returns the node at the index in the pool of the given node.
+   */
+  static inline NodeType* getNode(NodeType const* const node, std::uint32_t const index) {
+    if (!index) return nullptr;
+    return getHeader(node)->state->getNode(index);
+  }
+
+  inline NodeType* getNode(std::uint32_t const index) const {
+    if (!index) return nullptr;
+    return state->getNode(index);
+  }
+
+  static inline std::uint32_t getIndex(NodeType const* const node) {
+    if (!node) return 0;
+    ChunkHeader const* const header = getHeader(node);
+    return header->first_index
+      + (reinterpret_cast<unsigned char const*>(node)
+          - reinterpret_cast<unsigned char const*>(header) - NODE_OFFSET) / sizeof(NodeType);
+  }
+
+  inline std::size_t getChunkCount() const {
+    return state->chunks.size();
+  }
+
+  NodeType* allocate() {
+    std::uint32_t index;
+    if (state->free_index) {
+      index = state->free_index;
+      state->free_index = *reinterpret_cast<std::uint32_t*>(getNode(index));
+    }
+    else {
+      if (state->next_index > NodeType::MAX_INDEX) {
+        throw std::length_error("Too many nodes for 32-bit node indices");
+      }
+      if (state->next_index >= state->chunks.size() * NODES_PER_CHUNK) {
+        unsigned char* const chunk = static_cast<unsigned char*>(
+          ::operator new(ChunkBytes, std::align_val_t(ChunkBytes)));
+        new (chunk) ChunkHeader{state.get(), std::uint32_t(state->chunks.size() * NODES_PER_CHUNK)};
+        state->chunks.push_back(chunk);
+      }
+      index = state->next_index;
+      state->next_index += 1;
+    }
+    return new (getNode(index)) NodeType();
+  }
+
+  void deallocate(NodeType* const node) {
+    std::uint32_t const index = getIndex(node);
+    node->~NodeType();
+    *reinterpret_cast<std::uint32_t*>(node) = state->free_index;
+    state->free_index = index;
+  }
+
+  /**
+   * Returns every chunk to the heap. Nodes still allocated from this pool are
+   * not destroyed and must no longer be used.
+   */
+  void release() {
+    for (unsigned char* const chunk : state->chunks) {
+      ::operator delete(chunk, std::align_val_t(ChunkBytes));
+    }
+    state->chunks.clear();
+    state->free_index = 0;
+    state->next_index = 1;
+  }
+
+private:
+
+  struct State {
+    std::vector<unsigned char*> chunks;
+    std::uint32_t free_index = 0;
+    std::uint32_t next_index = 1;
+
+    inline NodeType* getNode(std::uint32_t const index) const {
+      return reinterpret_cast<NodeType*>(chunks[index / NODES_PER_CHUNK] + NODE_OFFSET)
+        + index % NODES_PER_CHUNK;
+    }
+  };
+
+  std::unique_ptr<State> state;
+
+  static inline ChunkHeader const* getHeader(NodeType const* const node) {
+    return reinterpret_cast<ChunkHeader const*>(
+      reinterpret_cast<std::uintptr_t>(node) & ~std::uintptr_t(ChunkBytes - 1));
+  }
+};
+
+}
+
+#endif
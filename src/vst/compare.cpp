@@ -0,0 +1,5 @@
+#include "compare.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
@@ -0,0 +1,20 @@
+#ifndef __VST_COMPARE_H__
+#define __VST_COMPARE_H__
+
+namespace vst {
+
+/**
+ * Default comparator of Tree and RangeIterator, which orders keys by their
+ * operator< and returns a negative, zero or positive int like strcmp. Being a
+ * type rather than a std::function, its calls are inlined into the descents.
+ */
+template <class KeyType>
+struct ThreeWayCompare {
+  inline int operator()(KeyType const& a, KeyType const& b) const {
+    return (a < b) ? -1 : (b < a) ? 1 : 0;
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef __VST_CONCURRENT_AVL_NODE_H__
+#define __VST_CONCURRENT_AVL_NODE_H__
+
+#include <atomic>
+#include <vector>
+
+namespace vst {
+
+/**
+ * AvlNode whose links are atomic, so that readers may follow them while the
+ * writer of a ConcurrentAvlTree relinks the tree. Every link is stored with
+ * release semantics and loaded with acquire semantics, so a reader that
+ * reaches a node through a link sees the node as it was when it was linked.
+ *
+ * The key and values of a node must not change once it is linked; the tree
+ * replaces the node instead.
+ */
+template <class KeyType, class ValueType,
+          class ValuesType = std::vector<ValueType>>
+class ConcurrentAvlNode {
+public:
+
+  ConcurrentAvlNode() {
+    // empty constructor
+  }
+
+  ~ConcurrentAvlNode() {
+    // empty destructor
+  }
+
+  inline ConcurrentAvlNode* setKey(KeyType const key) {
+    this->key = key;
+    return this;
+  }
+
+  inline KeyType getKey() const {
+    return key;
+  }
+
+  inline ConcurrentAvlNode* addValue(ValueType const value) {
+    values.push_back(value);
+    return this;
+  }
+
+  bool removeValue(ValueType const value) {
+    for (auto iter = values.begin(); iter != values.end(); ++iter) {
+      if (*iter == value) {
+        values.erase(iter);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  inline const ValuesType& getValues() const {
+    return values;
+  }
+
+  inline ValueType getValue() const {
+    return values.front();
+  }
+
+  inline ConcurrentAvlNode* setValue(ValueType const value) {
+    values.clear();
+    values.push_back(value);
+    return this;
+  }
+
+  inline ConcurrentAvlNode* setGreaterChild(ConcurrentAvlNode* const greater_child) {
+    this->greater_child.store(greater_child, std::memory_order_release);
+    return this;
+  }
+
+  inline ConcurrentAvlNode* getGreaterChild() const {
+    return greater_child.load(std::memory_order_acquire);
+  }
+
+  inline ConcurrentAvlNode* setLesserChild(ConcurrentAvlNode* const lesser_child) {
+    this->lesser_child.store(lesser_child, std::memory_order_release);
+    return this;
+  }
+
+  inline ConcurrentAvlNode* getLesserChild() const {
+    return lesser_child.load(std::memory_order_acquire);
+  }
+
+  inline ConcurrentAvlNode* setGreaterNeighbor(ConcurrentAvlNode* const greater_neighbor) {
+    this->greater_neighbor.store(greater_neighbor, std::memory_order_release);
+    return this;
+  }
+
+  inline ConcurrentAvlNode* getGreaterNeighbor() const {
+    return greater_neighbor.load(std::memory_order_acquire);
+  }
+
+  inline ConcurrentAvlNode* setLesserNeighbor(ConcurrentAvlNode* const lesser_neighbor) {
+    this->lesser_neighbor.store(lesser_neighbor, std::memory_order_release);
+    return this;
+  }
+
+  inline ConcurrentAvlNode* getLesserNeighbor() const {
+    return lesser_neighbor.load(std::memory_order_acquire);
+  }
+
+  /**
+   * The parent and the height are only used by the writer.
+   */
+  inline ConcurrentAvlNode* setParent(ConcurrentAvlNode* const parent) {
+    this->parent = parent;
+    return this;
+  }
+
+  inline ConcurrentAvlNode* getParent() const {
+    return parent;
+  }
+
+  inline bool isLeaf() const {
+    return !getLesserChild() && !getGreaterChild();
+  }
+
+  inline bool isBranch() const {
+    return !getLesserChild() != !getGreaterChild();
+  }
+
+  int getMaxChildHeight() const {
+    ConcurrentAvlNode* const lesser_child = getLesserChild();
+    ConcurrentAvlNode* const greater_child = getGreaterChild();
+    int const lesser_child_height = (lesser_child)
+      ? lesser_child->getHeight()
+      : -1;
+    int const greater_child_height = (greater_child)
+      ? greater_child->getHeight()
+      : -1;
+    return (lesser_child_height > greater_child_height)
+      ? lesser_child_height
+      : greater_child_height;
+  }
+
+  inline ConcurrentAvlNode* setHeight(int const height) {
+    this->height = height;
+    return this;
+  }
+
+  inline int getHeight() const {
+    return height;
+  }
+
+  int getBalance() const {
+    ConcurrentAvlNode* const lesser_child = getLesserChild();
+    ConcurrentAvlNode* const greater_child = getGreaterChild();
+    int const lesser_child_height = (lesser_child)
+      ? lesser_child->getHeight()
+      : -1;
+    int const greater_child_height = (greater_child)
+      ? greater_child->getHeight()
+      : -1;
+    return lesser_child_height - greater_child_height;
+  }
+
+  inline bool isBalanced() const {
+    int const balance = getBalance();
+    return -1 <= balance && balance <= 1;
+  }
+
+private:
+  KeyType key;
+  ValuesType values;
+  std::atomic<ConcurrentAvlNode*> greater_child{nullptr};
+  std::atomic<ConcurrentAvlNode*> lesser_child{nullptr};
+  std::atomic<ConcurrentAvlNode*> greater_neighbor{nullptr};
+  std::atomic<ConcurrentAvlNode*> lesser_neighbor{nullptr};
+  ConcurrentAvlNode* parent = nullptr;
+  int height = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,329 @@
+#ifndef __VST_CONCURRENT_AVL_TREE_H__
+#define __VST_CONCURRENT_AVL_TREE_H__
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "avl_tree.h"
+#include "compare.h"
+#include "concurrent_avl_node.h"
+#include "distance.h"
+#include "epoch.h"
+#include "nearest_neighbor_iterator.h"
+#include "node_allocator.h"
+#include "range_iterator.h"
+
+namespace vst {
+
+/**
+ * AvlTree for one writer thread and any number of reader threads, whose
+ * reads take no locks.
+ *
+ * The writer calls insert, upsert, remove and clear, which must not overlap.
+ * Its changes reach the readers through the atomic links of
+ * ConcurrentAvlNode: a new node is fully linked before any link to it is
+ * published, and each rotation or relink stores one link at a time.
+ *
+ * A reader pins the tree with pin() and only uses the nodes it reads while
+ * the returned guard lives. In the meantime, removed nodes are retired to an
+ * EpochNodeAllocator rather than freed. A reader may see a rotation halfway,
+ * so its descent may end away from the key, but the vine is always sorted,
+ * and every lookup walks it from wherever the descent ended. Removed nodes
+ * keep their links, so a reader standing on one still walks back into the
+ * tree. Each node a reader returns was in the tree at some point during the
+ * read.
+ *
+ * The values of a linked node never change in place. Adding or removing a
+ * value of an existing key copies its node, which makes keys with many
+ * values costly to update.
+ */
+template <class KeyType, class ValueType,
+          class ValuesType = std::vector<ValueType>,
+          class Compare = ThreeWayCompare<KeyType>>
+class ConcurrentAvlTree
+  : protected AvlTree<KeyType, ValueType,
+                      ConcurrentAvlNode<KeyType, ValueType, ValuesType>, Compare,
+                      EpochNodeAllocator<ConcurrentAvlNode<KeyType, ValueType, ValuesType>>> {
+  typedef AvlTree<KeyType, ValueType,
+                  ConcurrentAvlNode<KeyType, ValueType, ValuesType>, Compare,
+                  EpochNodeAllocator<ConcurrentAvlNode<KeyType, ValueType, ValuesType>>> Base;
+
+public:
+  typedef ConcurrentAvlNode<KeyType, ValueType, ValuesType> NodeType;
+
+  ConcurrentAvlTree() {
+    // empty constructor
+  }
+
+  ConcurrentAvlTree(Compare compare,
+                    EpochNodeAllocator<NodeType> allocator = EpochNodeAllocator<NodeType>())
+    : Base(std::move(compare), std::move(allocator)) {
+    // empty constructor
+  }
+
+  ~ConcurrentAvlTree() {
+    // empty destructor
+  }
+
+  // Writer ---------------------------------------------------------------------
+
+  ConcurrentAvlTree* insert(KeyType const key, ValueType const value) {
+    if (NodeType* const node = Base::find(key)) {
+      NodeType* const replacement = copyNode(node);
+      replacement->addValue(value);
+      replaceNode(node, replacement);
+      this->size += 1;
+    }
+    else {
+      Base::insertOrGet(key, value);
+    }
+    publish();
+    return this;
+  }
+
+  /**
+   * Replaces all the values of the key with the given one, returning whether
+   * the key is new.
+   */
+  bool upsert(KeyType const key, ValueType const value) {
+    bool inserted = true;
+    if (NodeType* const node = Base::find(key)) {
+      NodeType* const replacement = this->buildNode(key, value);
+      this->size -= node->getValues().size() - 1;
+      replaceNode(node, replacement);
+      inserted = false;
+    }
+    else {
+      Base::insertOrGet(key, value);
+    }
+    publish();
+    return inserted;
+  }
+
+  bool remove(KeyType const key) {
+    bool const removed = Base::remove(key);
+    publish();
+    return removed;
+  }
+
+  bool remove(KeyType const key, ValueType const value) {
+    NodeType* const node = Base::find(key);
+    if (!node) return false;
+    if (node->getValues().size() == 1) {
+      // unlink the whole node rather than empty its values in place
+      if (!(node->getValue() == value)) return false;
+      bool const removed = Base::remove(key);
+      publish();
+      return removed;
+    }
+    NodeType* const replacement = copyNode(node);
+    if (!replacement->removeValue(value)) {
+      this->destroyNode(replacement);
+      return false;
+    }
+    replaceNode(node, replacement);
+    this->size -= 1;
+    publish();
+    return true;
+  }
+
+  void clear() {
+    // unlink everything before the nodes are retired
+    NodeType* node = this->least_node;
+    this->root = this->least_node = this->greatest_node = nullptr;
+    this->size = 0;
+    publish();
+    while (node) {
+      NodeType* const greater_neighbor = node->getGreaterNeighbor();
+      this->destroyNode(node);
+      node = greater_neighbor;
+    }
+  }
+
+  /**
+   * Frees the nodes that no reader can still hold. The writer also does so
+   * on its own as nodes are removed.
+   */
+  inline void collect() {
+    this->allocator.collect();
+  }
+
+  inline std::size_t getRetiredCount() const {
+    return this->allocator.getRetiredCount();
+  }
+
+  bool checkInvariants() const {
+    return Base::checkInvariants()
+      && published_root.load() == this->root
+      && published_least.load() == this->least_node
+      && published_greatest.load() == this->greatest_node
+      && published_size.load() == this->size;
+  }
+
+  // Readers --------------------------------------------------------------------
+
+  /**
+   * Pins the tree for the calling reader until the guard goes out of scope.
+   */
+  inline EpochGuard pin() const {
+    return EpochGuard(this->allocator.getDomain());
+  }
+
+  inline std::size_t getSize() const {
+    return published_size.load(std::memory_order_acquire);
+  }
+
+  inline NodeType* getLeast() const {
+    return published_least.load(std::memory_order_acquire);
+  }
+
+  inline NodeType* getGreatest() const {
+    return published_greatest.load(std::memory_order_acquire);
+  }
+
+  inline bool containsKey(KeyType const key) const {
+    return nullptr != find(key);
+  }
+
+  NodeType* find(KeyType const key) const {
+    NodeType* const node = findNearestGTE(key);
+    return (node && this->compare(node->getKey(), key) == 0) ? node : nullptr;
+  }
+
+  NodeType* findNearestGTE(KeyType const key) const {
+    NodeType* node = descend(key);
+    if (!node) return nullptr;
+    for (NodeType* lesser_neighbor = node->getLesserNeighbor();
+         lesser_neighbor && this->compare(lesser_neighbor->getKey(), key) >= 0;
+         lesser_neighbor = node->getLesserNeighbor()) {
+      node = lesser_neighbor;
+    }
+    while (node && this->compare(node->getKey(), key) < 0) {
+      node = node->getGreaterNeighbor();
+    }
+    return node;
+  }
+
+  NodeType* findNearestLTE(KeyType const key) const {
+    NodeType* node = descend(key);
+    if (!node) return nullptr;
+    for (NodeType* greater_neighbor = node->getGreaterNeighbor();
+         greater_neighbor && this->compare(greater_neighbor->getKey(), key) <= 0;
+         greater_neighbor = node->getGreaterNeighbor()) {
+      node = greater_neighbor;
+    }
+    while (node && this->compare(node->getKey(), key) > 0) {
+      node = node->getLesserNeighbor();
+    }
+    return node;
+  }
+
+  /**
+   * Scans the vine from the lower key, which must be done under the same
+   * guard as the call.
+   */
+  auto getRange(KeyType const lower_key, KeyType const upper_key) const {
+    auto iter = new RangeIterator<NodeType*, KeyType, Compare>();
+    if (NodeType* const node = findNearestGTE(lower_key)) {
+      iter->setCursor(node)->setCompare(this->compare)->setUpperKey(upper_key);
+    }
+    return iter;
+  }
+
+  template <class Distance = AbsoluteDifference<KeyType>>
+  auto getNearestNeighbors(
+      KeyType const key,
+      unsigned int const k_neighbors,
+      Distance const& distance = Distance()) const {
+
+    auto iter = new NearestNeighborIterator<NodeType*, KeyType, Distance>();
+
+    NodeType* node = findNearestGTE(key);
+    if (!node) node = getGreatest();
+    if (node) {
+      iter->setKey(key)->setDistance(distance)->setLimit(k_neighbors)->setCursor(node);
+    }
+
+    return iter;
+  }
+
+private:
+  std::atomic<NodeType*> published_root{nullptr};
+  std::atomic<NodeType*> published_least{nullptr};
+  std::atomic<NodeType*> published_greatest{nullptr};
+  std::atomic<std::size_t> published_size{0};
+
+  /**
+   * Makes the ends of the tree, as left by the last change, visible to the
+   * readers.
+   */
+  void publish() {
+    published_root.store(this->root, std::memory_order_release);
+    published_least.store(this->least_node, std::memory_order_release);
+    published_greatest.store(this->greatest_node, std::memory_order_release);
+    published_size.store(this->size, std::memory_order_release);
+  }
+
+  /**
+   * Returns the last node of the descent toward the key, which is near it
+   * unless the descent raced with a rotation.
+   */
+  NodeType* descend(KeyType const key) const {
+    NodeType* node = published_root.load(std::memory_order_acquire);
+    while (node) {
+      int const comparison = this->compare(key, node->getKey());
+      NodeType* const child = (comparison < 0)
+        ? node->getLesserChild()
+        : (comparison > 0) ? node->getGreaterChild() : nullptr;
+      if (!child) break;
+      node = child;
+    }
+    return node;
+  }
+
+  NodeType* copyNode(NodeType const* const node) {
+    NodeType* const copy = this->allocator.allocate();
+    copy->setKey(node->getKey());
+    for (ValueType const& value : node->getValues()) {
+      copy->addValue(value);
+    }
+    return copy;
+  }
+
+  /**
+   * Puts the replacement in the place of the node, in the tree and the vine,
+   * and retires the node. The replacement is fully linked before anything
+   * links to it, and the node keeps its links.
+   */
+  void replaceNode(NodeType* const node, NodeType* const replacement) {
+    NodeType* const parent = node->getParent();
+    NodeType* const lesser_child = node->getLesserChild();
+    NodeType* const greater_child = node->getGreaterChild();
+
+    replacement->setHeight(node->getHeight());
+    replacement->setParent(parent);
+    replacement->setLesserChild(lesser_child);
+    replacement->setGreaterChild(greater_child);
+    this->linkNeighbors(node->getLesserNeighbor(), replacement, node->getGreaterNeighbor());
+
+    if (!parent) {
+      this->root = replacement;
+    }
+    else if (parent->getLesserChild() == node) {
+      parent->setLesserChild(replacement);
+    }
+    else {
+      parent->setGreaterChild(replacement);
+    }
+    if (lesser_child) lesser_child->setParent(replacement);
+    if (greater_child) greater_child->setParent(replacement);
+
+    this->destroyNode(node);
+  }
+};
+
+}
+
+#endif
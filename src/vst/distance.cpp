@@ -0,0 +1,5 @@
+#include "distance.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
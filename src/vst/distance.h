@@ -0,0 +1,19 @@
+#ifndef __VST_DISTANCE_H__
+#define __VST_DISTANCE_H__
+
+namespace vst {
+
+/**
+ * Default distance of NearestNeighborIterator for arithmetic keys. The larger
+ * key is always the minuend, so unsigned keys do not wrap around.
+ */
+template <class KeyType>
+struct AbsoluteDifference {
+  inline double operator()(KeyType const& a, KeyType const& b) const {
+    return (a < b) ? double(b - a) : double(a - b);
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,5 @@
+#include "epoch.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
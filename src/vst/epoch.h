@@ -0,0 +1,209 @@
+#ifndef __VST_EPOCH_H__
+#define __VST_EPOCH_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace vst {
+
+/**
+ * Epoch-based reclamation for structures whose readers take no locks, such as
+ * ConcurrentAvlTree and OptimisticAvlTree.
+ *
+ * A reader pins the domain for the duration of each read (see EpochGuard),
+ * announcing the global epoch it started in. A writer tags whatever it
+ * unlinks with the global epoch at that time, and may only free it once the
+ * epoch has advanced twice since, as every reader that could still hold a
+ * pointer to it would otherwise have blocked the second advance. The epoch
+ * only advances when every pinned reader has announced the current one.
+ *
+ * Up to MAX_READERS readers may be pinned at once; further ones wait for a
+ * slot to free up.
+ */
+class EpochDomain {
+public:
+  static constexpr std::size_t MAX_READERS = 128;
+
+  EpochDomain() {
+    // empty constructor
+  }
+
+  EpochDomain(EpochDomain const&) = delete;
+  EpochDomain& operator=(EpochDomain const&) = delete;
+
+  inline std::uint64_t getEpoch() const {
+    return epoch.load(std::memory_order_seq_cst);
+  }
+
+  /**
+   * Claims a slot for the calling reader and announces the current epoch in
+   * it, returning the slot.
+   */
+  std::size_t pin() {
+    std::size_t slot = std::hash<std::thread::id>()(std::this_thread::get_id()) % MAX_READERS;
+    std::uint64_t current = epoch.load(std::memory_order_seq_cst);
+    for (std::uint64_t free = 0;
+         !slots[slot].announced.compare_exchange_weak(free, current + 1,
+           std::memory_order_seq_cst);
+         free = 0) {
+      slot = (slot + 1) % MAX_READERS;
+      if (slot == 0) std::this_thread::yield();
+      current = epoch.load(std::memory_order_seq_cst);
+    }
+    // the epoch may have advanced before the announcement was visible
+    for (std::uint64_t next = epoch.load(std::memory_order_seq_cst);
+         next != current;
+         next = epoch.load(std::memory_order_seq_cst)) {
+      slots[slot].announced.store(next + 1, std::memory_order_seq_cst);
+      current = next;
+    }
+    return slot;
+  }
+
+  inline void unpin(std::size_t const slot) {
+    slots[slot].announced.store(0, std::memory_order_release);
+  }
+
+  /**
+   * Advances the epoch if every pinned reader has announced the current one,
+   * returning whether it did.
+   */
+  bool tryAdvance() {
+    std::uint64_t current = epoch.load(std::memory_order_seq_cst);
+    for (Slot const& slot : slots) {
+      std::uint64_t const announced = slot.announced.load(std::memory_order_seq_cst);
+      if (announced != 0 && announced != current + 1) return false;
+    }
+    return epoch.compare_exchange_strong(current, current + 1,
+      std::memory_order_seq_cst);
+  }
+
+private:
+
+  struct alignas(64) Slot {
+    /** The announced epoch plus one, or zero when the slot is free */
+    std::atomic<std::uint64_t> announced{0};
+  };
+
+  std::atomic<std::uint64_t> epoch{0};
+  Slot slots[MAX_READERS];
+};
+
+/**
+ * Pins an EpochDomain for as long as it is in scope. Nodes read from the
+ * structure the domain protects may only be used while their guard lives.
+ */
+class EpochGuard {
+public:
+
+  explicit EpochGuard(EpochDomain& domain)
+    : domain(domain),
+      slot(domain.pin()) {
+    // empty constructor
+  }
+
+  EpochGuard(EpochGuard const&) = delete;
+  EpochGuard& operator=(EpochGuard const&) = delete;
+
+  ~EpochGuard() {
+    domain.unpin(slot);
+  }
+
+private:
+  EpochDomain& domain;
+  std::size_t const slot;
+};
+
+/**
+ * Frees what the writers of an OptimisticAvlTree unlink, once no reader of the
+ * domain can still hold it. Unlike EpochNodeAllocator, any number of threads
+ * may retire at once: each retires into one of LIST_COUNT lists, picked by its
+ * thread, so writers seldom wait for each other.
+ */
+template <std::size_t CollectThreshold = 64>
+class EpochCollector {
+public:
+  static constexpr std::size_t LIST_COUNT = 16;
+
+  explicit EpochCollector(EpochDomain& domain)
+    : domain(domain) {
+    // empty constructor
+  }
+
+  EpochCollector(EpochCollector const&) = delete;
+  EpochCollector& operator=(EpochCollector const&) = delete;
+
+  ~EpochCollector() {
+    release();
+  }
+
+  template <class ObjectType>
+  void retire(ObjectType const* const object) {
+    // orders the unlinking of the object before the read of the epoch, which
+    // readers pin in the opposite order
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    List& list = lists[std::hash<std::thread::id>()(std::this_thread::get_id()) % LIST_COUNT];
+    std::lock_guard<std::mutex> const lock(list.mutex);
+    list.retired.push_back({object, &destroy<ObjectType>, domain.getEpoch()});
+    if (list.retired.size() >= CollectThreshold) {
+      domain.tryAdvance();
+      std::uint64_t const epoch = domain.getEpoch();
+      while (!list.retired.empty() && list.retired.front().epoch + 2 <= epoch) {
+        list.retired.front().destroy(list.retired.front().object);
+        list.retired.pop_front();
+      }
+    }
+  }
+
+  /**
+   * Frees every retired object, which requires that no reader is pinned.
+   */
+  void release() {
+    for (List& list : lists) {
+      std::lock_guard<std::mutex> const lock(list.mutex);
+      for (Retired const& retired : list.retired) {
+        retired.destroy(retired.object);
+      }
+      list.retired.clear();
+    }
+  }
+
+  std::size_t getRetiredCount() {
+    std::size_t count = 0;
+    for (List& list : lists) {
+      std::lock_guard<std::mutex> const lock(list.mutex);
+      count += list.retired.size();
+    }
+    return count;
+  }
+
+private:
+
+  struct Retired {
+    void const* object;
+    void (*destroy)(void const*);
+    std::uint64_t epoch;
+  };
+
+  struct alignas(64) List {
+    std::mutex mutex;
+    std::deque<Retired> retired;
+  };
+
+  EpochDomain& domain;
+  List lists[LIST_COUNT];
+
+  template <class ObjectType>
+  static void destroy(void const* const object) {
+    delete static_cast<ObjectType const*>(object);
+  }
+};
+
+}
+
+#endif
@@ -0,0 +1,5 @@
+#include "frozen_tree.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
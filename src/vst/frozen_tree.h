@@ -0,0 +1,399 @@
+#ifndef __VST_FROZEN_TREE_H__
+#define __VST_FROZEN_TREE_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "compare.h"
+#include "distance.h"
+#include "nearest_neighbor_iterator.h"
+#include "range_iterator.h"
+
+namespace vst {
+
+/**
+ * Position of a key within a FrozenTree, which is what its queries return in
+ * place of a node. The vine is implied by the sorted positions, so the
+ * neighbors of an entry are the entries before and after it. An entry past
+ * either end converts to false.
+ */
+template <class TreeType>
+class FrozenEntry {
+public:
+
+  FrozenEntry() {
+    // empty constructor
+  }
+
+  FrozenEntry(TreeType const* const tree, std::size_t const position)
+    : tree(tree),
+      position(position) {
+    // empty constructor
+  }
+
+  inline std::size_t getPosition() const {
+    return position;
+  }
+
+  inline auto getKey() const {
+    return tree->getKey(position);
+  }
+
+  inline auto getValue() const {
+    return *tree->getValues(position).begin();
+  }
+
+  inline auto getValues() const {
+    return tree->getValues(position);
+  }
+
+  inline FrozenEntry getGreaterNeighbor() const {
+    return (position + 1 < tree->getKeyCount())
+      ? FrozenEntry(tree, position + 1)
+      : FrozenEntry();
+  }
+
+  inline FrozenEntry getLesserNeighbor() const {
+    return (position > 0)
+      ? FrozenEntry(tree, position - 1)
+      : FrozenEntry();
+  }
+
+  inline explicit operator bool() const {
+    return tree != nullptr;
+  }
+
+  inline bool operator==(FrozenEntry const& other) const {
+    return tree == other.tree && (!tree || position == other.position);
+  }
+
+  inline bool operator!=(FrozenEntry const& other) const {
+    return !(*this == other);
+  }
+
+private:
+  TreeType const* tree = nullptr;
+  std::size_t position = 0;
+};
+
+/**
+ * Immutable, pointer-free snapshot of a Tree, as returned by Tree::freeze(),
+ * for indices that are only read between rebuilds.
+ *
+ * The distinct keys are kept sorted in one array, and their values in a
+ * parallel array, so the vine is implied by position and range scans read
+ * contiguous memory. Searches run on a second copy of the keys in Eytzinger
+ * order, i.e. the breadth-first order of a complete binary search tree, in
+ * which the children of the key at index k are at 2k and 2k + 1. A descent
+ * has no branch to mispredict, and since the descendants of a key a few
+ * levels down are adjacent, each step prefetches the cache line the search
+ * will reach a few levels later. The position of the key a search ends at
+ * follows from its index, so nothing else is stored per key.
+ *
+ * Queries return a FrozenEntry in place of a node, which stays valid as long
+ * as the snapshot. The snapshot does not refer to the tree it was frozen
+ * from.
+ */
+template <class KeyType, class ValueType,
+          class Compare = ThreeWayCompare<KeyType>>
+class FrozenTree {
+public:
+  typedef FrozenEntry<FrozenTree> Entry;
+
+  /** Keys per cache line, the factor by which each step prefetches ahead */
+  static constexpr std::size_t PREFETCH_STRIDE =
+    (sizeof(KeyType) < 64) ? 64 / sizeof(KeyType) : 1;
+
+  /**
+   * The values of a key.
+   */
+  class Values {
+  public:
+    Values(ValueType const* const first, ValueType const* const last)
+      : first(first),
+        last(last) {
+      // empty constructor
+    }
+
+    inline ValueType const* begin() const {
+      return first;
+    }
+
+    inline ValueType const* end() const {
+      return last;
+    }
+
+    inline std::size_t size() const {
+      return last - first;
+    }
+
+    inline bool empty() const {
+      return first == last;
+    }
+
+  private:
+    ValueType const* first;
+    ValueType const* last;
+  };
+
+  FrozenTree() {
+    // empty constructor
+  }
+
+  /**
+   * Copies the keys and values along the vine that starts at the least node,
+   * which must be sorted by compare.
+   */
+  template <class NodeType>
+  explicit FrozenTree(NodeType const* node, Compare compare = Compare())
+    : compare(std::move(compare)) {
+    value_offsets.push_back(0);
+    for (; node; node = node->getGreaterNeighbor()) {
+      keys.push_back(node->getKey());
+      for (ValueType const& value : node->getValues()) {
+        values.push_back(value);
+      }
+      value_offsets.push_back(values.size());
+    }
+    layout.resize(keys.size() + 1);
+    layOut(0, 1);
+  }
+
+  /**
+   * Returns the number of values, like Tree::getSize.
+   */
+  inline std::size_t getSize() const {
+    return values.size();
+  }
+
+  inline std::size_t getKeyCount() const {
+    return keys.size();
+  }
+
+  inline KeyType const& getKey(std::size_t const position) const {
+    return keys[position];
+  }
+
+  inline Values getValues(std::size_t const position) const {
+    return Values(values.data() + value_offsets[position],
+                  values.data() + value_offsets[position + 1]);
+  }
+
+  inline Entry getLeast() const {
+    return getEntry(0);
+  }
+
+  inline Entry getGreatest() const {
+    return (keys.empty()) ? Entry() : Entry(this, keys.size() - 1);
+  }
+
+  inline bool containsKey(KeyType const key) const {
+    return static_cast<bool>(find(key));
+  }
+
+  Entry find(KeyType const key) const {
+    std::size_t const position = search(key, false);
+    return (position < keys.size() && compare(keys[position], key) == 0)
+      ? Entry(this, position)
+      : Entry();
+  }
+
+  inline Entry findNearestGTE(KeyType const key) const {
+    return getEntry(search(key, false));
+  }
+
+  inline Entry findNearestGT(KeyType const key) const {
+    return getEntry(search(key, true));
+  }
+
+  inline Entry findNearestLTE(KeyType const key) const {
+    std::size_t const position = search(key, true);
+    return (position > 0) ? Entry(this, position - 1) : Entry();
+  }
+
+  inline Entry findNearestLT(KeyType const key) const {
+    std::size_t const position = search(key, false);
+    return (position > 0) ? Entry(this, position - 1) : Entry();
+  }
+
+  /**
+   * Returns the number of keys less than the given one, which for a snapshot
+   * is the position it would have.
+   */
+  inline std::size_t rank(KeyType const key) const {
+    return search(key, false);
+  }
+
+  auto getRange(KeyType const lower_key, KeyType const upper_key) const {
+    auto iter = new RangeIterator<Entry, KeyType, Compare>();
+    if (Entry const entry = findNearestGTE(lower_key)) {
+      iter->setCursor(entry)->setCompare(compare)->setUpperKey(upper_key);
+    }
+    return iter;
+  }
+
+  /**
+   * Like Tree::getNeighbors, over positions rather than nodes.
+   */
+  auto getNeighbors(
+      KeyType const key,
+      unsigned int const n_less,
+      unsigned int const n_greater) const {
+
+    auto iter = new RangeIterator<Entry, KeyType, Compare>();
+
+    if (!keys.empty()) {
+      // like the vine walks of Tree, include the nearest neighbor on each
+      // side even when no neighbor is asked for
+      std::size_t const lower = search(key, false);
+      std::size_t const upper = search(key, true);
+      std::size_t const first = lower - std::min<std::size_t>(std::max(n_less, 1u), lower);
+      std::size_t const last = std::min<std::size_t>(
+        upper + std::max(n_greater, 1u), keys.size()) - 1;
+      iter->setCursor(Entry(this, first))->setCompare(compare)
+        ->setUpperKey(keys[last]);
+    }
+
+    return iter;
+  }
+
+  template <class Distance = AbsoluteDifference<KeyType>>
+  auto getNearestNeighbors(
+      KeyType const key,
+      unsigned int const k_neighbors,
+      Distance const& distance = Distance()) const {
+
+    auto iter = new NearestNeighborIterator<Entry, KeyType, Distance>();
+
+    if (!keys.empty()) {
+      Entry const entry = findNearestGTE(key);
+      iter->setKey(key)->setDistance(distance)->setLimit(k_neighbors)
+        ->setCursor((entry) ? entry : getGreatest());
+    }
+
+    return iter;
+  }
+
+  /**
+   * Verifies that the keys are sorted and distinct, and that the Eytzinger
+   * layout is an in-order copy of them.
+   */
+  bool checkInvariants() const {
+    for (std::size_t i = 1; i < keys.size(); ++i) {
+      if (compare(keys[i - 1], keys[i]) >= 0) return false;
+    }
+    for (std::size_t k = 1; k <= keys.size(); ++k) {
+      if (compare(layout[k], keys[getPosition(k)]) != 0) return false;
+    }
+    return value_offsets.size() == keys.size() + 1
+      && value_offsets.back() == values.size();
+  }
+
+private:
+  std::vector<KeyType> keys;
+  std::vector<std::size_t> value_offsets;
+  std::vector<ValueType> values;
+
+  /** The keys in Eytzinger order, from index 1 */
+  std::vector<KeyType> layout;
+
+  Compare compare = {};
+
+  inline Entry getEntry(std::size_t const position) const {
+    return (position < keys.size()) ? Entry(this, position) : Entry();
+  }
+
+  /**
+   * Copies the keys from the position on into the subtree rooted at index k,
+   * in order, and returns the position that follows them.
+   */
+  std::size_t layOut(std::size_t position, std::size_t const k) {
+    if (k < layout.size()) {
+      position = layOut(position, 2 * k);
+      layout[k] = keys[position];
+      position = layOut(position + 1, 2 * k + 1);
+    }
+    return position;
+  }
+
+  /**
+   * Returns the position of the first key no less than the given one (or
+   * greater, when strict), or the number of keys if there is none.
+   *
+   * The descent turns right past each key that is less, which appends a 1 to
+   * the binary index, and left otherwise, which appends a 0. Once past the
+   * leaves, the last left turn, i.e. the least key that was not less, is
+   * found by dropping the trailing 1s and the 0 before them.
+   */
+  std::size_t search(KeyType const& key, bool const strict) const {
+    std::size_t const count = keys.size();
+    KeyType const* const layout = this->layout.data();
+    std::size_t k = 1;
+    if (strict) {
+      while (k <= count) {
+        prefetch(layout + std::min(PREFETCH_STRIDE * k, count));
+        k = 2 * k + (compare(layout[k], key) <= 0);
+      }
+    }
+    else {
+      while (k <= count) {
+        prefetch(layout + std::min(PREFETCH_STRIDE * k, count));
+        k = 2 * k + (compare(layout[k], key) < 0);
+      }
+    }
+    k >>= countTrailingOnes(k) + 1;
+    return (k) ? getPosition(k) : count;
+  }
+
+  /**
+   * Returns the position of the key at index k of the layout. In a perfect
+   * tree with as many levels as the layout, the key at offset i of level d
+   * would be at position (2i + 1) * 2^(height - d) - 1, where the leaves take
+   * the even positions. The last level has only its first leaves, so the
+   * positions past them are shifted down by the leaves that are missing.
+   */
+  std::size_t getPosition(std::size_t const k) const {
+    unsigned int const height = floorLog2(keys.size());
+    unsigned int const depth = floorLog2(k);
+    std::size_t const offset = k - (std::size_t(1) << depth);
+    std::size_t const position = ((2 * offset + 1) << (height - depth)) - 1;
+    std::size_t const leaf_positions =
+      2 * (keys.size() + 1 - (std::size_t(1) << height));
+    return (position < leaf_positions)
+      ? position
+      : (position + leaf_positions - 1) / 2;
+  }
+
+  static inline void prefetch(KeyType const* const address) {
+#ifdef __GNUC__
+    __builtin_prefetch(address);
+#endif
+  }
+
+  static inline unsigned int floorLog2(std::size_t k) {
+#ifdef __GNUC__
+    return 63 - __builtin_clzll(static_cast<unsigned long long>(k));
+#else
+    unsigned int log = 0;
+    for (; k > 1; k >>= 1) log += 1;
+    return log;
+#endif
+  }
+
+  static inline unsigned int countTrailingOnes(std::size_t k) {
+#ifdef __GNUC__
+    return __builtin_ctzll(~static_cast<unsigned long long>(k));
+#else
+    unsigned int ones = 0;
+    for (; k & 1; k >>= 1) ones += 1;
+    return ones;
+#endif
+  }
+};
+
+}
+
+#endif
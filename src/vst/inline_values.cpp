@@ -0,0 +1,5 @@
+#include "inline_values.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
@@ -0,0 +1,141 @@
+#ifndef __VST_INLINE_VALUES_H__
+#define __VST_INLINE_VALUES_H__
+
+#include <cstdint>
+#include <utility>
+
+namespace vst {
+
+/**
+ * Sequence of values that keeps its first value inline, and only moves to the
+ * heap once a second value is added. Meant to replace the std::vector of a
+ * Node when most keys map to a single value, which saves the node an
+ * allocation and getValue() a pointer chase.
+ *
+ * Once on the heap, the capacity is the power of two that follows the size,
+ * so it does not need to be stored.
+ */
+template <class ValueType>
+class InlineValues {
+public:
+  typedef ValueType value_type;
+  typedef ValueType* iterator;
+  typedef ValueType const* const_iterator;
+
+  InlineValues() {
+    // empty constructor
+  }
+
+  InlineValues(InlineValues const& other) {
+    for (ValueType const& value : other) {
+      push_back(value);
+    }
+  }
+
+  InlineValues(InlineValues&& other)
+    : heap(other.heap),
+      count(other.count),
+      value(std::move(other.value)) {
+    other.heap = nullptr;
+    other.count = 0;
+  }
+
+  InlineValues& operator=(InlineValues other) {
+    std::swap(heap, other.heap);
+    std::swap(count, other.count);
+    std::swap(value, other.value);
+    return *this;
+  }
+
+  ~InlineValues() {
+    delete[] heap;
+  }
+
+  inline std::size_t size() const {
+    return count;
+  }
+
+  inline bool empty() const {
+    return count == 0;
+  }
+
+  inline bool isInline() const {
+    return heap == nullptr;
+  }
+
+  inline iterator begin() {
+    return (heap) ? heap : &value;
+  }
+
+  inline const_iterator begin() const {
+    return (heap) ? heap : &value;
+  }
+
+  inline iterator end() {
+    return begin() + count;
+  }
+
+  inline const_iterator end() const {
+    return begin() + count;
+  }
+
+  inline ValueType& front() {
+    return *begin();
+  }
+
+  inline ValueType const& front() const {
+    return *begin();
+  }
+
+  inline ValueType const& operator[](std::size_t const index) const {
+    return begin()[index];
+  }
+
+  void push_back(ValueType const& value) {
+    if (heap) {
+      if (count >= 2 && (count & (count - 1)) == 0) {
+        ValueType* const values = new ValueType[2 * count];
+        for (std::uint32_t i = 0; i < count; ++i) {
+          values[i] = std::move(heap[i]);
+        }
+        delete[] heap;
+        heap = values;
+      }
+      heap[count] = value;
+    }
+    else if (count == 0) {
+      this->value = value;
+    }
+    else {
+      heap = new ValueType[2];
+      heap[0] = std::move(this->value);
+      heap[1] = value;
+    }
+    count += 1;
+  }
+
+  /**
+   * Removes every value, keeping the heap storage (if any) for reuse.
+   */
+  inline void clear() {
+    count = 0;
+  }
+
+  iterator erase(iterator const position) {
+    iterator const last = end() - 1;
+    for (iterator iter = position; iter != last; ++iter) {
+      *iter = std::move(*(iter + 1));
+    }
+    count -= 1;
+    return position;
+  }
+
+private:
+  ValueType* heap = nullptr;
+  std::uint32_t count = 0;
+  ValueType value = {};
+};
+
+}
+
+#endif
@@ -0,0 +1,5 @@
+#include "key_ranges.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
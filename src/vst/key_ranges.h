@@ -0,0 +1,109 @@
+#ifndef __VST_KEY_RANGES_H__
+#define __VST_KEY_RANGES_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "compare.h"
+
+namespace vst {
+
+/**
+ * Consecutive ranges of keys, split at sorted split keys: range i holds the
+ * keys from split key i - 1 (inclusive) up to split key i (exclusive). Routes
+ * keys to the shards of ShardedTree.
+ */
+template <class KeyType, class Compare = ThreeWayCompare<KeyType>>
+class KeyRanges {
+public:
+
+  explicit KeyRanges(std::vector<KeyType> split_keys, Compare compare = Compare())
+    : split_keys(std::move(split_keys)),
+      compare(std::move(compare)) {
+    // empty constructor
+  }
+
+  /**
+   * Returns the split keys at the quantiles of the sample that divide it into
+   * the given number of ranges.
+   */
+  static std::vector<KeyType> sampleSplitKeys(
+      std::vector<KeyType> sample,
+      std::size_t const range_count,
+      Compare const& compare = Compare()) {
+    std::vector<KeyType> split_keys;
+    if (sample.empty()) return split_keys;
+    std::sort(sample.begin(), sample.end(),
+      [&compare](KeyType const& a, KeyType const& b) {
+        return compare(a, b) < 0;
+      });
+    for (std::size_t i = 1; i < range_count; ++i) {
+      split_keys.push_back(sample[i * sample.size() / range_count]);
+    }
+    return split_keys;
+  }
+
+  inline std::size_t getCount() const {
+    return split_keys.size() + 1;
+  }
+
+  inline std::vector<KeyType> const& getSplitKeys() const {
+    return split_keys;
+  }
+
+  /**
+   * Moves the split keys, keeping their number.
+   */
+  inline void setSplitKeys(std::vector<KeyType> split_keys) {
+    this->split_keys = std::move(split_keys);
+  }
+
+  inline Compare const& getCompare() const {
+    return compare;
+  }
+
+  /**
+   * Returns the index of the range that holds the key.
+   */
+  std::size_t getIndex(KeyType const& key) const {
+    return std::upper_bound(split_keys.begin(), split_keys.end(), key,
+      [this](KeyType const& a, KeyType const& b) {
+        return compare(a, b) < 0;
+      }) - split_keys.begin();
+  }
+
+  /**
+   * Returns whether the keys from the least to the greatest lie within the
+   * range of the index.
+   */
+  bool contains(std::size_t const index, KeyType const& least, KeyType const& greatest) const {
+    return (index == 0 || compare(least, split_keys[index - 1]) >= 0)
+      && (index == split_keys.size() || compare(greatest, split_keys[index]) < 0);
+  }
+
+  /**
+   * Calls find with the index of the range of the key, then with those after
+   * it (or before it, when lesser), until it returns a result that converts
+   * to true, and returns the last result. Serves nearest-key lookups that
+   * spill over empty or exhausted ranges.
+   */
+  template <class Find>
+  auto findAcross(KeyType const& key, bool const lesser, Find find) const {
+    std::size_t index = getIndex(key);
+    auto result = find(index);
+    while (!result && ((lesser) ? index-- > 0 : ++index < getCount())) {
+      result = find(index);
+    }
+    return result;
+  }
+
+private:
+  std::vector<KeyType> split_keys;
+  Compare compare;
+};
+
+}
+
+#endif
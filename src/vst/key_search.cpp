@@ -0,0 +1,5 @@
+#include "key_search.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
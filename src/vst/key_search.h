@@ -0,0 +1,295 @@
+#ifndef __VST_KEY_SEARCH_H__
+#define __VST_KEY_SEARCH_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if !defined(VST_NO_SIMD) && defined(__GNUC__) \
+    && (defined(__x86_64__) || defined(__i386__))
+#define VST_KEY_SEARCH_AVX2
+#include <immintrin.h>
+#endif
+
+namespace vst {
+
+/**
+ * Lower and upper bounds within sorted arrays of keys, under the order of
+ * their operator< (that of ThreeWayCompare). Such arrays are the blocks of a
+ * BlockNode.
+ *
+ * The generic version is a binary search. For arithmetic keys, the search is
+ * narrowed down to a few cache lines, within which the keys less than the
+ * given one are counted rather than searched for. The count has no branches
+ * to mispredict, and for 32- and 64-bit integers, floats and doubles it takes
+ * 8 or 4 keys at a time with AVX2 when the CPU supports it, which is
+ * detected once at runtime. Define VST_NO_SIMD to always count one key at a
+ * time.
+ */
+template <class KeyType, class = void>
+struct KeySearch {
+  static constexpr bool VECTORIZED = false;
+
+  static std::uint32_t lowerBound(
+      KeyType const* const keys,
+      std::uint32_t count,
+      KeyType const& key) {
+    std::uint32_t first = 0;
+    while (count > 0) {
+      std::uint32_t const half = count / 2;
+      if (keys[first + half] < key) {
+        first += half + 1;
+        count -= half + 1;
+      }
+      else {
+        count = half;
+      }
+    }
+    return first;
+  }
+
+  static std::uint32_t upperBound(
+      KeyType const* const keys,
+      std::uint32_t count,
+      KeyType const& key) {
+    std::uint32_t first = 0;
+    while (count > 0) {
+      std::uint32_t const half = count / 2;
+      if (!(key < keys[first + half])) {
+        first += half + 1;
+        count -= half + 1;
+      }
+      else {
+        count = half;
+      }
+    }
+    return first;
+  }
+};
+
+#ifdef VST_KEY_SEARCH_AVX2
+
+inline bool hasAvx2() {
+  static bool const supported = __builtin_cpu_supports("avx2");
+  return supported;
+}
+
+/**
+ * AVX2 kernels, which count the keys less than the given one (or no greater,
+ * when or_equal) among the first count keys, a multiple of the number of
+ * keys per vector. Unsigned keys are compared as signed ones by flipping
+ * their sign bits.
+ */
+
+__attribute__((target("avx2")))
+inline std::uint32_t countLessAvx2(
+    std::int32_t const* const keys,
+    std::uint32_t const count,
+    std::int32_t const key,
+    bool const or_equal,
+    std::int32_t const flip = 0) {
+  __m256i const flips = _mm256_set1_epi32(flip);
+  __m256i const target = _mm256_set1_epi32(key ^ flip);
+  std::uint32_t greater = 0;
+  std::uint32_t less = 0;
+  for (std::uint32_t i = 0; i < count; i += 8) {
+    __m256i const block = _mm256_xor_si256(flips,
+      _mm256_loadu_si256(reinterpret_cast<__m256i const*>(keys + i)));
+    if (or_equal) {
+      greater += __builtin_popcount(_mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_cmpgt_epi32(block, target))));
+    }
+    else {
+      less += __builtin_popcount(_mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_cmpgt_epi32(target, block))));
+    }
+  }
+  return (or_equal) ? count - greater : less;
+}
+
+__attribute__((target("avx2")))
+inline std::uint32_t countLessAvx2(
+    std::int64_t const* const keys,
+    std::uint32_t const count,
+    std::int64_t const key,
+    bool const or_equal,
+    std::int64_t const flip = 0) {
+  __m256i const flips = _mm256_set1_epi64x(flip);
+  __m256i const target = _mm256_set1_epi64x(key ^ flip);
+  std::uint32_t greater = 0;
+  std::uint32_t less = 0;
+  for (std::uint32_t i = 0; i < count; i += 4) {
+    __m256i const block = _mm256_xor_si256(flips,
+      _mm256_loadu_si256(reinterpret_cast<__m256i const*>(keys + i)));
+    if (or_equal) {
+      greater += __builtin_popcount(_mm256_movemask_pd(
+        _mm256_castsi256_pd(_mm256_cmpgt_epi64(block, target))));
+    }
+    else {
+      less += __builtin_popcount(_mm256_movemask_pd(
+        _mm256_castsi256_pd(_mm256_cmpgt_epi64(target, block))));
+    }
+  }
+  return (or_equal) ? count - greater : less;
+}
+
+__attribute__((target("avx2")))
+inline std::uint32_t countLessAvx2(
+    std::uint32_t const* const keys,
+    std::uint32_t const count,
+    std::uint32_t const key,
+    bool const or_equal) {
+  return countLessAvx2(reinterpret_cast<std::int32_t const*>(keys), count,
+    std::int32_t(key), or_equal, INT32_MIN);
+}
+
+__attribute__((target("avx2")))
+inline std::uint32_t countLessAvx2(
+    std::uint64_t const* const keys,
+    std::uint32_t const count,
+    std::uint64_t const key,
+    bool const or_equal) {
+  return countLessAvx2(reinterpret_cast<std::int64_t const*>(keys), count,
+    std::int64_t(key), or_equal, INT64_MIN);
+}
+
+__attribute__((target("avx2")))
+inline std::uint32_t countLessAvx2(
+    float const* const keys,
+    std::uint32_t const count,
+    float const key,
+    bool const or_equal) {
+  __m256 const target = _mm256_set1_ps(key);
+  std::uint32_t result = 0;
+  for (std::uint32_t i = 0; i < count; i += 8) {
+    __m256 const block = _mm256_loadu_ps(keys + i);
+    result += __builtin_popcount(_mm256_movemask_ps((or_equal)
+      ? _mm256_cmp_ps(block, target, _CMP_LE_OQ)
+      : _mm256_cmp_ps(block, target, _CMP_LT_OQ)));
+  }
+  return result;
+}
+
+__attribute__((target("avx2")))
+inline std::uint32_t countLessAvx2(
+    double const* const keys,
+    std::uint32_t const count,
+    double const key,
+    bool const or_equal) {
+  __m256d const target = _mm256_set1_pd(key);
+  std::uint32_t result = 0;
+  for (std::uint32_t i = 0; i < count; i += 4) {
+    __m256d const block = _mm256_loadu_pd(keys + i);
+    result += __builtin_popcount(_mm256_movemask_pd((or_equal)
+      ? _mm256_cmp_pd(block, target, _CMP_LE_OQ)
+      : _mm256_cmp_pd(block, target, _CMP_LT_OQ)));
+  }
+  return result;
+}
+
+#endif
+
+/**
+ * The type whose AVX2 kernel handles keys of the given arithmetic type, or
+ * void if there is none.
+ */
+template <class KeyType>
+using Avx2KeyType = std::conditional_t<
+  std::is_floating_point_v<KeyType>,
+  std::conditional_t<std::is_same_v<KeyType, float>, float,
+    std::conditional_t<std::is_same_v<KeyType, double>, double, void>>,
+  std::conditional_t<sizeof(KeyType) == 4 && !std::is_same_v<KeyType, bool>,
+    std::conditional_t<std::is_signed_v<KeyType>, std::int32_t, std::uint32_t>,
+    std::conditional_t<sizeof(KeyType) == 8,
+      std::conditional_t<std::is_signed_v<KeyType>, std::int64_t, std::uint64_t>,
+      void>>>;
+
+template <class KeyType>
+struct KeySearch<KeyType, std::enable_if_t<std::is_arithmetic_v<KeyType>>> {
+  static constexpr bool VECTORIZED = !std::is_void_v<Avx2KeyType<KeyType>>;
+
+  /** Keys counted at once, at most 4 cache lines */
+  static constexpr std::uint32_t WINDOW = 256 / sizeof(KeyType);
+
+  static inline std::uint32_t lowerBound(
+      KeyType const* const keys,
+      std::uint32_t const count,
+      KeyType const key) {
+    return search(keys, count, key, false);
+  }
+
+  static inline std::uint32_t upperBound(
+      KeyType const* const keys,
+      std::uint32_t const count,
+      KeyType const key) {
+    return search(keys, count, key, true);
+  }
+
+  /**
+   * Counts the keys less than the given one (or no greater, when or_equal),
+   * with AVX2 if possible.
+   */
+  static std::uint32_t count(
+      KeyType const* const keys,
+      std::uint32_t const count,
+      KeyType const key,
+      bool const or_equal) {
+    std::uint32_t result = 0;
+    std::uint32_t first = 0;
+#ifdef VST_KEY_SEARCH_AVX2
+    if constexpr (VECTORIZED) {
+      if (hasAvx2()) {
+        typedef Avx2KeyType<KeyType> LaneType;
+        first = count - count % (32 / sizeof(KeyType));
+        result = countLessAvx2(reinterpret_cast<LaneType const*>(keys), first,
+          LaneType(key), or_equal);
+      }
+    }
+#endif
+    return result + countScalar(keys + first, count - first, key, or_equal);
+  }
+
+  static std::uint32_t countScalar(
+      KeyType const* const keys,
+      std::uint32_t const count,
+      KeyType const key,
+      bool const or_equal) {
+    std::uint32_t result = 0;
+    if (or_equal) {
+      for (std::uint32_t i = 0; i < count; ++i) {
+        result += !(key < keys[i]);
+      }
+    }
+    else {
+      for (std::uint32_t i = 0; i < count; ++i) {
+        result += keys[i] < key;
+      }
+    }
+    return result;
+  }
+
+private:
+
+  static std::uint32_t search(
+      KeyType const* const keys,
+      std::uint32_t count,
+      KeyType const key,
+      bool const or_equal) {
+    std::uint32_t first = 0;
+    while (count > WINDOW) {
+      std::uint32_t const half = count / 2;
+      if ((or_equal) ? !(key < keys[first + half]) : keys[first + half] < key) {
+        first += half + 1;
+        count -= half + 1;
+      }
+      else {
+        count = half;
+      }
+    }
+    return first + KeySearch::count(keys + first, count, key, or_equal);
+  }
+};
+
+}
+
+#endif
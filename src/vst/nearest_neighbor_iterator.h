@@ -1,24 +1,36 @@
 #ifndef __VST_NEAREST_NEIGHBOR_ITERATOR_H__
 #define __VST_NEAREST_NEIGHBOR_ITERATOR_H__
 
-#include <functional>
 #include <math.h>
 
+#include "distance.h"
 #include "iterator.h"
+#include "vine_cursor.h"
 
 namespace vst {
 
-template <class NodeType, class KeyType>
-class NearestNeighborIterator : public Iterator<NodeType*> {
+/**
+ * Iterates over the nearest neighbors of a key along the vine, from a cursor
+ * (see VineCursor) such as a pointer to a node or an entry of a BlockTree.
+ *
+ * The Distance type is called with two keys and returns their distance as a
+ * double. It must not decrease as keys move away from each other along the
+ * vine, which is what lets the iterator expand outward one neighbor at a time.
+ */
+template <class CursorType, class KeyType,
+          class Distance = AbsoluteDifference<KeyType>>
+class NearestNeighborIterator : public Iterator<CursorType> {
+  typedef VineCursor<CursorType> Cursor;
+
 public:
-  using Iterator<NodeType*>::Iterator;
+  using Iterator<CursorType>::Iterator;
 
   inline auto setKey(KeyType const key) {
     this->key = key;
     return this;
   }
 
-  inline auto setDistance(std::function<double (KeyType, KeyType)> const distance) {
+  inline auto setDistance(Distance const& distance) {
     this->distance = distance;
     return this;
   }
@@ -31,12 +43,12 @@ public:
   /**
    * This should be the last setter called ...
    */
-  NearestNeighborIterator<NodeType,KeyType>* setNode(NodeType* const node) {
+  NearestNeighborIterator* setCursor(CursorType const cursor) {
     if (limit > 0) {
       this->has_advanced = false;
-      this->next_element = findNearest(node);
-      setLesserNeighbor(this->next_element->getLesserNeighbor());
-      setGreaterNeighbor(this->next_element->getGreaterNeighbor());
+      this->next_element = findNearest(cursor);
+      setLesserNeighbor(Cursor::get(this->next_element).getLesserNeighbor());
+      setGreaterNeighbor(Cursor::get(this->next_element).getGreaterNeighbor());
       index = 1;
     }
     return this;
@@ -48,13 +60,13 @@ protected:
     if (this->has_advanced && index < limit) {
       if (d_lesser_neighbor < d_greater_neighbor) {
         this->next_element = lesser_neighbor;
-        setLesserNeighbor(lesser_neighbor->getLesserNeighbor());
+        setLesserNeighbor(Cursor::get(lesser_neighbor).getLesserNeighbor());
         this->has_advanced = false;
         index += 1;
       }
       else if (greater_neighbor) {
         this->next_element = greater_neighbor;
-        setGreaterNeighbor(greater_neighbor->getGreaterNeighbor());
+        setGreaterNeighbor(Cursor::get(greater_neighbor).getGreaterNeighbor());
         this->has_advanced = false;
         index += 1;
       }
@@ -62,74 +74,58 @@ protected:
   }
 
 private:
-  std::function<double (KeyType, KeyType)> distance;
-  NodeType* lesser_neighbor;
-  NodeType* greater_neighbor;
-  double d_lesser_neighbor;
-  double d_greater_neighbor;
-  KeyType key;
-  unsigned int limit;
-  unsigned int index;
-
-  void setLesserNeighbor(NodeType* const lesser_neighbor) {
+  Distance distance = {};
+  CursorType lesser_neighbor = {};
+  CursorType greater_neighbor = {};
+  double d_lesser_neighbor = INFINITY;
+  double d_greater_neighbor = INFINITY;
+  KeyType key = {};
+  unsigned int limit = 0;
+  unsigned int index = 0;
+
+  void setLesserNeighbor(CursorType const lesser_neighbor) {
     this->lesser_neighbor = lesser_neighbor;
-    this->d_lesser_neighbor = (lesser_neighbor != nullptr)
-      ? distance(lesser_neighbor->getKey(), key)
+    this->d_lesser_neighbor = (lesser_neighbor)
+      ? distance(Cursor::get(lesser_neighbor).getKey(), key)
       : INFINITY;
   }
 
-  void setGreaterNeighbor(NodeType* const greater_neighbor) {
+  void setGreaterNeighbor(CursorType const greater_neighbor) {
     this->greater_neighbor = greater_neighbor;
-    this->d_greater_neighbor = (greater_neighbor != nullptr)
-      ? distance(greater_neighbor->getKey(), key)
+    this->d_greater_neighbor = (greater_neighbor)
+      ? distance(Cursor::get(greater_neighbor).getKey(), key)
       : INFINITY;
   }
 
-  NodeType* findNearest(NodeType* node) {
-    NodeType* lesser_neighbor = node->getLesserNeighbor();
-    NodeType* greater_neighbor = node->getGreaterNeighbor();
-    while (true) {
-      if (lesser_neighbor) {
-        if (greater_neighbor) {
-          double const d_node = distance(node->getKey(), key);
-          double const d_lesser_neighbor = distance(lesser_neighbor->getKey(), key);
-          double const d_greater_neighbor = distance(greater_neighbor->getKey(), key);
-          if (d_lesser_neighbor < d_node) {
-            if (d_greater_neighbor < d_lesser_neighbor) {
-              node = greater_neighbor;
-              greater_neighbor = node->getGreaterNeighbor();
-            }
-            else {
-              node = lesser_neighbor;
-              lesser_neighbor = node->getLesserNeighbor();
-            }
-          }
-          else if (d_greater_neighbor < d_node) {
-            node = greater_neighbor;
-            greater_neighbor = node->getGreaterNeighbor();
-          }
-          else {
-            return node;
-          }
-        }
-        else if (distance(lesser_neighbor->getKey(), key) < distance(node->getKey(), key)) {
-          node = lesser_neighbor;
-          lesser_neighbor = node->getLesserNeighbor();
-        }
-        else {
-          return node;
-        }
-      }
-      else if (greater_neighbor) {
-        if (distance(greater_neighbor->getKey(), key) < distance(node->getKey(), key)) {
-          node = greater_neighbor;
-          greater_neighbor = node->getGreaterNeighbor();
-        }
-      }
-      else {
-        return node;
-      }
+  /**
+   * Walks the vine from the cursor toward the key while the distance keeps
+   * shrinking, computing the distance of each visited position once.
+   */
+  CursorType findNearest(CursorType cursor) {
+    CursorType const start = cursor;
+    double d_cursor = distance(Cursor::get(cursor).getKey(), key);
+
+    CursorType lesser_neighbor = Cursor::get(cursor).getLesserNeighbor();
+    while (lesser_neighbor) {
+      double const d_lesser_neighbor = distance(Cursor::get(lesser_neighbor).getKey(), key);
+      if (!(d_lesser_neighbor < d_cursor)) break;
+      cursor = lesser_neighbor;
+      d_cursor = d_lesser_neighbor;
+      lesser_neighbor = Cursor::get(cursor).getLesserNeighbor();
     }
+
+    if (cursor != start) return cursor;
+
+    CursorType greater_neighbor = Cursor::get(cursor).getGreaterNeighbor();
+    while (greater_neighbor) {
+      double const d_greater_neighbor = distance(Cursor::get(greater_neighbor).getKey(), key);
+      if (!(d_greater_neighbor < d_cursor)) break;
+      cursor = greater_neighbor;
+      d_cursor = d_greater_neighbor;
+      greater_neighbor = Cursor::get(cursor).getGreaterNeighbor();
+    }
+
+    return cursor;
   }
 };
 
@@ -5,7 +5,13 @@
 
 namespace vst {
 
-template <class NodeType, class KeyType, class ValueType>
+/**
+ * The values of each key are held in a ValuesType, which may be any sequence
+ * supporting push_back, erase, clear, front, size and iteration, e.g.
+ * InlineValues when most keys have a single value.
+ */
+template <class NodeType, class KeyType, class ValueType,
+          class ValuesType = std::vector<ValueType>>
 class Node {
 public:
 
@@ -13,9 +19,13 @@ public:
     // empty constructor
   }
 
-  virtual ~Node() {
-    if (lesser_child) delete lesser_child;
-    if (greater_child) delete greater_child;
+  /**
+   * Children are not destroyed with their parent; the tree releases its nodes
+   * by walking the vine. The destructor is not virtual since nodes are always
+   * destroyed through their most derived type.
+   */
+  ~Node() {
+    // empty destructor
   }
 
   inline NodeType* setKey(KeyType const key) {
@@ -32,7 +42,17 @@ public:
     return static_cast<NodeType*>(this);
   }
 
-  inline const ::std::vector<ValueType>& getValues() const {
+  bool removeValue(ValueType const value) {
+    for (auto iter = values.begin(); iter != values.end(); ++iter) {
+      if (*iter == value) {
+        values.erase(iter);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  inline const ValuesType& getValues() const {
     return values;
   }
 
@@ -40,6 +60,19 @@ public:
     return values.front();
   }
 
+  inline ValueType& getValue() {
+    return values.front();
+  }
+
+  /**
+   * Replaces every value of the node with the given one.
+   */
+  inline NodeType* setValue(ValueType const value) {
+    values.clear();
+    values.push_back(value);
+    return static_cast<NodeType*>(this);
+  }
+
   inline NodeType* setGreaterChild(
       NodeType* const greater_child) {
     this->greater_child = greater_child;
@@ -111,7 +144,7 @@ public:
 
 protected:
   KeyType key;
-  std::vector<ValueType> values;
+  ValuesType values;
   NodeType* greater_child = nullptr;
   NodeType* lesser_child = nullptr;
   NodeType* greater_neighbor = nullptr;
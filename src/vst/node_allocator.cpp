@@ -0,0 +1,5 @@
+#include "node_allocator.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
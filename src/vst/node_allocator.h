@@ -0,0 +1,259 @@
+#ifndef __VST_NODE_ALLOCATOR_H__
+#define __VST_NODE_ALLOCATOR_H__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "epoch.h"
+
+namespace vst {
+
+/**
+ * Node allocation policies for Tree. Each policy constructs nodes with
+ * allocate(), destroys them with deallocate(), and frees whatever storage it
+ * still holds with release(), which the tree calls once every node has been
+ * destroyed.
+ */
+
+/**
+ * Allocates every node individually on the heap.
+ */
+template <class NodeType>
+class HeapNodeAllocator {
+public:
+
+  inline NodeType* allocate() {
+    return new NodeType();
+  }
+
+  inline void deallocate(NodeType* const node) {
+    delete node;
+  }
+
+  inline void release() {
+    // nothing to release
+  }
+};
+
+/**
+ * Carves nodes from chunks of ChunkSize contiguous slots. Destroyed nodes are
+ * kept on a free list and reused by subsequent allocations, and the chunks are
+ * only returned to the heap by release() (or the destructor), all at once.
+ */
+template <class NodeType, std::size_t ChunkSize = 1024>
+class PoolNodeAllocator {
+public:
+
+  PoolNodeAllocator() {
+    // empty constructor
+  }
+
+  PoolNodeAllocator(PoolNodeAllocator const&) = delete;
+  PoolNodeAllocator& operator=(PoolNodeAllocator const&) = delete;
+
+  PoolNodeAllocator(PoolNodeAllocator&& other)
+    : chunks(std::move(other.chunks)),
+      free_slots(other.free_slots),
+      chunk_index(other.chunk_index) {
+    other.chunks.clear();
+    other.free_slots = nullptr;
+    other.chunk_index = ChunkSize;
+  }
+
+  ~PoolNodeAllocator() {
+    release();
+  }
+
+  NodeType* allocate() {
+    Slot* slot;
+    if (free_slots) {
+      slot = free_slots;
+      free_slots = slot->next;
+    }
+    else {
+      if (chunk_index == ChunkSize) {
+        chunks.push_back(static_cast<Slot*>(
+          ::operator new(ChunkSize * sizeof(Slot))));
+        chunk_index = 0;
+      }
+      slot = chunks.back() + chunk_index;
+      chunk_index += 1;
+    }
+    return new (slot->storage) NodeType();
+  }
+
+  void deallocate(NodeType* const node) {
+    node->~NodeType();
+    Slot* const slot = reinterpret_cast<Slot*>(node);
+    slot->next = free_slots;
+    free_slots = slot;
+  }
+
+  /**
+   * Returns every chunk to the heap. Nodes still allocated from this pool are
+   * not destroyed and must no longer be used.
+   */
+  void release() {
+    for (Slot* const chunk : chunks) {
+      ::operator delete(chunk);
+    }
+    chunks.clear();
+    free_slots = nullptr;
+    chunk_index = ChunkSize;
+  }
+
+  inline std::size_t getChunkCount() const {
+    return chunks.size();
+  }
+
+private:
+
+  union Slot {
+    Slot* next;
+    alignas(NodeType) unsigned char storage[sizeof(NodeType)];
+  };
+
+  std::vector<Slot*> chunks;
+  Slot* free_slots = nullptr;
+  std::size_t chunk_index = ChunkSize;
+};
+
+/**
+ * Allocates nodes from a std::pmr::memory_resource, e.g. a
+ * std::pmr::monotonic_buffer_resource shared by trees that are torn down
+ * together, or a std::pmr::unsynchronized_pool_resource.
+ */
+template <class NodeType>
+class PmrNodeAllocator {
+public:
+
+  PmrNodeAllocator()
+    : resource(std::pmr::get_default_resource()) {
+    // empty constructor
+  }
+
+  explicit PmrNodeAllocator(std::pmr::memory_resource* const resource)
+    : resource(resource) {
+    // empty constructor
+  }
+
+  NodeType* allocate() {
+    void* const storage = resource->allocate(sizeof(NodeType), alignof(NodeType));
+    return new (storage) NodeType();
+  }
+
+  void deallocate(NodeType* const node) {
+    node->~NodeType();
+    resource->deallocate(node, sizeof(NodeType), alignof(NodeType));
+  }
+
+  inline void release() {
+    // the memory resource owns the storage
+  }
+
+  inline std::pmr::memory_resource* getResource() const {
+    return resource;
+  }
+
+private:
+  std::pmr::memory_resource* resource;
+};
+
+/**
+ * Allocates nodes on the heap, but defers freeing them until no reader of an
+ * EpochDomain could still hold them, for trees whose readers take no locks
+ * (see ConcurrentAvlTree). A destroyed node is retired with the epoch it was
+ * unlinked in, and retired nodes are freed in batches of CollectThreshold
+ * once the epoch has advanced past them.
+ */
+template <class NodeType, std::size_t CollectThreshold = 64>
+class EpochNodeAllocator {
+public:
+
+  EpochNodeAllocator()
+    : domain(std::make_shared<EpochDomain>()) {
+    // empty constructor
+  }
+
+  /**
+   * Shares the domain with other allocators, so that one guard pins every
+   * tree they allocate for.
+   */
+  explicit EpochNodeAllocator(std::shared_ptr<EpochDomain> domain)
+    : domain(std::move(domain)) {
+    // empty constructor
+  }
+
+  EpochNodeAllocator(EpochNodeAllocator const&) = delete;
+  EpochNodeAllocator& operator=(EpochNodeAllocator const&) = delete;
+
+  EpochNodeAllocator(EpochNodeAllocator&& other)
+    : domain(std::move(other.domain)),
+      retired(std::move(other.retired)) {
+    other.retired.clear();
+  }
+
+  ~EpochNodeAllocator() {
+    release();
+  }
+
+  inline NodeType* allocate() {
+    return new NodeType();
+  }
+
+  void deallocate(NodeType* const node) {
+    // orders the unlinking of the node before the read of the epoch, which
+    // readers pin in the opposite order
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    retired.emplace_back(node, domain->getEpoch());
+    if (retired.size() >= CollectThreshold) {
+      collect();
+    }
+  }
+
+  /**
+   * Advances the epoch if possible, and frees the nodes retired at least two
+   * epochs ago.
+   */
+  void collect() {
+    domain->tryAdvance();
+    std::uint64_t const epoch = domain->getEpoch();
+    while (!retired.empty() && retired.front().second + 2 <= epoch) {
+      delete retired.front().first;
+      retired.pop_front();
+    }
+  }
+
+  /**
+   * Frees every retired node, which requires that no reader is pinned.
+   */
+  void release() {
+    for (std::pair<NodeType*, std::uint64_t> const& entry : retired) {
+      delete entry.first;
+    }
+    retired.clear();
+  }
+
+  inline EpochDomain& getDomain() const {
+    return *domain;
+  }
+
+  inline std::size_t getRetiredCount() const {
+    return retired.size();
+  }
+
+private:
+  std::shared_ptr<EpochDomain> domain;
+  std::deque<std::pair<NodeType*, std::uint64_t>> retired;
+};
+
+}
+
+#endif
@@ -0,0 +1,5 @@
+#include "optimistic_avl_node.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
@@ -0,0 +1,197 @@
+#ifndef __VST_OPTIMISTIC_AVL_NODE_H__
+#define __VST_OPTIMISTIC_AVL_NODE_H__
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace vst {
+
+/**
+ * Lock of a single node, which is held for a few stores at a time, so a
+ * waiting thread spins rather than sleeps.
+ */
+class SpinLock {
+public:
+
+  SpinLock() {
+    // empty constructor
+  }
+
+  SpinLock(SpinLock const&) = delete;
+  SpinLock& operator=(SpinLock const&) = delete;
+
+  void lock() {
+    while (locked.exchange(true, std::memory_order_acquire)) {
+      while (locked.load(std::memory_order_relaxed)) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  inline void unlock() {
+    locked.store(false, std::memory_order_release);
+  }
+
+private:
+  std::atomic<bool> locked{false};
+};
+
+/**
+ * Node of an OptimisticAvlTree, which any number of writers relink at once.
+ *
+ * Its links, parent, height and values are atomic. Readers take no locks:
+ * they validate what they read against the version of the node, which
+ * changes whenever a rotation moves the node down, so that keys may leave its
+ * subtree. The version is SHRINKING during such a rotation, and UNLINKED for
+ * good once the node has left the tree and the vine.
+ *
+ * Writers hold the tree lock of a node to change its children, height or
+ * values, and the vine lock of a node to change its greater neighbor, or the
+ * lesser neighbor of that neighbor.
+ *
+ * The values are never changed in place: a writer publishes a copy and
+ * retires the old one. A node without values is a routing node, which keeps
+ * the place of a removed key whose node still has two children.
+ *
+ * Following the tree, the height of a leaf is 1, so that a missing child has
+ * height 0.
+ */
+template <class KeyType, class ValueType,
+          class ValuesType = std::vector<ValueType>>
+class OptimisticAvlNode {
+public:
+  static constexpr std::uint64_t UNLINKED = 1;
+  static constexpr std::uint64_t SHRINKING = 2;
+  static constexpr std::uint64_t SHRINK_COUNT = 4;
+
+  OptimisticAvlNode() {
+    // empty constructor
+  }
+
+  explicit OptimisticAvlNode(KeyType const key)
+    : key(key) {
+    // empty constructor
+  }
+
+  ~OptimisticAvlNode() {
+    // empty destructor
+  }
+
+  inline KeyType getKey() const {
+    return key;
+  }
+
+  /**
+   * Returns the values, or null for a routing node.
+   */
+  inline ValuesType const* loadValues() const {
+    return values.load(std::memory_order_acquire);
+  }
+
+  inline OptimisticAvlNode* storeValues(ValuesType const* const values) {
+    this->values.store(values, std::memory_order_release);
+    return this;
+  }
+
+  inline OptimisticAvlNode* getChild(bool const greater) const {
+    return (greater) ? getGreaterChild() : getLesserChild();
+  }
+
+  inline OptimisticAvlNode* setChild(bool const greater, OptimisticAvlNode* const child) {
+    return (greater) ? setGreaterChild(child) : setLesserChild(child);
+  }
+
+  inline OptimisticAvlNode* setGreaterChild(OptimisticAvlNode* const greater_child) {
+    this->greater_child.store(greater_child, std::memory_order_release);
+    return this;
+  }
+
+  inline OptimisticAvlNode* getGreaterChild() const {
+    return greater_child.load(std::memory_order_acquire);
+  }
+
+  inline OptimisticAvlNode* setLesserChild(OptimisticAvlNode* const lesser_child) {
+    this->lesser_child.store(lesser_child, std::memory_order_release);
+    return this;
+  }
+
+  inline OptimisticAvlNode* getLesserChild() const {
+    return lesser_child.load(std::memory_order_acquire);
+  }
+
+  inline OptimisticAvlNode* setGreaterNeighbor(OptimisticAvlNode* const greater_neighbor) {
+    this->greater_neighbor.store(greater_neighbor, std::memory_order_release);
+    return this;
+  }
+
+  inline OptimisticAvlNode* getGreaterNeighbor() const {
+    return greater_neighbor.load(std::memory_order_acquire);
+  }
+
+  inline OptimisticAvlNode* setLesserNeighbor(OptimisticAvlNode* const lesser_neighbor) {
+    this->lesser_neighbor.store(lesser_neighbor, std::memory_order_release);
+    return this;
+  }
+
+  inline OptimisticAvlNode* getLesserNeighbor() const {
+    return lesser_neighbor.load(std::memory_order_acquire);
+  }
+
+  inline OptimisticAvlNode* setParent(OptimisticAvlNode* const parent) {
+    this->parent.store(parent, std::memory_order_release);
+    return this;
+  }
+
+  inline OptimisticAvlNode* getParent() const {
+    return parent.load(std::memory_order_acquire);
+  }
+
+  inline OptimisticAvlNode* setHeight(int const height) {
+    this->height.store(height, std::memory_order_relaxed);
+    return this;
+  }
+
+  inline int getHeight() const {
+    return height.load(std::memory_order_relaxed);
+  }
+
+  inline OptimisticAvlNode* setVersion(std::uint64_t const version) {
+    this->version.store(version, std::memory_order_release);
+    return this;
+  }
+
+  inline std::uint64_t getVersion() const {
+    return version.load(std::memory_order_acquire);
+  }
+
+  inline bool isUnlinked() const {
+    return getVersion() & UNLINKED;
+  }
+
+  inline SpinLock& getTreeLock() const {
+    return tree_lock;
+  }
+
+  inline SpinLock& getVineLock() const {
+    return vine_lock;
+  }
+
+private:
+  KeyType key = {};
+  std::atomic<ValuesType const*> values{nullptr};
+  std::atomic<OptimisticAvlNode*> greater_child{nullptr};
+  std::atomic<OptimisticAvlNode*> lesser_child{nullptr};
+  std::atomic<OptimisticAvlNode*> greater_neighbor{nullptr};
+  std::atomic<OptimisticAvlNode*> lesser_neighbor{nullptr};
+  std::atomic<OptimisticAvlNode*> parent{nullptr};
+  std::atomic<int> height{1};
+  std::atomic<std::uint64_t> version{0};
+  mutable SpinLock tree_lock;
+  mutable SpinLock vine_lock;
+};
+
+}
+
+#endif
@@ -0,0 +1,1043 @@
+#ifndef __VST_OPTIMISTIC_AVL_TREE_H__
+#define __VST_OPTIMISTIC_AVL_TREE_H__
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "compare.h"
+#include "distance.h"
+#include "epoch.h"
+#include "nearest_neighbor_iterator.h"
+#include "optimistic_avl_node.h"
+#include "range_iterator.h"
+
+namespace vst {
+
+/**
+ * Key and values of a node of an OptimisticAvlTree, which is what its queries
+ * return in place of a node. The values are those the node had when the entry
+ * was read, and stay valid as long as the guard of the read. Stepping to a
+ * neighbor skips routing nodes, and searches the tree again from the key of
+ * the entry should its node have left the vine since. An entry past either
+ * end converts to false.
+ */
+template <class TreeType, class NodeType, class ValuesType>
+class OptimisticEntry {
+public:
+
+  OptimisticEntry() {
+    // empty constructor
+  }
+
+  OptimisticEntry(TreeType const* const tree, NodeType* const node, ValuesType const* const values)
+    : tree(tree),
+      node(node),
+      values(values) {
+    // empty constructor
+  }
+
+  inline NodeType* getNode() const {
+    return node;
+  }
+
+  inline auto getKey() const {
+    return node->getKey();
+  }
+
+  inline auto getValue() const {
+    return *values->begin();
+  }
+
+  inline ValuesType const& getValues() const {
+    return *values;
+  }
+
+  inline OptimisticEntry getGreaterNeighbor() const {
+    return tree->getGreaterEntry(node);
+  }
+
+  inline OptimisticEntry getLesserNeighbor() const {
+    return tree->getLesserEntry(node);
+  }
+
+  inline explicit operator bool() const {
+    return node != nullptr;
+  }
+
+  inline bool operator==(OptimisticEntry const& other) const {
+    return node == other.node;
+  }
+
+  inline bool operator!=(OptimisticEntry const& other) const {
+    return !(*this == other);
+  }
+
+private:
+  TreeType const* tree = nullptr;
+  NodeType* node = nullptr;
+  ValuesType const* values = nullptr;
+};
+
+/**
+ * AvlTree for any number of writer and reader threads, after the relaxed
+ * balance tree of Bronson et al., "A Practical Concurrent Binary Search
+ * Tree", extended with the vine.
+ *
+ * Readers take no locks. A descent reads the version of each node before
+ * following a child link, and validates it once it holds the child; should a
+ * rotation have moved the node down in the meantime, it resumes from the last
+ * node whose version still holds, which may be the root. Writers descend the
+ * same way, and only then lock what they change: the parent of a new leaf,
+ * the node whose values they replace, the parent and the node they unlink,
+ * and the two or three nodes of a rotation along with their parent, always
+ * from the top down. Rebalancing walks up from the change, one rotation or
+ * height update at a time, so concurrent writers only meet where their paths
+ * meet.
+ *
+ * The vine is relinked under separate locks, taken after the tree locks and
+ * in the order of the keys: linking a node next to its lesser neighbor takes
+ * the lock of that neighbor, and unlinking one takes the lock of its lesser
+ * neighbor and then its own. Rotations leave the vine alone. Scans walk the
+ * vine with getGreaterNeighbor without locks, and whenever the node they
+ * stand on turns out to have left the vine, they search the tree again from
+ * its key rather than wait.
+ *
+ * The values of a key are replaced rather than changed in place. A key
+ * removed while its node has two children leaves a routing node behind,
+ * which the descents still pass through and the scans skip, and which the
+ * rebalancing unlinks once it has lost a child. Unlinked nodes and replaced
+ * values are retired to an EpochCollector, so a reader must pin the tree with
+ * pin() and only use what it reads while the guard lives. Writers pin the
+ * tree themselves.
+ */
+template <class KeyType, class ValueType,
+          class ValuesType = std::vector<ValueType>,
+          class Compare = ThreeWayCompare<KeyType>>
+class OptimisticAvlTree {
+public:
+  typedef OptimisticAvlNode<KeyType, ValueType, ValuesType> NodeType;
+  typedef OptimisticEntry<OptimisticAvlTree, NodeType, ValuesType> Entry;
+  friend Entry;
+
+  OptimisticAvlTree() {
+    // empty constructor
+  }
+
+  explicit OptimisticAvlTree(Compare compare)
+    : compare(std::move(compare)) {
+    // empty constructor
+  }
+
+  OptimisticAvlTree(OptimisticAvlTree const&) = delete;
+  OptimisticAvlTree& operator=(OptimisticAvlTree const&) = delete;
+
+  ~OptimisticAvlTree() {
+    NodeType* node = holder.getGreaterNeighbor();
+    while (node) {
+      NodeType* const greater_neighbor = node->getGreaterNeighbor();
+      delete node->loadValues();
+      delete node;
+      node = greater_neighbor;
+    }
+  }
+
+  // Writers --------------------------------------------------------------------
+
+  OptimisticAvlTree* insert(KeyType const key, ValueType const value) {
+    update(key, AddValue{value});
+    return this;
+  }
+
+  /**
+   * Replaces all the values of the key with the given one, returning whether
+   * the key is new.
+   */
+  bool upsert(KeyType const key, ValueType const value) {
+    return !update(key, SetValue{value}).existed;
+  }
+
+  bool remove(KeyType const key) {
+    return update(key, RemoveKey{}).changed;
+  }
+
+  bool remove(KeyType const key, ValueType const value) {
+    return update(key, RemoveValue{value}).changed;
+  }
+
+  /**
+   * Checks the tree, the vine and the size, which requires that no writer is
+   * running.
+   */
+  bool checkInvariants() const {
+    NodeType* const root = holder.getGreaterChild();
+    if (holder.getLesserChild() || (root && root->getParent() != &holder)) return false;
+    NodeType* neighbor = holder.getGreaterNeighbor();
+    if (neighbor && neighbor->getLesserNeighbor()) return false;
+    if (!root && holder.getLesserNeighbor()) return false;
+    std::size_t values = 0;
+    return checkSubtree(root, neighbor, values) >= 0
+      && !neighbor
+      && values == getSize();
+  }
+
+  inline std::size_t getRetiredCount() {
+    return collector.getRetiredCount();
+  }
+
+  // Readers --------------------------------------------------------------------
+
+  /**
+   * Pins the tree for the calling reader until the guard goes out of scope.
+   */
+  inline EpochGuard pin() const {
+    return EpochGuard(domain);
+  }
+
+  inline std::size_t getSize() const {
+    return size.load(std::memory_order_relaxed);
+  }
+
+  Entry getLeast() const {
+    while (true) {
+      bool restart = false;
+      Entry const entry = walkGreater(nullptr, nullptr, false, restart);
+      if (!restart) return entry;
+    }
+  }
+
+  Entry getGreatest() const {
+    while (true) {
+      bool restart = false;
+      Entry const entry = walkLesser(nullptr, nullptr, false, restart);
+      if (!restart) return entry;
+    }
+  }
+
+  inline bool containsKey(KeyType const key) const {
+    return static_cast<bool>(find(key));
+  }
+
+  Entry find(KeyType const key) const {
+    NodeType* const node = locate(key);
+    if (!node || compare(node->getKey(), key) != 0) return Entry();
+    ValuesType const* const values = node->loadValues();
+    return (values) ? Entry(this, node, values) : Entry();
+  }
+
+  inline Entry findNearestGTE(KeyType const key) const {
+    return seekGreater(key, false);
+  }
+
+  inline Entry findNearestLTE(KeyType const key) const {
+    return seekLesser(key, false);
+  }
+
+  /**
+   * Scans the vine from the lower key, which must be done under the same
+   * guard as the call.
+   */
+  auto getRange(KeyType const lower_key, KeyType const upper_key) const {
+    auto iter = new RangeIterator<Entry, KeyType, Compare>();
+    if (Entry const entry = findNearestGTE(lower_key)) {
+      iter->setCursor(entry)->setCompare(compare)->setUpperKey(upper_key);
+    }
+    return iter;
+  }
+
+  template <class Distance = AbsoluteDifference<KeyType>>
+  auto getNearestNeighbors(
+      KeyType const key,
+      unsigned int const k_neighbors,
+      Distance const& distance = Distance()) const {
+
+    auto iter = new NearestNeighborIterator<Entry, KeyType, Distance>();
+
+    Entry entry = findNearestGTE(key);
+    if (!entry) entry = getGreatest();
+    if (entry) {
+      iter->setKey(key)->setDistance(distance)->setLimit(k_neighbors)->setCursor(entry);
+    }
+
+    return iter;
+  }
+
+private:
+  static constexpr std::uint64_t CHANGING = NodeType::SHRINKING | NodeType::UNLINKED;
+
+  /** Results of nodeCondition other than a new height */
+  static constexpr int UNLINK_REQUIRED = -1;
+  static constexpr int REBALANCE_REQUIRED = -2;
+  static constexpr int NOTHING_REQUIRED = -3;
+
+  /**
+   * What a write does to the values of its key, given the current ones or
+   * null: whether it changes them, and the values that replace them, or null
+   * to remove the key.
+   */
+  struct Change {
+    bool changed;
+    ValuesType const* values;
+  };
+
+  /**
+   * Each write below says whether it may create the key, and whether it
+   * would remove the key from the given values, as unlinking a node takes
+   * the lock of its parent first.
+   */
+  struct AddValue {
+    static constexpr bool CREATES = true;
+    ValueType value;
+
+    inline bool mayRemove(ValuesType const*) const {
+      return false;
+    }
+
+    Change apply(ValuesType const* const values) const {
+      ValuesType* const result = (values) ? new ValuesType(*values) : new ValuesType();
+      result->push_back(value);
+      return {true, result};
+    }
+  };
+
+  struct SetValue {
+    static constexpr bool CREATES = true;
+    ValueType value;
+
+    inline bool mayRemove(ValuesType const*) const {
+      return false;
+    }
+
+    Change apply(ValuesType const*) const {
+      ValuesType* const result = new ValuesType();
+      result->push_back(value);
+      return {true, result};
+    }
+  };
+
+  struct RemoveKey {
+    static constexpr bool CREATES = false;
+
+    inline bool mayRemove(ValuesType const* const values) const {
+      return values != nullptr;
+    }
+
+    inline Change apply(ValuesType const* const values) const {
+      return {values != nullptr, nullptr};
+    }
+  };
+
+  struct RemoveValue {
+    static constexpr bool CREATES = false;
+    ValueType value;
+
+    inline bool mayRemove(ValuesType const* const values) const {
+      return values && values->size() == 1 && *values->begin() == value;
+    }
+
+    Change apply(ValuesType const* const values) const {
+      if (!values) return {false, nullptr};
+      if (mayRemove(values)) return {true, nullptr};
+      ValuesType* const result = new ValuesType(*values);
+      for (auto iter = result->begin(); iter != result->end(); ++iter) {
+        if (*iter == value) {
+          result->erase(iter);
+          return {true, result};
+        }
+      }
+      delete result;
+      return {false, nullptr};
+    }
+  };
+
+  struct Outcome {
+    bool changed;
+    bool existed;
+  };
+
+  Compare compare = {};
+  mutable EpochDomain domain;
+  EpochCollector<> collector{domain};
+  std::atomic<std::size_t> size{0};
+
+  /**
+   * Sentinel whose greater child is the root. In the vine, it stands for the
+   * start when it is the lesser neighbor of a change, and its greater and
+   * lesser neighbors are the least and greatest nodes.
+   */
+  NodeType holder;
+
+  static inline int height(NodeType const* const node) {
+    return (node) ? node->getHeight() : 0;
+  }
+
+  static inline std::size_t countValues(ValuesType const* const values) {
+    return (values) ? values->size() : 0;
+  }
+
+  /**
+   * Gives way to the writer rotating the node down, or unlinking it, after
+   * which the caller reads the link to it again.
+   */
+  static void waitUntilNotChanging(NodeType const* const node) {
+    do {
+      std::this_thread::yield();
+    } while (node->getVersion() & NodeType::SHRINKING);
+  }
+
+  inline bool isAbove(KeyType const& key, KeyType const& bound, bool const strict) const {
+    int const comparison = compare(key, bound);
+    return (strict) ? comparison > 0 : comparison >= 0;
+  }
+
+  inline bool isBelow(KeyType const& key, KeyType const& bound, bool const strict) const {
+    int const comparison = compare(key, bound);
+    return (strict) ? comparison < 0 : comparison <= 0;
+  }
+
+  // Descents -------------------------------------------------------------------
+
+  /**
+   * Returns the node of the key, or else the node the descent toward it ended
+   * at, which neighbors it in the vine, or null when the tree is empty.
+   */
+  NodeType* locate(KeyType const& key) const {
+    while (true) {
+      NodeType* const root = holder.getGreaterChild();
+      if (!root) return nullptr;
+      std::uint64_t const version = root->getVersion();
+      if (version & CHANGING) {
+        waitUntilNotChanging(root);
+      }
+      else if (root == holder.getGreaterChild()) {
+        if (NodeType* const node = attemptLocate(key, root, version)) return node;
+      }
+    }
+  }
+
+  /**
+   * Continues the descent of locate below the node, as long as the node
+   * still has the version it was reached with, returning null otherwise.
+   */
+  NodeType* attemptLocate(KeyType const& key, NodeType* const node,
+                          std::uint64_t const version) const {
+    int const comparison = compare(key, node->getKey());
+    if (comparison == 0) return node;
+    bool const greater = comparison > 0;
+    while (true) {
+      NodeType* const child = node->getChild(greater);
+      if (node->getVersion() != version) return nullptr;
+      if (!child) return node;
+      std::uint64_t const child_version = child->getVersion();
+      if (child_version & CHANGING) {
+        waitUntilNotChanging(child);
+      }
+      else if (child == node->getChild(greater)) {
+        if (node->getVersion() != version) return nullptr;
+        if (NodeType* const found = attemptLocate(key, child, child_version)) return found;
+      }
+    }
+  }
+
+  template <class Write>
+  Outcome update(KeyType const& key, Write const& write) {
+    EpochGuard const guard(domain);
+    while (true) {
+      Outcome outcome = {false, false};
+      NodeType* const root = holder.getGreaterChild();
+      if (!root) {
+        if (!Write::CREATES) return outcome;
+        if (attemptInsertIntoEmpty(key, write)) return {true, false};
+      }
+      else {
+        std::uint64_t const version = root->getVersion();
+        if (version & CHANGING) {
+          waitUntilNotChanging(root);
+        }
+        else if (root == holder.getGreaterChild()
+                 && attemptUpdate(key, write, &holder, root, version, outcome)) {
+          return outcome;
+        }
+      }
+    }
+  }
+
+  template <class Write>
+  bool attemptInsertIntoEmpty(KeyType const& key, Write const& write) {
+    std::lock_guard<SpinLock> const lock(holder.getTreeLock());
+    if (holder.getGreaterChild()) return false;
+    NodeType* const node = buildNode(key, write, &holder);
+    linkNeighbors(&holder, true, node);
+    holder.setGreaterChild(node);
+    return true;
+  }
+
+  /**
+   * Continues the descent of update below the node, which was reached from
+   * the parent with the given version, returning false when it must resume
+   * from the parent.
+   */
+  template <class Write>
+  bool attemptUpdate(KeyType const& key, Write const& write,
+                     NodeType* const parent, NodeType* const node,
+                     std::uint64_t const version, Outcome& outcome) {
+    int const comparison = compare(key, node->getKey());
+    if (comparison == 0) return attemptNodeUpdate(write, parent, node, outcome);
+    bool const greater = comparison > 0;
+    while (true) {
+      NodeType* const child = node->getChild(greater);
+      if (node->getVersion() != version) return false;
+      if (!child) {
+        if (!Write::CREATES) return true;
+        NodeType* damaged = nullptr;
+        {
+          std::lock_guard<SpinLock> const lock(node->getTreeLock());
+          if (node->getVersion() != version) return false;
+          if (node->getChild(greater)) continue;
+          NodeType* const leaf = buildNode(key, write, node);
+          linkNeighbors(node, greater, leaf);
+          node->setChild(greater, leaf);
+          damaged = fixHeight(node);
+        }
+        fixHeightAndRebalance(damaged);
+        outcome.changed = true;
+        return true;
+      }
+      std::uint64_t const child_version = child->getVersion();
+      if (child_version & CHANGING) {
+        waitUntilNotChanging(child);
+      }
+      else if (child == node->getChild(greater)) {
+        if (node->getVersion() != version) return false;
+        if (attemptUpdate(key, write, node, child, child_version, outcome)) return true;
+      }
+    }
+  }
+
+  /**
+   * Applies the write to the node of its key. A removal that may unlink the
+   * node locks the parent first; any other write only locks the node.
+   */
+  template <class Write>
+  bool attemptNodeUpdate(Write const& write, NodeType* const parent,
+                         NodeType* const node, Outcome& outcome) {
+    if (write.mayRemove(node->loadValues())
+        && (!node->getLesserChild() || !node->getGreaterChild())) {
+      NodeType* damaged = nullptr;
+      {
+        std::lock_guard<SpinLock> const parent_lock(parent->getTreeLock());
+        if (parent->isUnlinked() || node->getParent() != parent) return false;
+        std::lock_guard<SpinLock> const lock(node->getTreeLock());
+        if (node->isUnlinked()) return false;
+        ValuesType const* const values = node->loadValues();
+        Change const change = write.apply(values);
+        outcome = {change.changed, values != nullptr};
+        if (!change.changed) return true;
+        if (change.values) {
+          replaceValues(node, values, change.values);
+          return true;
+        }
+        if (!attemptUnlink(parent, node)) return false;
+        replaceValues(node, values, nullptr);
+        damaged = fixHeight(parent);
+      }
+      fixHeightAndRebalance(damaged);
+      return true;
+    }
+
+    std::lock_guard<SpinLock> const lock(node->getTreeLock());
+    if (node->isUnlinked()) return false;
+    ValuesType const* const values = node->loadValues();
+    // the node may have lost a child since, and must then be unlinked
+    if (write.mayRemove(values) && (!node->getLesserChild() || !node->getGreaterChild())) {
+      return false;
+    }
+    Change const change = write.apply(values);
+    outcome = {change.changed, values != nullptr};
+    if (change.changed) {
+      // a removed key whose node has two children leaves a routing node
+      replaceValues(node, values, change.values);
+    }
+    return true;
+  }
+
+  template <class Write>
+  NodeType* buildNode(KeyType const& key, Write const& write, NodeType* const parent) {
+    ValuesType const* const values = write.apply(nullptr).values;
+    NodeType* const node = new NodeType(key);
+    node->storeValues(values)->setParent(parent);
+    size.fetch_add(values->size(), std::memory_order_relaxed);
+    return node;
+  }
+
+  /**
+   * Publishes the values of the node, which the caller holds the tree lock
+   * of, and retires the ones they replace.
+   */
+  void replaceValues(NodeType* const node, ValuesType const* const values,
+                     ValuesType const* const replacement) {
+    node->storeValues(replacement);
+    size.fetch_add(countValues(replacement) - countValues(values), std::memory_order_relaxed);
+    if (values) collector.retire(values);
+  }
+
+  // Vine -----------------------------------------------------------------------
+
+  inline NodeType* getVineLesserNeighbor(NodeType* const node) {
+    NodeType* const lesser_neighbor = node->getLesserNeighbor();
+    return (lesser_neighbor) ? lesser_neighbor : &holder;
+  }
+
+  /**
+   * Links the new node into the vine as the given child of the parent, which
+   * the caller holds the tree lock of, so that the parent neither leaves the
+   * vine nor gains another child there in the meantime.
+   */
+  void linkNeighbors(NodeType* const parent, bool const greater, NodeType* const node) {
+    while (true) {
+      NodeType* const lesser_neighbor = (greater) ? parent : getVineLesserNeighbor(parent);
+      std::lock_guard<SpinLock> const lock(lesser_neighbor->getVineLock());
+      NodeType* const greater_neighbor = lesser_neighbor->getGreaterNeighbor();
+      // the lesser neighbor of the parent may have just been unlinked
+      if (lesser_neighbor->isUnlinked() || (!greater && greater_neighbor != parent)) continue;
+      node->setLesserNeighbor((lesser_neighbor != &holder) ? lesser_neighbor : nullptr);
+      node->setGreaterNeighbor(greater_neighbor);
+      lesser_neighbor->setGreaterNeighbor(node);
+      ((greater_neighbor) ? greater_neighbor : &holder)->setLesserNeighbor(node);
+      return;
+    }
+  }
+
+  /**
+   * Takes the node out of the vine and marks it UNLINKED, under the locks of
+   * its lesser neighbor and itself. The node keeps its own links, so that a
+   * reader standing on it may still step off.
+   */
+  void unlinkNeighbors(NodeType* const node) {
+    while (true) {
+      NodeType* const lesser_neighbor = getVineLesserNeighbor(node);
+      std::lock_guard<SpinLock> const lesser_lock(lesser_neighbor->getVineLock());
+      if (lesser_neighbor->isUnlinked() || lesser_neighbor->getGreaterNeighbor() != node) continue;
+      std::lock_guard<SpinLock> const lock(node->getVineLock());
+      NodeType* const greater_neighbor = node->getGreaterNeighbor();
+      lesser_neighbor->setGreaterNeighbor(greater_neighbor);
+      ((greater_neighbor) ? greater_neighbor : &holder)->setLesserNeighbor(
+        (lesser_neighbor != &holder) ? lesser_neighbor : nullptr);
+      node->setVersion(NodeType::UNLINKED);
+      return;
+    }
+  }
+
+  // Rebalancing ----------------------------------------------------------------
+
+  /**
+   * Splices out the node, which has at most one child, under the tree locks
+   * of the parent and the node, and retires it. Returns false if the node no
+   * longer qualifies.
+   */
+  bool attemptUnlink(NodeType* const parent, NodeType* const node) {
+    NodeType* const parent_lesser_child = parent->getLesserChild();
+    if (parent_lesser_child != node && parent->getGreaterChild() != node) return false;
+    NodeType* const lesser_child = node->getLesserChild();
+    NodeType* const greater_child = node->getGreaterChild();
+    if (lesser_child && greater_child) return false;
+    unlinkNeighbors(node);
+    NodeType* const splice = (lesser_child) ? lesser_child : greater_child;
+    parent->setChild(parent_lesser_child != node, splice);
+    if (splice) splice->setParent(parent);
+    collector.retire(node);
+    return true;
+  }
+
+  /**
+   * Returns the new height of the node, or what else it requires, from the
+   * heights of its children as they are read.
+   */
+  int nodeCondition(NodeType const* const node) const {
+    NodeType const* const lesser_child = node->getLesserChild();
+    NodeType const* const greater_child = node->getGreaterChild();
+    if ((!lesser_child || !greater_child) && !node->loadValues()) return UNLINK_REQUIRED;
+    int const lesser_height = height(lesser_child);
+    int const greater_height = height(greater_child);
+    int const balance = lesser_height - greater_height;
+    if (balance < -1 || balance > 1) return REBALANCE_REQUIRED;
+    int const replacement = 1 + std::max(lesser_height, greater_height);
+    return (replacement != node->getHeight()) ? replacement : NOTHING_REQUIRED;
+  }
+
+  /**
+   * Updates the height of the node, which the caller holds the tree lock of,
+   * and returns the next node to repair: the parent after a new height, the
+   * node itself if it must be rotated or unlinked, or null.
+   */
+  NodeType* fixHeight(NodeType* const node) {
+    if (node == &holder) return nullptr;
+    int const condition = nodeCondition(node);
+    switch (condition) {
+      case UNLINK_REQUIRED:
+      case REBALANCE_REQUIRED:
+        return node;
+      case NOTHING_REQUIRED:
+        return nullptr;
+      default:
+        node->setHeight(condition);
+        return node->getParent();
+    }
+  }
+
+  /**
+   * Repairs the damage a change left at the node, walking up for as long as
+   * heights change. A rotation may damage more than one node, and the ones
+   * it does not return are repaired after.
+   */
+  void fixHeightAndRebalance(NodeType* node) {
+    std::vector<NodeType*> pending;
+    while (node || !pending.empty()) {
+      if (!node) {
+        node = pending.back();
+        pending.pop_back();
+      }
+      if (node == &holder || node->isUnlinked()) {
+        node = nullptr;
+        continue;
+      }
+      int const condition = nodeCondition(node);
+      if (condition == NOTHING_REQUIRED) {
+        node = nullptr;
+      }
+      else if (condition != UNLINK_REQUIRED && condition != REBALANCE_REQUIRED) {
+        std::lock_guard<SpinLock> const lock(node->getTreeLock());
+        node = fixHeight(node);
+      }
+      else {
+        NodeType* const parent = node->getParent();
+        std::lock_guard<SpinLock> const parent_lock(parent->getTreeLock());
+        if (!parent->isUnlinked() && node->getParent() == parent) {
+          std::lock_guard<SpinLock> const lock(node->getTreeLock());
+          node = rebalance(parent, node, pending);
+        }
+      }
+    }
+  }
+
+  /**
+   * Unlinks, rotates or updates the height of the node, under the tree locks
+   * of the parent and the node, and returns the next node to repair.
+   */
+  NodeType* rebalance(NodeType* const parent, NodeType* const node,
+                      std::vector<NodeType*>& pending) {
+    NodeType* const lesser_child = node->getLesserChild();
+    NodeType* const greater_child = node->getGreaterChild();
+    if ((!lesser_child || !greater_child) && !node->loadValues()) {
+      return (attemptUnlink(parent, node)) ? fixHeight(parent) : node;
+    }
+    int const lesser_height = height(lesser_child);
+    int const greater_height = height(greater_child);
+    int const balance = lesser_height - greater_height;
+    if (balance > 1) return rebalanceFrom(parent, node, false, lesser_child, greater_height, pending);
+    if (balance < -1) return rebalanceFrom(parent, node, true, greater_child, lesser_height, pending);
+    int const replacement = 1 + std::max(lesser_height, greater_height);
+    if (replacement != node->getHeight()) {
+      node->setHeight(replacement);
+      return fixHeight(parent);
+    }
+    return nullptr;
+  }
+
+  /**
+   * Rotates the child on the given side of the node, which is too high by
+   * more than one, up in place of the node, locking the child and, for a
+   * double rotation, its inner child.
+   */
+  NodeType* rebalanceFrom(NodeType* const parent, NodeType* const node, bool const greater,
+                          NodeType* const child, int const other_height,
+                          std::vector<NodeType*>& pending) {
+    std::lock_guard<SpinLock> const lock(child->getTreeLock());
+    if (child->getHeight() - other_height <= 1) return node;
+    NodeType* const inner = child->getChild(!greater);
+    int const outer_height = height(child->getChild(greater));
+    int const unlocked_inner_height = height(inner);
+    if (outer_height >= unlocked_inner_height) {
+      return rotate(parent, node, greater, child, other_height,
+                    outer_height, inner, unlocked_inner_height, pending);
+    }
+    {
+      std::lock_guard<SpinLock> const inner_lock(inner->getTreeLock());
+      int const inner_height = inner->getHeight();
+      if (outer_height >= inner_height) {
+        return rotate(parent, node, greater, child, other_height,
+                      outer_height, inner, inner_height, pending);
+      }
+      NodeType* const inner_near = inner->getChild(greater);
+      int const inner_near_height = height(inner_near);
+      int const balance = outer_height - inner_near_height;
+      if (balance >= -1 && balance <= 1) {
+        return rotateTwice(parent, node, greater, child, other_height,
+                           outer_height, inner, inner_near_height, pending);
+      }
+      if (inner_height - outer_height <= 1) {
+        // a double rotation would leave the child unbalanced, so rotate the
+        // inner child up on its own, and come back to the node
+        pending.push_back(node);
+        return rotate(node, child, !greater, inner, outer_height,
+                      height(inner->getChild(!greater)), inner_near, inner_near_height, pending);
+      }
+    }
+    // the child is unbalanced itself, so rebalance it first
+    pending.push_back(node);
+    return rebalanceFrom(node, child, !greater, inner, outer_height, pending);
+  }
+
+  /**
+   * Rotates the child on the given side of the node up in place of the node,
+   * which becomes SHRINKING in the meantime.
+   */
+  NodeType* rotate(NodeType* const parent, NodeType* const node, bool const greater,
+                   NodeType* const child, int const other_height, int const outer_height,
+                   NodeType* const inner, int const inner_height,
+                   std::vector<NodeType*>& pending) {
+    std::uint64_t const version = node->getVersion();
+    NodeType* const parent_lesser_child = parent->getLesserChild();
+
+    node->setVersion(version | NodeType::SHRINKING);
+    node->setChild(greater, inner);
+    if (inner) inner->setParent(node);
+    child->setChild(!greater, node);
+    node->setParent(child);
+    parent->setChild(parent_lesser_child != node, child);
+    child->setParent(parent);
+
+    int const node_height = 1 + std::max(inner_height, other_height);
+    node->setHeight(node_height);
+    child->setHeight(1 + std::max(outer_height, node_height));
+    node->setVersion(version + NodeType::SHRINK_COUNT);
+
+    int const node_balance = inner_height - other_height;
+    int const child_balance = outer_height - node_height;
+    bool const child_damaged = child_balance < -1 || child_balance > 1
+      || (outer_height == 0 && !child->loadValues());
+    bool const node_damaged = node_balance < -1 || node_balance > 1
+      || ((!inner || other_height == 0) && !node->loadValues());
+    if (!child_damaged && !node_damaged) return fixHeight(parent);
+    pending.push_back(parent);
+    if (child_damaged) pending.push_back(child);
+    if (node_damaged) pending.push_back(node);
+    return takeLast(pending);
+  }
+
+  /**
+   * Rotates the inner child of the child on the given side of the node up in
+   * place of the node, which becomes SHRINKING in the meantime, as does the
+   * child.
+   */
+  NodeType* rotateTwice(NodeType* const parent, NodeType* const node, bool const greater,
+                        NodeType* const child, int const other_height, int const outer_height,
+                        NodeType* const inner, int const inner_near_height,
+                        std::vector<NodeType*>& pending) {
+    std::uint64_t const version = node->getVersion();
+    std::uint64_t const child_version = child->getVersion();
+    NodeType* const parent_lesser_child = parent->getLesserChild();
+    NodeType* const inner_near = inner->getChild(greater);
+    NodeType* const inner_far = inner->getChild(!greater);
+    int const inner_far_height = height(inner_far);
+
+    node->setVersion(version | NodeType::SHRINKING);
+    child->setVersion(child_version | NodeType::SHRINKING);
+    node->setChild(greater, inner_far);
+    if (inner_far) inner_far->setParent(node);
+    child->setChild(!greater, inner_near);
+    if (inner_near) inner_near->setParent(child);
+    inner->setChild(greater, child);
+    child->setParent(inner);
+    inner->setChild(!greater, node);
+    node->setParent(inner);
+    parent->setChild(parent_lesser_child != node, inner);
+    inner->setParent(parent);
+
+    int const node_height = 1 + std::max(inner_far_height, other_height);
+    node->setHeight(node_height);
+    int const child_height = 1 + std::max(outer_height, inner_near_height);
+    child->setHeight(child_height);
+    inner->setHeight(1 + std::max(child_height, node_height));
+    node->setVersion(version + NodeType::SHRINK_COUNT);
+    child->setVersion(child_version + NodeType::SHRINK_COUNT);
+
+    int const node_balance = inner_far_height - other_height;
+    int const child_balance = outer_height - inner_near_height;
+    int const inner_balance = child_height - node_height;
+    bool const inner_damaged = inner_balance < -1 || inner_balance > 1;
+    bool const child_damaged = child_balance < -1 || child_balance > 1
+      || ((!inner_near || outer_height == 0) && !child->loadValues());
+    bool const node_damaged = node_balance < -1 || node_balance > 1
+      || ((!inner_far || other_height == 0) && !node->loadValues());
+    if (!inner_damaged && !child_damaged && !node_damaged) return fixHeight(parent);
+    pending.push_back(parent);
+    if (inner_damaged) pending.push_back(inner);
+    if (child_damaged) pending.push_back(child);
+    if (node_damaged) pending.push_back(node);
+    return takeLast(pending);
+  }
+
+  /**
+   * Returns the lowest of the nodes a rotation damaged, which is repaired
+   * first, leaving the others and the parent of the rotation pending.
+   */
+  static inline NodeType* takeLast(std::vector<NodeType*>& pending) {
+    NodeType* const node = pending.back();
+    pending.pop_back();
+    return node;
+  }
+
+  // Scans ----------------------------------------------------------------------
+
+  /**
+   * Walks the vine up from the node, or from its start when null, to the
+   * first node with values whose key is above the bound, if any. Sets
+   * restart instead if it stood on a node that has left the vine.
+   */
+  Entry walkGreater(NodeType* node, KeyType const* const bound, bool const strict,
+                    bool& restart) const {
+    while (true) {
+      NodeType* const greater_neighbor = (node)
+        ? node->getGreaterNeighbor()
+        : holder.getGreaterNeighbor();
+      if (node && node->isUnlinked()) {
+        restart = true;
+        return Entry();
+      }
+      if (!greater_neighbor) return Entry();
+      if (!bound || isAbove(greater_neighbor->getKey(), *bound, strict)) {
+        if (ValuesType const* const values = greater_neighbor->loadValues()) {
+          return Entry(this, greater_neighbor, values);
+        }
+      }
+      node = greater_neighbor;
+    }
+  }
+
+  /**
+   * Walks the vine down from the node, or from its end when null, to the
+   * first node with values whose key is below the bound, if any. Sets
+   * restart instead if it stood on a node that has left the vine.
+   */
+  Entry walkLesser(NodeType* node, KeyType const* const bound, bool const strict,
+                   bool& restart) const {
+    while (true) {
+      NodeType* const lesser_neighbor = (node)
+        ? node->getLesserNeighbor()
+        : holder.getLesserNeighbor();
+      if (node && node->isUnlinked()) {
+        restart = true;
+        return Entry();
+      }
+      if (!lesser_neighbor) return Entry();
+      if (!bound || isBelow(lesser_neighbor->getKey(), *bound, strict)) {
+        if (ValuesType const* const values = lesser_neighbor->loadValues()) {
+          return Entry(this, lesser_neighbor, values);
+        }
+      }
+      node = lesser_neighbor;
+    }
+  }
+
+  /**
+   * Returns the first entry whose key is greater than the bound when strict,
+   * or no less otherwise, searching again whenever the vine changes under it.
+   */
+  Entry seekGreater(KeyType const& bound, bool const strict) const {
+    while (true) {
+      bool restart = false;
+      NodeType* node = locate(bound);
+      while (node && isAbove(node->getKey(), bound, strict) && !restart) {
+        NodeType* const lesser_neighbor = node->getLesserNeighbor();
+        restart = node->isUnlinked();
+        node = lesser_neighbor;
+      }
+      if (restart) continue;
+      Entry const entry = walkGreater(node, &bound, strict, restart);
+      if (!restart) return entry;
+    }
+  }
+
+  /**
+   * Returns the last entry whose key is less than the bound when strict, or
+   * no greater otherwise, searching again whenever the vine changes under it.
+   */
+  Entry seekLesser(KeyType const& bound, bool const strict) const {
+    while (true) {
+      bool restart = false;
+      NodeType* node = locate(bound);
+      while (node && isBelow(node->getKey(), bound, strict) && !restart) {
+        NodeType* const greater_neighbor = node->getGreaterNeighbor();
+        restart = node->isUnlinked();
+        node = greater_neighbor;
+      }
+      if (restart) continue;
+      Entry const entry = walkLesser(node, &bound, strict, restart);
+      if (!restart) return entry;
+    }
+  }
+
+  Entry getGreaterEntry(NodeType* const node) const {
+    bool restart = false;
+    Entry const entry = walkGreater(node, nullptr, false, restart);
+    return (restart) ? seekGreater(node->getKey(), true) : entry;
+  }
+
+  Entry getLesserEntry(NodeType* const node) const {
+    bool restart = false;
+    Entry const entry = walkLesser(node, nullptr, false, restart);
+    return (restart) ? seekLesser(node->getKey(), true) : entry;
+  }
+
+  /**
+   * Checks the subtree of the node and that the vine lists it in order from
+   * the given neighbor on, which it moves past the subtree, and returns its
+   * height, or -1 if anything is amiss.
+   */
+  int checkSubtree(NodeType const* const node, NodeType*& neighbor, std::size_t& values) const {
+    if (!node) return 0;
+    if (node->getVersion() & CHANGING) return -1;
+    NodeType const* const lesser_child = node->getLesserChild();
+    NodeType const* const greater_child = node->getGreaterChild();
+    if (lesser_child && lesser_child->getParent() != node) return -1;
+    if (greater_child && greater_child->getParent() != node) return -1;
+
+    int const lesser_height = checkSubtree(lesser_child, neighbor, values);
+    if (lesser_height < 0 || neighbor != node) return -1;
+    NodeType* const greater_neighbor = node->getGreaterNeighbor();
+    if (greater_neighbor) {
+      if (greater_neighbor->getLesserNeighbor() != node) return -1;
+      if (compare(node->getKey(), greater_neighbor->getKey()) >= 0) return -1;
+    }
+    else if (holder.getLesserNeighbor() != node) {
+      return -1;
+    }
+    neighbor = greater_neighbor;
+
+    if (ValuesType const* const node_values = node->loadValues()) {
+      if (node_values->size() == 0) return -1;
+      values += node_values->size();
+    }
+    else if (!lesser_child || !greater_child) {
+      // routing nodes are unlinked once they lose a child
+      return -1;
+    }
+
+    int const greater_height = checkSubtree(greater_child, neighbor, values);
+    if (greater_height < 0) return -1;
+    int const balance = lesser_height - greater_height;
+    if (balance < -1 || balance > 1) return -1;
+    int const node_height = 1 + std::max(lesser_height, greater_height);
+    return (node->getHeight() == node_height) ? node_height : -1;
+  }
+};
+
+}
+
+#endif
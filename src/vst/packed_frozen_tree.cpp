@@ -0,0 +1,5 @@
+#include "packed_frozen_tree.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
@@ -0,0 +1,366 @@
+#ifndef __VST_PACKED_FROZEN_TREE_H__
+#define __VST_PACKED_FROZEN_TREE_H__
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "compare.h"
+#include "frozen_tree.h"
+#include "key_search.h"
+#include "range_iterator.h"
+
+namespace vst {
+
+/**
+ * Position of a key within a PackedFrozenTree, along with the key, which is
+ * decoded once. Stepping to the greater neighbor adds the next delta, so a
+ * scan along the vine decodes each key once.
+ */
+template <class TreeType>
+class PackedEntry {
+public:
+  typedef typename TreeType::KeyType KeyType;
+
+  PackedEntry() {
+    // empty constructor
+  }
+
+  PackedEntry(TreeType const* const tree, std::size_t const position, KeyType const key)
+    : tree(tree),
+      position(position),
+      key(key) {
+    // empty constructor
+  }
+
+  inline std::size_t getPosition() const {
+    return position;
+  }
+
+  inline KeyType getKey() const {
+    return key;
+  }
+
+  inline auto getValue() const {
+    return *tree->getValues(position).begin();
+  }
+
+  inline auto getValues() const {
+    return tree->getValues(position);
+  }
+
+  inline PackedEntry getGreaterNeighbor() const {
+    return tree->getGreaterNeighbor(*this);
+  }
+
+  inline PackedEntry getLesserNeighbor() const {
+    return tree->getLesserNeighbor(*this);
+  }
+
+  inline explicit operator bool() const {
+    return tree != nullptr;
+  }
+
+  inline bool operator==(PackedEntry const& other) const {
+    return tree == other.tree && (!tree || position == other.position);
+  }
+
+  inline bool operator!=(PackedEntry const& other) const {
+    return !(*this == other);
+  }
+
+private:
+  TreeType const* tree = nullptr;
+  std::size_t position = 0;
+  KeyType key = {};
+};
+
+/**
+ * Read-only snapshot of a Tree with integer keys, like FrozenTree, whose keys
+ * are compressed for trees whose consecutive keys are close, e.g. timestamps.
+ *
+ * The sorted keys are cut into blocks of BlockSize. The first key of each
+ * block is kept uncompressed in a sample index, and the others are stored as
+ * their differences to the key before them, bit-packed at the width of the
+ * greatest difference in the block. A lookup searches the samples, then
+ * decodes the one block the key falls in, up to the key. Values are kept in a
+ * parallel array as in FrozenTree, without offsets when each key has a single
+ * value.
+ *
+ * The keys must be in their natural order, i.e. that of ThreeWayCompare.
+ */
+template <class Key, class ValueType, std::uint32_t BlockSize = 64>
+class PackedFrozenTree {
+public:
+  typedef Key KeyType;
+  typedef PackedEntry<PackedFrozenTree> Entry;
+  typedef typename FrozenTree<KeyType, ValueType>::Values Values;
+
+  static_assert(std::is_integral_v<KeyType> && sizeof(KeyType) <= 8,
+    "PackedFrozenTree requires integer keys of up to 64 bits");
+  static_assert(BlockSize >= 2, "BlockSize must be at least 2");
+
+  PackedFrozenTree() {
+    // empty constructor
+  }
+
+  /**
+   * Copies the keys and values along the vine that starts at the least node,
+   * whose keys must strictly increase.
+   */
+  template <class NodeType>
+  explicit PackedFrozenTree(NodeType const* node) {
+    std::vector<KeyType> block;
+    block.reserve(BlockSize);
+    value_offsets.push_back(0);
+    for (; node; node = node->getGreaterNeighbor()) {
+      if ((!block.empty() && !(block.back() < node->getKey()))
+          || (block.empty() && count > 0 && !(greatest_key < node->getKey()))) {
+        throw std::invalid_argument("PackedFrozenTree requires increasing keys");
+      }
+      block.push_back(node->getKey());
+      for (ValueType const& value : node->getValues()) {
+        values.push_back(value);
+      }
+      value_offsets.push_back(values.size());
+      if (block.size() == BlockSize) {
+        pack(block);
+        block.clear();
+      }
+    }
+    if (!block.empty()) {
+      pack(block);
+    }
+    if (values.size() == count) {
+      // a single value per key, which is found at the position of the key
+      value_offsets.clear();
+    }
+    value_offsets.shrink_to_fit();
+    values.shrink_to_fit();
+    words.shrink_to_fit();
+  }
+
+  /**
+   * Returns the number of values, like Tree::getSize.
+   */
+  inline std::size_t getSize() const {
+    return values.size();
+  }
+
+  inline std::size_t getKeyCount() const {
+    return count;
+  }
+
+  /**
+   * Returns the bytes taken by the keys: the samples, the packed deltas, and
+   * the offset and width of each block.
+   */
+  inline std::size_t getKeyBytes() const {
+    return samples.size() * (sizeof(KeyType) + sizeof(std::uint64_t) + sizeof(std::uint8_t))
+      + words.size() * sizeof(std::uint64_t);
+  }
+
+  inline Values getValues(std::size_t const position) const {
+    return (value_offsets.empty())
+      ? Values(values.data() + position, values.data() + position + 1)
+      : Values(values.data() + value_offsets[position],
+               values.data() + value_offsets[position + 1]);
+  }
+
+  inline Entry getLeast() const {
+    return (count) ? Entry(this, 0, samples[0]) : Entry();
+  }
+
+  inline Entry getGreatest() const {
+    return (count) ? Entry(this, count - 1, greatest_key) : Entry();
+  }
+
+  inline bool containsKey(KeyType const key) const {
+    return static_cast<bool>(find(key));
+  }
+
+  Entry find(KeyType const key) const {
+    Entry const entry = search(key, false);
+    return (entry && entry.getKey() == key) ? entry : Entry();
+  }
+
+  inline Entry findNearestGTE(KeyType const key) const {
+    return search(key, false);
+  }
+
+  inline Entry findNearestGT(KeyType const key) const {
+    return search(key, true);
+  }
+
+  Entry findNearestLTE(KeyType const key) const {
+    Entry const entry = search(key, true);
+    return (entry) ? entry.getLesserNeighbor() : getGreatest();
+  }
+
+  Entry findNearestLT(KeyType const key) const {
+    Entry const entry = search(key, false);
+    return (entry) ? entry.getLesserNeighbor() : getGreatest();
+  }
+
+  auto getRange(KeyType const lower_key, KeyType const upper_key) const {
+    auto iter = new RangeIterator<Entry, KeyType>();
+    if (Entry const entry = findNearestGTE(lower_key)) {
+      iter->setCursor(entry)->setUpperKey(upper_key);
+    }
+    return iter;
+  }
+
+  Entry getGreaterNeighbor(Entry const& entry) const {
+    std::size_t const position = entry.getPosition() + 1;
+    if (position >= count) return Entry();
+    std::size_t const block = position / BlockSize;
+    std::uint32_t const index = position % BlockSize;
+    return (index == 0)
+      ? Entry(this, position, samples[block])
+      : Entry(this, position, add(entry.getKey(), getDelta(block, index)));
+  }
+
+  Entry getLesserNeighbor(Entry const& entry) const {
+    std::size_t const position = entry.getPosition();
+    if (position == 0) return Entry();
+    std::size_t const block = position / BlockSize;
+    std::uint32_t const index = position % BlockSize;
+    return (index == 0)
+      ? Entry(this, position - 1, decode(block - 1, BlockSize - 1))
+      : Entry(this, position - 1, subtract(entry.getKey(), getDelta(block, index)));
+  }
+
+  /**
+   * Verifies that the decoded keys are distinct and increasing, and that the
+   * blocks and values add up.
+   */
+  bool checkInvariants() const {
+    std::size_t position = 0;
+    for (Entry entry = getLeast(); entry; entry = entry.getGreaterNeighbor()) {
+      if (entry.getPosition() != position) return false;
+      if (position > 0 && !(getLesserNeighbor(entry).getKey() < entry.getKey())) return false;
+      position += 1;
+    }
+    return position == count
+      && samples.size() == (count + BlockSize - 1) / BlockSize
+      && (count == 0 || getGreatest().getKey() == decode(samples.size() - 1, (count - 1) % BlockSize))
+      && (value_offsets.empty() ? values.size() == count : value_offsets.back() == values.size());
+  }
+
+private:
+  typedef std::make_unsigned_t<KeyType> Bits;
+
+  /** The first key of each block */
+  std::vector<KeyType> samples;
+
+  /** The bit offset of the deltas of each block, and their width */
+  std::vector<std::uint64_t> block_offsets;
+  std::vector<std::uint8_t> widths;
+
+  std::vector<std::uint64_t> words;
+  std::uint64_t bit_count = 0;
+
+  std::vector<std::size_t> value_offsets;
+  std::vector<ValueType> values;
+
+  std::size_t count = 0;
+  KeyType greatest_key = {};
+
+  static inline KeyType add(KeyType const key, Bits const delta) {
+    return KeyType(Bits(key) + delta);
+  }
+
+  static inline KeyType subtract(KeyType const key, Bits const delta) {
+    return KeyType(Bits(key) - delta);
+  }
+
+  void pack(std::vector<KeyType> const& block) {
+    Bits max_delta = 0;
+    for (std::size_t i = 1; i < block.size(); ++i) {
+      max_delta = std::max(max_delta, Bits(Bits(block[i]) - Bits(block[i - 1])));
+    }
+    unsigned int width = 0;
+    for (std::uint64_t bits = max_delta; bits; bits >>= 1) {
+      width += 1;
+    }
+    samples.push_back(block.front());
+    block_offsets.push_back(bit_count);
+    widths.push_back(std::uint8_t(width));
+    for (std::size_t i = 1; i < block.size(); ++i) {
+      appendBits(Bits(block[i]) - Bits(block[i - 1]), width);
+    }
+    count += block.size();
+    greatest_key = block.back();
+  }
+
+  void appendBits(std::uint64_t const bits, unsigned int const width) {
+    if (width == 0) return;
+    unsigned int const shift = bit_count & 63;
+    if (shift == 0) {
+      words.push_back(0);
+    }
+    words.back() |= bits << shift;
+    if (shift + width > 64) {
+      words.push_back(bits >> (64 - shift));
+    }
+    bit_count += width;
+  }
+
+  /**
+   * Returns the delta of the key at the index of the block (past the first)
+   * to the key before it.
+   */
+  inline Bits getDelta(std::size_t const block, std::uint32_t const index) const {
+    unsigned int const width = widths[block];
+    std::uint64_t const offset = block_offsets[block] + std::uint64_t(index - 1) * width;
+    std::uint64_t const* const word = words.data() + (offset >> 6);
+    unsigned int const shift = offset & 63;
+    std::uint64_t bits = word[0] >> shift;
+    if (shift + width > 64) {
+      bits |= word[1] << (64 - shift);
+    }
+    return Bits((width < 64) ? bits & ((std::uint64_t(1) << width) - 1) : bits);
+  }
+
+  KeyType decode(std::size_t const block, std::uint32_t const index) const {
+    KeyType key = samples[block];
+    for (std::uint32_t i = 1; i <= index; ++i) {
+      key = add(key, getDelta(block, i));
+    }
+    return key;
+  }
+
+  /**
+   * Returns the entry of the first key no less than the given one (or
+   * greater, when strict), if there is one. The samples are searched first,
+   * and only the block before the first sample past the key is decoded.
+   */
+  Entry search(KeyType const key, bool const strict) const {
+    std::uint32_t const sample_count = samples.size();
+    std::uint32_t const next_block = (strict)
+      ? KeySearch<KeyType>::upperBound(samples.data(), sample_count, key)
+      : KeySearch<KeyType>::lowerBound(samples.data(), sample_count, key);
+    if (next_block == 0) return getLeast();
+
+    std::size_t const block = next_block - 1;
+    std::size_t const first = block * BlockSize;
+    std::uint32_t const block_count = std::min<std::size_t>(BlockSize, count - first);
+    KeyType current = samples[block];
+    for (std::uint32_t i = 1; i < block_count; ++i) {
+      current = add(current, getDelta(block, i));
+      if ((strict) ? key < current : !(current < key)) {
+        return Entry(this, first + i, current);
+      }
+    }
+    return (next_block < sample_count)
+      ? Entry(this, first + block_count, samples[next_block])
+      : Entry();
+  }
+};
+
+}
+
+#endif
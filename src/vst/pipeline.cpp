@@ -0,0 +1,5 @@
+#include "pipeline.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
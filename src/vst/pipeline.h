@@ -0,0 +1,157 @@
+#ifndef __VST_PIPELINE_H__
+#define __VST_PIPELINE_H__
+
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace vst {
+
+template <class ElementType, class Source>
+class Pipeline;
+
+template <class ElementType, class Source>
+Pipeline<ElementType, Source> makePipeline(Source source);
+
+/**
+ * Lazy sequence of elements with the operators of Iterator (map, select,
+ * exclude, take, takeWhile, drop, dropWhile, each and to_vector), composed at
+ * compile time instead of at runtime.
+ *
+ * The Source is called with a sink, to which it pushes each element until the
+ * sink returns false. Every operator wraps the source of its pipeline in a
+ * new one, so a whole pipeline is a single type whose stages the compiler
+ * can fuse into one loop, without allocating the stages or calling them
+ * through virtual functions or std::function. Pipelines are values, and each
+ * call to each() or to_vector() runs them from the start.
+ */
+template <class ElementType, class Source>
+class Pipeline {
+public:
+  typedef ElementType element_type;
+
+  explicit Pipeline(Source source)
+    : source(std::move(source)) {
+    // empty constructor
+  }
+
+  template <class Fn>
+  auto map(Fn fn) const {
+    typedef std::decay_t<std::invoke_result_t<Fn const&, ElementType>> MappedType;
+    return makePipeline<MappedType>([source = source, fn](auto&& sink) {
+      source([&](ElementType element) {
+        return sink(fn(element));
+      });
+    });
+  }
+
+  template <class Fn>
+  auto select(Fn fn) const {
+    return makePipeline<ElementType>([source = source, fn](auto&& sink) {
+      source([&](ElementType element) {
+        return !fn(element) || sink(element);
+      });
+    });
+  }
+
+  template <class Fn>
+  auto exclude(Fn fn) const {
+    return makePipeline<ElementType>([source = source, fn](auto&& sink) {
+      source([&](ElementType element) {
+        return fn(element) || sink(element);
+      });
+    });
+  }
+
+  auto take(unsigned int const limit) const {
+    return makePipeline<ElementType>([source = source, limit](auto&& sink) {
+      if (limit == 0) return;
+      unsigned int index = 0;
+      source([&](ElementType element) {
+        return sink(element) && ++index < limit;
+      });
+    });
+  }
+
+  template <class Fn>
+  auto takeWhile(Fn fn) const {
+    return makePipeline<ElementType>([source = source, fn](auto&& sink) {
+      source([&](ElementType element) {
+        return fn(element) && sink(element);
+      });
+    });
+  }
+
+  auto drop(unsigned int const limit) const {
+    return makePipeline<ElementType>([source = source, limit](auto&& sink) {
+      unsigned int index = 0;
+      source([&](ElementType element) {
+        if (index < limit) {
+          index += 1;
+          return true;
+        }
+        return sink(element);
+      });
+    });
+  }
+
+  template <class Fn>
+  auto dropWhile(Fn fn) const {
+    return makePipeline<ElementType>([source = source, fn](auto&& sink) {
+      bool dropping = true;
+      source([&](ElementType element) {
+        if (dropping && fn(element)) return true;
+        dropping = false;
+        return sink(element);
+      });
+    });
+  }
+
+  /**
+   * Calls the function with each element until it returns false, returning
+   * whether it never did.
+   */
+  template <class Fn>
+  bool each(Fn fn) const {
+    bool completed = true;
+    source([&](ElementType element) {
+      if (fn(element)) return true;
+      completed = false;
+      return false;
+    });
+    return completed;
+  }
+
+  std::vector<ElementType> to_vector() const {
+    std::vector<ElementType> vector;
+    source([&](ElementType element) {
+      vector.push_back(element);
+      return true;
+    });
+    return vector;
+  }
+
+private:
+  Source source;
+};
+
+template <class ElementType, class Source>
+inline Pipeline<ElementType, Source> makePipeline(Source source) {
+  return Pipeline<ElementType, Source>(std::move(source));
+}
+
+/**
+ * Pipeline over the nodes of the vine, from the given one to the greatest.
+ */
+template <class NodeType>
+inline auto makeVinePipeline(NodeType* const node) {
+  return makePipeline<NodeType*>([node](auto&& sink) {
+    for (NodeType* iter = node; iter; iter = iter->getGreaterNeighbor()) {
+      if (!sink(iter)) break;
+    }
+  });
+}
+
+}
+
+#endif
@@ -1,25 +1,34 @@
 #ifndef __VST_RANGE_ITERATOR_H__
 #define __VST_RANGE_ITERATOR_H__
 
-#include <functional>
+#include <cstddef>
 
+#include "compare.h"
 #include "iterator.h"
 #include "node.h"
+#include "vine_cursor.h"
 
 namespace vst {
 
-template <class NodeType, class KeyType>
-class RangeIterator : public Iterator<NodeType*> {
+/**
+ * Iterates along the vine from a cursor (see VineCursor), such as a pointer
+ * to a node or an entry of a BlockTree, to the last key no greater than the
+ * upper one.
+ */
+template <class CursorType, class KeyType,
+          class Compare = ThreeWayCompare<KeyType>>
+class RangeIterator : public Iterator<CursorType> {
+  typedef VineCursor<CursorType> Cursor;
+
 public:
-  using Iterator<NodeType*>::Iterator;
+  using Iterator<CursorType>::Iterator;
 
-  inline RangeIterator* setNode(NodeType* const node) {
-    this->node = node;
+  inline RangeIterator* setCursor(CursorType const cursor) {
+    this->cursor = cursor;
     return this;
   }
 
-  inline RangeIterator* setCompare(
-      std::function<int (KeyType, KeyType)> const compare) {
+  inline RangeIterator* setCompare(Compare const& compare) {
     this->compare = compare;
     return this;
   }
@@ -29,21 +38,62 @@ public:
     return this;
   }
 
+  /**
+   * Copies the keys and first values of up to capacity of the next nodes into
+   * the given columns, along with their numbers of values unless value_counts
+   * is null, and returns how many were copied. Calling it repeatedly exports
+   * the range in chunks, each in a single pass along the vine, and the
+   * iterator resumes after the last node copied.
+   */
+  template <class ValueType>
+  std::size_t fetch(
+      KeyType* const keys,
+      ValueType* const values,
+      std::size_t* const value_counts,
+      std::size_t const capacity) {
+    std::size_t count = 0;
+    if (!this->has_advanced && capacity > 0) {
+      copy(this->next_element, keys, values, value_counts, count);
+      this->has_advanced = true;
+      this->next_element = nullptr;
+    }
+    while (count < capacity && cursor
+        && compare(Cursor::get(cursor).getKey(), upper_key) <= 0) {
+      copy(cursor, keys, values, value_counts, count);
+      cursor = Cursor::get(cursor).getGreaterNeighbor();
+    }
+    return count;
+  }
+
 protected:
 
   void advance() {
-    if (this->has_advanced && node) {
-      if (compare(node->getKey(), upper_key) <= 0) {
+    if (this->has_advanced && cursor) {
+      if (compare(Cursor::get(cursor).getKey(), upper_key) <= 0) {
         this->has_advanced = false;
-        this->next_element = node;
-        node = node->getGreaterNeighbor();
+        this->next_element = cursor;
+        cursor = Cursor::get(cursor).getGreaterNeighbor();
       }
     }
   }
 
 private:
-  NodeType* node = nullptr;
-  std::function<int (KeyType, KeyType)> compare = {};
+
+  template <class ValueType>
+  static inline void copy(
+      CursorType const cursor,
+      KeyType* const keys,
+      ValueType* const values,
+      std::size_t* const value_counts,
+      std::size_t& count) {
+    keys[count] = Cursor::get(cursor).getKey();
+    values[count] = Cursor::get(cursor).getValue();
+    if (value_counts) value_counts[count] = Cursor::get(cursor).getValues().size();
+    count += 1;
+  }
+
+  CursorType cursor = {};
+  Compare compare = {};
   KeyType upper_key = {};
 };
 
@@ -0,0 +1,5 @@
+#include "ranked_avl_node.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
@@ -0,0 +1,58 @@
+#ifndef __VST_RANKED_AVL_NODE_H__
+#define __VST_RANKED_AVL_NODE_H__
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "avl_node.h"
+
+namespace vst {
+
+/**
+ * Augmentation of AvlNode that counts the nodes of its subtree, which lets a
+ * tree answer Tree::rank, Tree::select and Tree::countRange in logarithmic
+ * time, at the cost of a word per node and of a walk to the root on every
+ * update.
+ */
+struct SubtreeSize {
+  template <class NodeType>
+  class Mixin {
+  public:
+
+    inline NodeType* setSubtreeSize(std::size_t const subtree_size) {
+      this->subtree_size = subtree_size;
+      return static_cast<NodeType*>(this);
+    }
+
+    inline std::size_t getSubtreeSize() const {
+      return subtree_size;
+    }
+
+  private:
+    std::size_t subtree_size = 1;
+  };
+};
+
+/**
+ * AvlNode that counts its subtree.
+ */
+template <class KeyType, class ValueType,
+          class ValuesType = std::vector<ValueType>>
+using RankedAvlNode = AvlNode<KeyType, ValueType, ValuesType, SubtreeSize>;
+
+/**
+ * Whether the nodes of NodeType count their subtree, like RankedAvlNode.
+ */
+template <class NodeType, class = void>
+struct CountsSubtree : std::false_type {};
+
+template <class NodeType>
+struct CountsSubtree<NodeType,
+    std::void_t<decltype(std::declval<NodeType const&>().getSubtreeSize())>>
+  : std::true_type {};
+
+}
+
+#endif
@@ -0,0 +1,5 @@
+#include "ranked_avl_tree.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
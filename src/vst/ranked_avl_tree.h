@@ -0,0 +1,28 @@
+#ifndef __VST_RANKED_AVL_TREE_H__
+#define __VST_RANKED_AVL_TREE_H__
+
+#include <vector>
+
+#include "avl_tree.h"
+#include "compare.h"
+#include "node_allocator.h"
+#include "ranked_avl_node.h"
+
+namespace vst {
+
+/**
+ * AvlTree whose nodes count their subtrees, for order-statistic queries.
+ */
+template <class KeyType, class ValueType,
+          class ValuesType = std::vector<ValueType>,
+          class Compare = ThreeWayCompare<KeyType>,
+          class Allocator = HeapNodeAllocator<RankedAvlNode<KeyType, ValueType, ValuesType>>>
+using RankedAvlTree = AvlTree<
+  KeyType, ValueType,
+  RankedAvlNode<KeyType, ValueType, ValuesType>,
+  Compare,
+  Allocator>;
+
+}
+
+#endif
@@ -0,0 +1,660 @@
+#ifndef __VST_SHARDED_TREE_H__
+#define __VST_SHARDED_TREE_H__
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "avl_node.h"
+#include "avl_tree.h"
+#include "compare.h"
+#include "distance.h"
+#include "iterator.h"
+#include "key_ranges.h"
+
+namespace vst {
+
+/**
+ * Copy of the key and values of a node of a ShardedTree, which stays valid
+ * once the lock of its shard is released. A default Entry stands for a
+ * missing node.
+ */
+template <class KeyType, class ValueType>
+class ShardedEntry {
+public:
+
+  ShardedEntry() {
+    // empty constructor
+  }
+
+  template <class NodeType>
+  explicit ShardedEntry(NodeType const* const node)
+    : key(node->getKey()),
+      values(node->getValues().begin(), node->getValues().end()) {
+    // empty constructor
+  }
+
+  inline KeyType getKey() const {
+    return key;
+  }
+
+  inline ValueType getValue() const {
+    return values.front();
+  }
+
+  inline std::vector<ValueType> const& getValues() const {
+    return values;
+  }
+
+  inline explicit operator bool() const {
+    return !values.empty();
+  }
+
+private:
+  KeyType key = {};
+  std::vector<ValueType> values;
+};
+
+/**
+ * Iterator over the entries of a ShardedTree. A range is copied out of the
+ * shards CHUNK_SIZE entries at a time, each chunk under the lock of one
+ * shard, and carries on from one shard to the next; the iterator holds no
+ * lock between chunks, but resumes from the last node it copied as long as
+ * its shard has not been written to since.
+ */
+template <class TreeType>
+class ShardedIterator : public Iterator<typename TreeType::Entry> {
+public:
+  typedef typename TreeType::Entry Entry;
+  typedef typename TreeType::KeyType KeyType;
+
+  static constexpr std::size_t CHUNK_SIZE = 64;
+
+  using Iterator<Entry>::Iterator;
+
+  inline ShardedIterator* setTree(TreeType const* const tree) {
+    this->tree = tree;
+    return this;
+  }
+
+  inline ShardedIterator* setLowerKey(KeyType const lower_key) {
+    this->lower_key = lower_key;
+    return this;
+  }
+
+  inline ShardedIterator* setUpperKey(KeyType const upper_key) {
+    this->upper_key = upper_key;
+    return this;
+  }
+
+  /**
+   * Iterates over the given entries rather than a range of the tree.
+   */
+  inline ShardedIterator* setEntries(std::vector<Entry> entries) {
+    this->entries = std::move(entries);
+    this->index = 0;
+    return this;
+  }
+
+protected:
+
+  void advance() {
+    if (this->has_advanced) {
+      if (index == entries.size() && tree) {
+        entries.clear();
+        index = 0;
+        if (tree->copyRange(lower_key, inclusive, upper_key, CHUNK_SIZE, entries, position)) {
+          tree = nullptr;
+        }
+        if (!entries.empty()) {
+          lower_key = entries.back().getKey();
+          inclusive = false;
+        }
+      }
+      if (index < entries.size()) {
+        this->has_advanced = false;
+        this->next_element = std::move(entries[index]);
+        index += 1;
+      }
+    }
+  }
+
+private:
+  TreeType const* tree = nullptr;
+  KeyType lower_key = {};
+  KeyType upper_key = {};
+  bool inclusive = true;
+  typename TreeType::RangePosition position;
+  std::vector<Entry> entries;
+  std::size_t index = 0;
+};
+
+/**
+ * Whether TreeType offers what ShardedTree calls on its shards: node pointers
+ * from its lookups, hinted inserts that return the node, and upsert.
+ */
+template <class TreeType, class KeyType, class ValueType, class = void>
+struct IsShardTree : std::false_type {};
+
+template <class TreeType, class KeyType, class ValueType>
+struct IsShardTree<TreeType, KeyType, ValueType, std::void_t<
+    decltype(std::declval<TreeType const&>().getLeast()->getGreaterNeighbor()),
+    decltype(std::declval<TreeType const&>().getGreatest()->getLesserNeighbor()),
+    decltype(std::declval<TreeType const&>().findNearestGTE(std::declval<KeyType>())->getKey()),
+    decltype(std::declval<TreeType const&>().findNearestLTE(std::declval<KeyType>())->getKey()),
+    decltype(std::declval<TreeType&>().insert(
+      std::declval<KeyType>(), std::declval<ValueType>(),
+      std::declval<TreeType const&>().getLeast())->getKey()),
+    decltype(std::declval<TreeType&>().upsert(
+      std::declval<KeyType>(), std::declval<ValueType>()).second),
+    decltype(std::declval<TreeType&>().remove(
+      std::declval<KeyType>(), std::declval<ValueType>())),
+    decltype(std::declval<TreeType const&>().checkInvariants())>>
+  : std::true_type {};
+
+/**
+ * Tree for several threads, made of independent trees of TreeType (shards)
+ * over consecutive ranges of keys, split at the given keys, each behind its
+ * own reader-writer lock.
+ *
+ * Every call locks the one shard its key falls in, or the shards it walks
+ * across one after the other, so threads only wait for each other on the
+ * same shard, and the shards need no locking of their own. Since no lock
+ * outlives a call, lookups return copies of the nodes they find, and scans
+ * return them a chunk at a time; a scan that spans shards is ordered but is
+ * not a single snapshot.
+ *
+ * The split keys may be chosen from a sample of the expected keys with
+ * sampleSplitKeys, and moved later with rebalance, according to the
+ * operations each shard has seen.
+ *
+ * TreeType must order its keys by the same Compare, and offer the interface
+ * of Tree over linked nodes (see IsShardTree): getLeast and getGreatest,
+ * find, findNearestGTE and findNearestLTE returning node pointers whose
+ * neighbors may be walked, insert with and without a hint, upsert, both
+ * removes, getSize and checkInvariants. AvlTree and its variants qualify;
+ * BlockTree, FrozenTree and ConcurrentAvlTree do not.
+ */
+template <class Key, class ValueType,
+          class Compare = ThreeWayCompare<Key>,
+          class TreeType = AvlTree<Key, ValueType, AvlNode<Key, ValueType>, Compare>>
+class ShardedTree {
+public:
+  typedef Key KeyType;
+  typedef ShardedEntry<KeyType, ValueType> Entry;
+  typedef std::remove_pointer_t<decltype(std::declval<TreeType const&>().getLeast())> NodeType;
+
+  static_assert(IsShardTree<TreeType, KeyType, ValueType>::value,
+    "TreeType must offer the interface of Tree over linked nodes");
+
+  friend class ShardedIterator<ShardedTree>;
+
+  /**
+   * The split keys must be sorted. Shard i holds the keys from split key
+   * i - 1 (inclusive) up to split key i (exclusive).
+   */
+  explicit ShardedTree(std::vector<KeyType> split_keys, Compare compare = Compare())
+    : ranges(std::move(split_keys), compare) {
+    for (std::size_t i = 0; i < ranges.getCount(); ++i) {
+      shards.emplace_back(new Shard(compare));
+    }
+  }
+
+  ShardedTree(ShardedTree const&) = delete;
+  ShardedTree& operator=(ShardedTree const&) = delete;
+
+  ~ShardedTree() {
+    // empty destructor
+  }
+
+  /**
+   * Returns the split keys at the quantiles of the sample that divide it into
+   * the given number of shards.
+   */
+  static std::vector<KeyType> sampleSplitKeys(
+      std::vector<KeyType> sample,
+      std::size_t const shard_count,
+      Compare const& compare = Compare()) {
+    return KeyRanges<KeyType, Compare>::sampleSplitKeys(
+      std::move(sample), shard_count, compare);
+  }
+
+  inline std::size_t getShardCount() const {
+    return shards.size();
+  }
+
+  std::vector<KeyType> getSplitKeys() const {
+    std::shared_lock<std::shared_mutex> const layout_lock(layout_mutex);
+    return ranges.getSplitKeys();
+  }
+
+  std::vector<std::size_t> getShardSizes() const {
+    std::shared_lock<std::shared_mutex> const layout_lock(layout_mutex);
+    std::vector<std::size_t> sizes;
+    for (std::unique_ptr<Shard> const& shard : shards) {
+      std::shared_lock<std::shared_mutex> const lock(shard->mutex);
+      sizes.push_back(shard->tree.getSize());
+    }
+    return sizes;
+  }
+
+  std::size_t getSize() const {
+    std::size_t size = 0;
+    for (std::size_t const shard_size : getShardSizes()) {
+      size += shard_size;
+    }
+    return size;
+  }
+
+  // Writers --------------------------------------------------------------------
+
+  ShardedTree* insert(KeyType const key, ValueType const value) {
+    std::shared_lock<std::shared_mutex> const layout_lock(layout_mutex);
+    Shard& shard = getShard(key);
+    std::unique_lock<std::shared_mutex> const lock(shard.mutex);
+    shard.version += 1;
+    shard.tree.insert(key, value);
+    return this;
+  }
+
+  /**
+   * Replaces all the values of the key with the given one, returning whether
+   * the key is new.
+   */
+  bool upsert(KeyType const key, ValueType const value) {
+    std::shared_lock<std::shared_mutex> const layout_lock(layout_mutex);
+    Shard& shard = getShard(key);
+    std::unique_lock<std::shared_mutex> const lock(shard.mutex);
+    shard.version += 1;
+    return shard.tree.upsert(key, value).second;
+  }
+
+  bool remove(KeyType const key) {
+    std::shared_lock<std::shared_mutex> const layout_lock(layout_mutex);
+    Shard& shard = getShard(key);
+    std::unique_lock<std::shared_mutex> const lock(shard.mutex);
+    shard.version += 1;
+    return shard.tree.remove(key);
+  }
+
+  bool remove(KeyType const key, ValueType const value) {
+    std::shared_lock<std::shared_mutex> const layout_lock(layout_mutex);
+    Shard& shard = getShard(key);
+    std::unique_lock<std::shared_mutex> const lock(shard.mutex);
+    shard.version += 1;
+    return shard.tree.remove(key, value);
+  }
+
+  /**
+   * Moves the split keys so that each shard takes an even share of the
+   * operations counted since the last rebalance, taking those of a shard to
+   * be spread evenly over its keys, and moves the keys that change shards.
+   * Until operations have been counted, the keys are shared out evenly.
+   * Every other call waits meanwhile.
+   */
+  void rebalance() {
+    std::unique_lock<std::shared_mutex> const layout_lock(layout_mutex);
+
+    std::vector<double> weights;
+    double total_weight = 0.0;
+    std::uint64_t total_load = 0;
+    for (std::unique_ptr<Shard> const& shard : shards) {
+      total_load += shard->load.load(std::memory_order_relaxed);
+    }
+    for (std::unique_ptr<Shard> const& shard : shards) {
+      std::size_t key_count = 0;
+      for (NodeType* node = shard->tree.getLeast(); node; node = node->getGreaterNeighbor()) {
+        key_count += 1;
+      }
+      double const weight = (total_load == 0)
+        ? 1.0
+        : double(shard->load.load(std::memory_order_relaxed) + 1) / double(std::max<std::size_t>(key_count, 1));
+      weights.push_back(weight);
+      total_weight += weight * key_count;
+      shard->load.store(0, std::memory_order_relaxed);
+      shard->version += 1;
+    }
+
+    // split key i is the first key after i + 1 shares of the weight
+    std::vector<KeyType> split_keys = ranges.getSplitKeys();
+    double weight = 0.0;
+    std::size_t next = 0;
+    NodeType* last_node = nullptr;
+    for (std::size_t i = 0; i < shards.size() && next < split_keys.size(); ++i) {
+      for (NodeType* node = shards[i]->tree.getLeast();
+           node && next < split_keys.size();
+           node = node->getGreaterNeighbor()) {
+        while (next < split_keys.size()
+               && weight >= total_weight * (next + 1) / shards.size()) {
+          split_keys[next] = node->getKey();
+          next += 1;
+        }
+        weight += weights[i];
+        last_node = node;
+      }
+    }
+    if (!last_node) return;
+    for (; next < split_keys.size(); ++next) {
+      split_keys[next] = last_node->getKey();
+    }
+    ranges.setSplitKeys(std::move(split_keys));
+
+    for (std::size_t i = 0; i < shards.size(); ++i) {
+      moveStrays(i);
+    }
+  }
+
+  /**
+   * Verifies the invariants of every shard, and that its keys lie within its
+   * split keys.
+   */
+  bool checkInvariants() const {
+    std::shared_lock<std::shared_mutex> const layout_lock(layout_mutex);
+    for (std::size_t i = 0; i < shards.size(); ++i) {
+      std::shared_lock<std::shared_mutex> const lock(shards[i]->mutex);
+      TreeType const& tree = shards[i]->tree;
+      if (!tree.checkInvariants()) return false;
+      if (tree.getLeast()
+          && !ranges.contains(i, tree.getLeast()->getKey(), tree.getGreatest()->getKey())) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Readers --------------------------------------------------------------------
+
+  inline bool containsKey(KeyType const key) const {
+    return static_cast<bool>(find(key));
+  }
+
+  Entry find(KeyType const key) const {
+    std::shared_lock<std::shared_mutex> const layout_lock(layout_mutex);
+    Shard& shard = getShard(key);
+    std::shared_lock<std::shared_mutex> const lock(shard.mutex);
+    NodeType* const node = shard.tree.find(key);
+    return (node) ? Entry(node) : Entry();
+  }
+
+  Entry findNearestGTE(KeyType const key) const {
+    std::shared_lock<std::shared_mutex> const layout_lock(layout_mutex);
+    return ranges.findAcross(key, false, [this, key](std::size_t const index) {
+      Shard& shard = countShard(index);
+      std::shared_lock<std::shared_mutex> const lock(shard.mutex);
+      NodeType* const node = shard.tree.findNearestGTE(key);
+      return (node) ? Entry(node) : Entry();
+    });
+  }
+
+  Entry findNearestLTE(KeyType const key) const {
+    std::shared_lock<std::shared_mutex> const layout_lock(layout_mutex);
+    return ranges.findAcross(key, true, [this, key](std::size_t const index) {
+      Shard& shard = countShard(index);
+      std::shared_lock<std::shared_mutex> const lock(shard.mutex);
+      NodeType* const node = shard.tree.findNearestLTE(key);
+      return (node) ? Entry(node) : Entry();
+    });
+  }
+
+  auto getRange(KeyType const lower_key, KeyType const upper_key) const {
+    auto iter = new ShardedIterator<ShardedTree>();
+    iter->setTree(this)->setLowerKey(lower_key)->setUpperKey(upper_key);
+    return iter;
+  }
+
+  /**
+   * Like Tree::getNeighbors, across shards.
+   */
+  auto getNeighbors(
+      KeyType const key,
+      unsigned int const n_less,
+      unsigned int const n_greater) const {
+
+    std::vector<Entry> entries;
+    {
+      std::shared_lock<std::shared_mutex> const layout_lock(layout_mutex);
+      copyNeighbors(key, true, false, std::max(n_less, 1u), entries);
+      std::reverse(entries.begin(), entries.end());
+      Shard& shard = getShard(key);
+      {
+        std::shared_lock<std::shared_mutex> const lock(shard.mutex);
+        if (NodeType* const node = shard.tree.find(key)) {
+          entries.emplace_back(node);
+        }
+      }
+      copyNeighbors(key, false, false, std::max(n_greater, 1u), entries);
+    }
+
+    auto iter = new ShardedIterator<ShardedTree>();
+    iter->setEntries(std::move(entries));
+    return iter;
+  }
+
+  /**
+   * Like Tree::getNearestNeighbors, across shards: the k nearest keys on
+   * either side of the key are copied out, then merged by their distance.
+   */
+  template <class Distance = AbsoluteDifference<KeyType>>
+  auto getNearestNeighbors(
+      KeyType const key,
+      unsigned int const k_neighbors,
+      Distance const& distance = Distance()) const {
+
+    std::vector<Entry> lesser_entries;
+    std::vector<Entry> greater_entries;
+    {
+      std::shared_lock<std::shared_mutex> const layout_lock(layout_mutex);
+      copyNeighbors(key, true, false, k_neighbors, lesser_entries);
+      copyNeighbors(key, false, true, k_neighbors, greater_entries);
+    }
+
+    std::vector<Entry> entries;
+    std::size_t lesser = 0;
+    std::size_t greater = 0;
+    while (entries.size() < k_neighbors
+           && (lesser < lesser_entries.size() || greater < greater_entries.size())) {
+      double const d_lesser = (lesser < lesser_entries.size())
+        ? distance(lesser_entries[lesser].getKey(), key)
+        : INFINITY;
+      double const d_greater = (greater < greater_entries.size())
+        ? distance(greater_entries[greater].getKey(), key)
+        : INFINITY;
+      if (d_lesser < d_greater) {
+        entries.push_back(std::move(lesser_entries[lesser++]));
+      }
+      else {
+        entries.push_back(std::move(greater_entries[greater++]));
+      }
+    }
+
+    auto iter = new ShardedIterator<ShardedTree>();
+    iter->setEntries(std::move(entries));
+    return iter;
+  }
+
+private:
+
+  struct alignas(64) Shard {
+    explicit Shard(Compare const& compare)
+      : tree(compare) {
+      // empty constructor
+    }
+
+    mutable std::shared_mutex mutex;
+    TreeType tree;
+
+    /** The calls that have locked the shard since the last rebalance */
+    std::atomic<std::uint64_t> load{0};
+
+    /** Counts the writes to the tree, under the lock of the shard */
+    std::uint64_t version = 0;
+  };
+
+  /**
+   * Where a range being copied left off: the last node copied, and the shard
+   * and version it was copied from.
+   */
+  struct RangePosition {
+    std::size_t index = 0;
+    NodeType* node = nullptr;
+    std::uint64_t version = 0;
+  };
+
+  /** Guards the split keys, shared by every call but rebalance */
+  mutable std::shared_mutex layout_mutex;
+  KeyRanges<KeyType, Compare> ranges;
+  std::vector<std::unique_ptr<Shard>> shards;
+
+  inline int compare(KeyType const& a, KeyType const& b) const {
+    return ranges.getCompare()(a, b);
+  }
+
+  /**
+   * Returns the shard of the index, counting the call toward its load.
+   */
+  inline Shard& countShard(std::size_t const index) const {
+    Shard& shard = *shards[index];
+    shard.load.fetch_add(1, std::memory_order_relaxed);
+    return shard;
+  }
+
+  /**
+   * Returns the shard that holds the key, counting the call toward its load.
+   * The layout lock must be held.
+   */
+  inline Shard& getShard(KeyType const& key) const {
+    return countShard(ranges.getIndex(key));
+  }
+
+  /**
+   * Appends up to count entries of the keys less than the given one (or
+   * greater, unless lesser), and the key itself when inclusive, nearest
+   * first, walking the shards one at a time. The layout lock must be held.
+   */
+  void copyNeighbors(
+      KeyType const key,
+      bool const lesser,
+      bool const inclusive,
+      std::size_t const count,
+      std::vector<Entry>& entries) const {
+
+    std::size_t const end = entries.size() + count;
+    std::size_t index = ranges.getIndex(key);
+    while (entries.size() < end) {
+      Shard& shard = countShard(index);
+      {
+        std::shared_lock<std::shared_mutex> const lock(shard.mutex);
+        NodeType* node = (lesser)
+          ? shard.tree.findNearestLTE(key)
+          : shard.tree.findNearestGTE(key);
+        if (node && !inclusive && compare(node->getKey(), key) == 0) {
+          node = (lesser) ? node->getLesserNeighbor() : node->getGreaterNeighbor();
+        }
+        while (node && entries.size() < end) {
+          entries.emplace_back(node);
+          node = (lesser) ? node->getLesserNeighbor() : node->getGreaterNeighbor();
+        }
+      }
+      if (lesser) {
+        if (index == 0) break;
+        index -= 1;
+      }
+      else {
+        if (index + 1 == shards.size()) break;
+        index += 1;
+      }
+    }
+  }
+
+  /**
+   * Appends up to count entries of the keys from the lower key (exclusive,
+   * unless inclusive) to the upper one, returning whether the range is done.
+   * The position is where the last call left off, from which the copy
+   * resumes without a search if the shard is unchanged, and is updated.
+   */
+  bool copyRange(
+      KeyType const lower_key,
+      bool const inclusive,
+      KeyType const upper_key,
+      std::size_t const count,
+      std::vector<Entry>& entries,
+      RangePosition& position) const {
+
+    std::shared_lock<std::shared_mutex> const layout_lock(layout_mutex);
+    for (std::size_t index = ranges.getIndex(lower_key); index < shards.size(); ++index) {
+      Shard& shard = countShard(index);
+      std::shared_lock<std::shared_mutex> const lock(shard.mutex);
+      NodeType* node;
+      if (position.node && position.index == index && position.version == shard.version) {
+        node = position.node->getGreaterNeighbor();
+      }
+      else {
+        node = shard.tree.findNearestGTE(lower_key);
+        if (node && !inclusive && compare(node->getKey(), lower_key) == 0) {
+          node = node->getGreaterNeighbor();
+        }
+      }
+      position.node = nullptr;
+      for (; node; node = node->getGreaterNeighbor()) {
+        if (compare(node->getKey(), upper_key) > 0) return true;
+        if (entries.size() == count) return false;
+        entries.emplace_back(node);
+        position.index = index;
+        position.node = node;
+        position.version = shard.version;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * Moves the keys of the shard that lie outside its split keys to the shards
+   * that hold them now, which are those before it for its least keys and
+   * those after it for its greatest ones. The layout lock must be held
+   * exclusively.
+   */
+  void moveStrays(std::size_t const index) {
+    TreeType& tree = shards[index]->tree;
+    std::vector<Entry> strays;
+    for (NodeType* node = tree.getLeast();
+         node && ranges.getIndex(node->getKey()) < index;
+         node = node->getGreaterNeighbor()) {
+      strays.emplace_back(node);
+    }
+    std::size_t const lesser_count = strays.size();
+    for (NodeType* node = tree.getGreatest();
+         node && ranges.getIndex(node->getKey()) > index;
+         node = node->getLesserNeighbor()) {
+      strays.emplace_back(node);
+    }
+    std::reverse(strays.begin() + lesser_count, strays.end());
+
+    // each shard takes its strays in increasing order, so each one is
+    // inserted next to the one before it
+    std::size_t target = index;
+    NodeType* hint = nullptr;
+    for (Entry const& entry : strays) {
+      tree.remove(entry.getKey());
+      std::size_t const next_target = ranges.getIndex(entry.getKey());
+      if (next_target != target) {
+        target = next_target;
+        hint = nullptr;
+      }
+      for (ValueType const& value : entry.getValues()) {
+        hint = shards[target]->tree.insert(entry.getKey(), value, hint);
+      }
+    }
+  }
+};
+
+}
+
+#endif
@@ -1,27 +1,57 @@
 #ifndef __VST_TREE_H__
 #define __VST_TREE_H__
 
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "compare.h"
+#include "distance.h"
+#include "frozen_tree.h"
 #include "nearest_neighbor_iterator.h"
+#include "packed_frozen_tree.h"
+#include "node_allocator.h"
+#include "pipeline.h"
 #include "range_iterator.h"
+#include "vine_iterator.h"
 
 namespace vst {
 
-template <class NodeType, class KeyType, class ValueType>
+/**
+ * The Compare type is called with two keys and returns a negative, zero or
+ * positive int when the first is less than, equal to or greater than the
+ * second. Any callable will do, including a std::function when the order is
+ * only known at runtime, but a functor type lets the compiler inline it into
+ * every descent.
+ */
+template <class NodeType, class KeyType, class ValueType,
+          class Compare = ThreeWayCompare<KeyType>,
+          class Allocator = HeapNodeAllocator<NodeType>>
 class Tree {
 public:
+  typedef VineIterator<NodeType> iterator;
+  typedef std::reverse_iterator<iterator> reverse_iterator;
 
   Tree() {
     // empty constructor
   }
 
+  Tree(Compare compare, Allocator allocator = Allocator())
+    : compare(std::move(compare)),
+      allocator(std::move(allocator)) {
+    // empty constructor
+  }
+
   virtual ~Tree() {
-    delete root;
+    clear();
+    allocator.release();
   }
 
-  inline unsigned int getSize() const {
+  inline std::size_t getSize() const {
     return size;
   }
 
@@ -30,9 +60,7 @@ public:
   }
 
   inline NodeType* getGreatest() const {
-    return (root != nullptr)
-      ? getGreatest(root)
-      : nullptr;
+    return greatest_node;
   }
 
   NodeType* getGreatest(NodeType* node) const {
@@ -43,9 +71,7 @@ public:
   }
 
   inline NodeType* getLeast() const {
-    return (root != nullptr)
-      ? getLeast(root)
-      : nullptr;
+    return least_node;
   }
 
   NodeType* getLeast(NodeType* node) const {
@@ -57,40 +83,124 @@ public:
   }
 
   bool tryInsert(KeyType const key, ValueType const value) {
-    if (root == nullptr) {
-      root = buildNode(key, value);
+    return insertOrGet(key, value).second;
+  }
+
+  auto insert(KeyType const key, ValueType const value) {
+    std::pair<NodeType*, bool> const result = insertOrGet(key, value);
+    if (!result.second) {
+      result.first->addValue(value);
       size += 1;
-      return true;
+      updateValues(result.first);
     }
+    return this;
+  }
 
-    if (!containsKey(key)) {
-      addDescendant(root, buildNode(key, value));
-      size += 1;
-      return true;
+  /**
+   * Returns the node of the key and false if there is one, otherwise inserts
+   * a node with the key and value and returns it with true. The node where
+   * the descent stops is where a new node gets attached, so either way the
+   * tree is only descended once, and the values of the returned node may be
+   * changed in place.
+   *
+   * Without a hint, a key greater than every other one is attached to the
+   * greatest node directly, so that keys inserted in increasing order (e.g.
+   * timestamps) skip the descent.
+   */
+  std::pair<NodeType*, bool> insertOrGet(
+      KeyType const key,
+      ValueType const value,
+      NodeType* const hint = nullptr) {
+    NodeType* const node =
+      (!hint && greatest_node && compare(key, greatest_node->getKey()) > 0)
+        ? greatest_node
+        : findNearest(key, hint);
+    if (node && compare(key, node->getKey()) == 0) {
+      return std::make_pair(node, false);
     }
 
-    return false;
+    NodeType* const descendant = buildNode(key, value);
+    size += 1;
+    if (node) {
+      addDescendant(node, descendant);
+    }
+    else {
+      root = least_node = greatest_node = descendant;
+    }
+    return std::make_pair(descendant, true);
   }
 
-  auto insert(KeyType const key, ValueType const value) {
-    if (root == nullptr) {
-      root = buildNode(key, value);
+  /**
+   * Hinted insert, which returns the node of the key so that it may serve as
+   * the hint of the next insertion.
+   */
+  NodeType* insert(KeyType const key, ValueType const value, NodeType* const hint) {
+    std::pair<NodeType*, bool> const result = insertOrGet(key, value, hint);
+    if (!result.second) {
+      result.first->addValue(value);
+      size += 1;
+      updateValues(result.first);
     }
-    else if (NodeType* const node = find(key)) {
-      node->addValue(value);
+    return result.first;
+  }
+
+  /**
+   * Inserts a key that is expected to be no less than the greatest one, as
+   * when appending to a log ordered by time. Such a key is attached at the
+   * tail of the vine in amortized constant time, and one that arrives slightly
+   * out of order only costs a local search back from the tail.
+   */
+  inline NodeType* append(KeyType const key, ValueType const value) {
+    return insert(key, value, greatest_node);
+  }
+
+  /**
+   * Like insertOrGet, but replaces all the values of an existing node with the
+   * given one.
+   */
+  std::pair<NodeType*, bool> upsert(KeyType const key, ValueType const value) {
+    std::pair<NodeType*, bool> const result = insertOrGet(key, value);
+    if (!result.second) {
+      size -= result.first->getValues().size() - 1;
+      result.first->setValue(value);
+      updateValues(result.first);
     }
-    else {
-      addDescendant(root, buildNode(key, value));
+    return result;
+  }
+
+  /**
+   * Destroys every node by walking the vine from the least one, which takes
+   * linear time and constant stack regardless of the shape of the tree.
+   */
+  void clear() {
+    NodeType* node = getLeast();
+    while (node) {
+      NodeType* const greater_neighbor = node->getGreaterNeighbor();
+      destroyNode(node);
+      node = greater_neighbor;
     }
-    size += 1;
-    return this;
+    root = least_node = greatest_node = nullptr;
+    size = 0;
   }
 
   inline bool containsKey(KeyType const key) const {
     return nullptr != find(key);
   }
 
-  NodeType* find(KeyType const key) const {
+  /**
+   * Each lookup may be given a hint: any node of the tree, typically the
+   * result of a previous lookup. The search then starts from the hint instead
+   * of the root, first walking a few neighbors along the vine, and otherwise
+   * climbing toward the root only until the key is within the subtree before
+   * descending, for a cost logarithmic in the rank distance from the hint.
+   * Hints require nodes with parent links, such as AvlNode.
+   */
+  NodeType* find(KeyType const key, NodeType* const hint = nullptr) const {
+    if (hint) {
+      NodeType* const node = findNearest(key, hint);
+      return (compare(key, node->getKey()) == 0) ? node : nullptr;
+    }
+
     NodeType* node = root;
     while (node) {
       int const comparison = compare(key, node->getKey());
@@ -107,18 +217,60 @@ public:
     return node;
   }
 
-  NodeType* findNearest(KeyType const key) const {
+  /**
+   * Returns the node of the key if there is one, otherwise the node a node
+   * with the key would be attached to.
+   */
+  NodeType* findNearest(KeyType const key, NodeType* const hint = nullptr) const {
+    if (hint) {
+      int const comparison = compare(key, hint->getKey());
+      if (comparison > 0) return findNearestGreater(key, hint);
+      if (comparison < 0) return findNearestLesser(key, hint);
+      return hint;
+    }
+    return descend(root, key);
+  }
+
+  NodeType* findNearestGTE(KeyType const key, NodeType* const hint = nullptr) const {
+    NodeType* node = findNearest(key, hint);
+    while (node && compare(node->getKey(), key) < 0) {
+      node = node->getGreaterNeighbor();
+    }
+    return node;
+  }
+
+  NodeType* findNearestLTE(KeyType const key, NodeType* const hint = nullptr) const {
+    NodeType* node = findNearest(key, hint);
+    while (node && compare(node->getKey(), key) > 0) {
+      node = node->getLesserNeighbor();
+    }
+    return node;
+  }
+
+  /**
+   * Returns the number of keys less than the given one. Like select and
+   * countRange, it counts distinct keys rather than values, and requires
+   * nodes that count their subtree, such as RankedAvlNode.
+   */
+  inline std::size_t rank(KeyType const key) const {
+    return countLesser(key, false);
+  }
+
+  /**
+   * Returns the node of the key of the given rank, counting from 0, or
+   * nullptr if there are not that many keys.
+   */
+  NodeType* select(std::size_t index) const {
     NodeType* node = root;
     while (node) {
-      int const comparison = compare(key, node->getKey());
-      if (comparison > 0) {
-        if (!node->getGreaterChild()) break;
-        node = node->getGreaterChild();
-      }
-      else if (comparison < 0) {
-        if (!node->getLesserChild()) break;
+      std::size_t const lesser_size = getSubtreeSize(node->getLesserChild());
+      if (index < lesser_size) {
         node = node->getLesserChild();
       }
+      else if (index > lesser_size) {
+        index -= lesser_size + 1;
+        node = node->getGreaterChild();
+      }
       else {
         break;
       }
@@ -126,20 +278,71 @@ public:
     return node;
   }
 
-  NodeType* findNearestGTE(KeyType const key) const {
-    NodeType* node = findNearest(key);
-    while (node && compare(node->getKey(), key) < 0) {
-      node = node->getGreaterNeighbor();
-    }
-    return node;
+  /**
+   * Returns the number of keys within [lower_key, upper_key].
+   */
+  std::size_t countRange(KeyType const lower_key, KeyType const upper_key) const {
+    if (compare(lower_key, upper_key) > 0) return 0;
+    return countLesser(upper_key, true) - countLesser(lower_key, false);
   }
 
-  NodeType* findNearestLTE(KeyType const key) const {
-    NodeType* node = findNearest(key);
-    while (node && compare(node->getKey(), key) > 0) {
-      node = node->getLesserNeighbor();
+  /**
+   * Returns the aggregate of the values of every key within [lower_key,
+   * upper_key], in key order, which requires nodes that aggregate their
+   * subtree, such as AggregateAvlNode. The subtrees that lie entirely within
+   * the range contribute their aggregates whole, so only the two paths down
+   * to the bounds are visited.
+   */
+  auto aggregate(KeyType const lower_key, KeyType const upper_key) const {
+    typedef typename NodeType::AggregateType Aggregate;
+    typename Aggregate::value_type result = Aggregate::identity();
+    if (compare(lower_key, upper_key) > 0) return result;
+
+    // the highest node within the range, below which the bounds part ways
+    NodeType* split = root;
+    while (split) {
+      if (compare(upper_key, split->getKey()) < 0) {
+        split = split->getLesserChild();
+      }
+      else if (compare(lower_key, split->getKey()) > 0) {
+        split = split->getGreaterChild();
+      }
+      else {
+        break;
+      }
     }
-    return node;
+    if (!split) return result;
+
+    for (NodeType* node = split->getLesserChild(); node; ) {
+      if (compare(lower_key, node->getKey()) <= 0) {
+        typename Aggregate::value_type suffix = node->getValuesAggregate();
+        if (NodeType* const greater_child = node->getGreaterChild()) {
+          suffix = Aggregate::combine(suffix, greater_child->getAggregate());
+        }
+        result = Aggregate::combine(suffix, result);
+        node = node->getLesserChild();
+      }
+      else {
+        node = node->getGreaterChild();
+      }
+    }
+
+    result = Aggregate::combine(result, split->getValuesAggregate());
+
+    for (NodeType* node = split->getGreaterChild(); node; ) {
+      if (compare(upper_key, node->getKey()) >= 0) {
+        if (NodeType* const lesser_child = node->getLesserChild()) {
+          result = Aggregate::combine(result, lesser_child->getAggregate());
+        }
+        result = Aggregate::combine(result, node->getValuesAggregate());
+        node = node->getGreaterChild();
+      }
+      else {
+        node = node->getLesserChild();
+      }
+    }
+
+    return result;
   }
 
   bool remove(KeyType const key) {
@@ -154,73 +357,205 @@ public:
 
   bool remove(KeyType const key, ValueType const value) {
     if (NodeType* const node = find(key)) {
-      std::vector<ValueType> values = node->getValues();
-      for (auto iter = values.begin(); iter != values.end(); ++iter) {
-        ValueType const candidate = (*iter);
-        if (candidate == value) {
-          values.erase(iter);
-          size -= 1;
-          if (values.size() == 0) {
-            removeNode(node);
-          }
-          return true;
+      if (node->removeValue(value)) {
+        size -= 1;
+        if (node->getValues().empty()) {
+          removeNode(node);
+        }
+        else {
+          updateValues(node);
         }
+        return true;
       }
     }
 
     return false;
   }
 
-  inline void preorder(std::function<void (NodeType*)> const fn) const {
-    preorder(fn, root);
+  /**
+   * Each traversal calls the function with every node of the tree, or of the
+   * subtree of the given node, in its order. The function may return a bool,
+   * in which case the traversal stops at the first false and returns false,
+   * and otherwise it visits every node and returns true. Traversals are
+   * iterative, so their stack does not grow with the height of the tree.
+   */
+  template <class Fn>
+  inline bool preorder(Fn fn) const {
+    return preorder(fn, root);
   }
 
-  void preorder(std::function<void (NodeType*)> const fn, NodeType* const node) const {
-    if (node) {
-      fn(node);
-      preorder(fn, node->getLesserChild());
-      preorder(fn, node->getGreaterChild());
+  template <class Fn>
+  bool preorder(Fn fn, NodeType* const node) const {
+    if (!node) return true;
+    std::vector<NodeType*> stack;
+    stack.reserve(node->getHeight() + 1);
+    stack.push_back(node);
+    while (!stack.empty()) {
+      NodeType* const top = stack.back();
+      stack.pop_back();
+      if (!visit(fn, top)) return false;
+      if (top->getGreaterChild()) stack.push_back(top->getGreaterChild());
+      if (top->getLesserChild()) stack.push_back(top->getLesserChild());
     }
+    return true;
   }
 
-  inline void inorder(std::function<void (NodeType*)> const fn) const {
-    inorder(fn, root);
+  /**
+   * Walks the vine, which needs neither a stack nor a descent per node.
+   */
+  template <class Fn>
+  bool inorder(Fn fn) const {
+    NodeType* node = least_node;
+    while (node) {
+      NodeType* const greater_neighbor = node->getGreaterNeighbor();
+      if (!visit(fn, node)) return false;
+      node = greater_neighbor;
+    }
+    return true;
   }
 
-  void inorder(std::function<void (NodeType*)> const fn, NodeType* const node) const {
-    if (node) {
-      inorder(fn, node->getLesserChild());
-      fn(node);
-      inorder(fn, node->getGreaterChild());
+  template <class Fn>
+  bool inorder(Fn fn, NodeType* node) const {
+    if (!node) return true;
+    NodeType* const greatest = getGreatest(node);
+    node = getLeast(node);
+    while (true) {
+      NodeType* const greater_neighbor = node->getGreaterNeighbor();
+      if (!visit(fn, node)) return false;
+      if (node == greatest) return true;
+      node = greater_neighbor;
     }
   }
 
-  inline void postorder(std::function<void (NodeType*)> const fn) const {
-    postorder(fn, root);
+  template <class Fn>
+  inline bool postorder(Fn fn) const {
+    return postorder(fn, root);
   }
 
-  void postorder(std::function<void (NodeType*)> const fn, NodeType* const node) const {
-    if (node) {
-      postorder(fn, node->getLesserChild());
-      postorder(fn, node->getGreaterChild());
-      fn(node);
+  /**
+   * A node is visited once its greater subtree has been, which is either when
+   * it has no greater child or when that child was the last node visited.
+   */
+  template <class Fn>
+  bool postorder(Fn fn, NodeType* node) const {
+    if (!node) return true;
+    std::vector<NodeType*> stack;
+    stack.reserve(node->getHeight() + 1);
+    NodeType* last = nullptr;
+    while (node || !stack.empty()) {
+      if (node) {
+        stack.push_back(node);
+        node = node->getLesserChild();
+      }
+      else {
+        NodeType* const top = stack.back();
+        NodeType* const greater_child = top->getGreaterChild();
+        if (greater_child && greater_child != last) {
+          node = greater_child;
+        }
+        else {
+          stack.pop_back();
+          if (!visit(fn, top)) return false;
+          last = top;
+        }
+      }
     }
+    return true;
+  }
+
+  /**
+   * The nodes in key order, e.g. for range-for loops and <algorithm>. The keys
+   * within [a, b] lie between lower_bound(a) and upper_bound(b).
+   */
+  inline iterator begin() const {
+    return iterator(least_node, &greatest_node);
+  }
+
+  inline iterator end() const {
+    return iterator(nullptr, &greatest_node);
+  }
+
+  inline reverse_iterator rbegin() const {
+    return reverse_iterator(end());
+  }
+
+  inline reverse_iterator rend() const {
+    return reverse_iterator(begin());
+  }
+
+  /**
+   * Returns an iterator to the node of the least key no less than the given
+   * one, or end() if there is none.
+   */
+  inline iterator lower_bound(KeyType const key) const {
+    return iterator(findNearestGTE(key), &greatest_node);
+  }
+
+  /**
+   * Returns an iterator to the node of the least key greater than the given
+   * one, or end() if there is none.
+   */
+  iterator upper_bound(KeyType const key) const {
+    NodeType* node = findNearest(key);
+    while (node && compare(node->getKey(), key) <= 0) {
+      node = node->getGreaterNeighbor();
+    }
+    return iterator(node, &greatest_node);
+  }
+
+  std::pair<iterator, iterator> equal_range(KeyType const key) const {
+    iterator const lower = lower_bound(key);
+    if (lower != end() && compare(key, lower->getKey()) == 0) {
+      return std::make_pair(lower, std::next(lower));
+    }
+    return std::make_pair(lower, lower);
+  }
+
+  /**
+   * Returns an immutable snapshot of the keys and values, laid out for
+   * read-only queries (see FrozenTree). Later changes to the tree do not
+   * affect it.
+   */
+  FrozenTree<KeyType, ValueType, Compare> freeze() const {
+    return FrozenTree<KeyType, ValueType, Compare>(least_node, compare);
+  }
+
+  /**
+   * Like freeze, but delta-encodes the keys in blocks of BlockSize (see
+   * PackedFrozenTree), which requires integer keys in their natural order.
+   */
+  template <std::uint32_t BlockSize = 64>
+  PackedFrozenTree<KeyType, ValueType, BlockSize> freezePacked() const {
+    static_assert(std::is_same<Compare, ThreeWayCompare<KeyType>>::value,
+      "freezePacked requires keys in their natural order (ThreeWayCompare)");
+    return PackedFrozenTree<KeyType, ValueType, BlockSize>(least_node);
   }
 
   auto getRange(KeyType const lower_key, KeyType const upper_key) const {
-    auto iter = new RangeIterator<NodeType, KeyType>();
+    auto iter = new RangeIterator<NodeType*, KeyType, Compare>();
     if (NodeType* const node = findNearestGTE(lower_key)) {
-      iter->setNode(node)->setCompare(compare)->setUpperKey(upper_key);
+      iter->setCursor(node)->setCompare(compare)->setUpperKey(upper_key);
     }
     return iter;
   }
 
+  /**
+   * Like getRange, but returns a Pipeline, whose stages are fused at compile
+   * time rather than allocated and chained at runtime.
+   */
+  auto getRangePipeline(KeyType const lower_key, KeyType const upper_key) const {
+    return makeVinePipeline(findNearestGTE(lower_key)).takeWhile(
+      [this, upper_key](NodeType* const node) {
+        return compare(node->getKey(), upper_key) <= 0;
+      });
+  }
+
   auto getNeighbors(
       KeyType const key,
       unsigned int const n_less,
       unsigned int const n_greater) const {
 
-    auto iter = new RangeIterator<NodeType, KeyType>();
+    auto iter = new RangeIterator<NodeType*, KeyType, Compare>();
 
     if (NodeType* const node = findNearest(key)) {
       int const comparison = compare(node->getKey(), key);
@@ -255,41 +590,225 @@ public:
         ? greater_neighbor->getKey()
         : node->getKey();
 
-      iter->setNode(least_neighbor)->setCompare(compare)->setUpperKey(upper_key);
+      iter->setCursor(least_neighbor)->setCompare(compare)->setUpperKey(upper_key);
     }
 
     return iter;
   }
 
+  template <class Distance = AbsoluteDifference<KeyType>>
   auto getNearestNeighbors(
       KeyType const key,
       unsigned int const k_neighbors,
-      std::function<double (KeyType, KeyType)> const distance) const {
+      Distance const& distance = Distance()) const {
 
-    auto iter = new NearestNeighborIterator<NodeType, KeyType>();
+    auto iter = new NearestNeighborIterator<NodeType*, KeyType, Distance>();
 
     if (NodeType* const node = findNearest(key)) {
-      iter->setKey(key)->setDistance(distance)->setLimit(k_neighbors)->setNode(node);
+      iter->setKey(key)->setDistance(distance)->setLimit(k_neighbors)->setCursor(node);
     }
 
     return iter;
   }
 
+  /**
+   * Links the descendant into the tree below the ancestor, and removes the
+   * node from the tree, respectively. Implementations change the vine through
+   * linkNeighbors and unlinkNeighbors, which keep its ends up to date for
+   * getLeast, getGreatest, append and clear.
+   */
   virtual void addDescendant(NodeType* ancestor, NodeType* descendant) = 0;
   virtual void removeNode(NodeType* node) = 0;
 
+  /**
+   * Called once the values of a node of the tree have changed in place, for
+   * subclasses that keep state derived from them.
+   */
+  virtual void updateValues(NodeType* node) {
+    // nothing derived from the values
+  }
+
 protected:
-  unsigned int size = 0;
-  std::function<int (KeyType, KeyType)> compare;
+  std::size_t size = 0;
+  Compare compare;
   NodeType* root = nullptr;
+  Allocator allocator;
+
+  /** Ends of the vine, kept up to date by linkNeighbors and unlinkNeighbors */
+  NodeType* least_node = nullptr;
+  NodeType* greatest_node = nullptr;
+
+  /**
+   * Links the node into the vine between its neighbors, either of which is
+   * null at an end of the vine, in which case the node becomes that end. The
+   * links of the node are set before any link to it, for the readers of a
+   * ConcurrentAvlTree.
+   */
+  void linkNeighbors(
+      NodeType* const lesser_neighbor,
+      NodeType* const node,
+      NodeType* const greater_neighbor) {
+    node->setLesserNeighbor(lesser_neighbor);
+    node->setGreaterNeighbor(greater_neighbor);
+    if (lesser_neighbor) {
+      lesser_neighbor->setGreaterNeighbor(node);
+    }
+    else {
+      least_node = node;
+    }
+    if (greater_neighbor) {
+      greater_neighbor->setLesserNeighbor(node);
+    }
+    else {
+      greatest_node = node;
+    }
+  }
 
-private:
+  /**
+   * Unlinks the node from the vine, whose ends pass to its neighbors, but
+   * leaves the links of the node itself for readers still walking from it.
+   */
+  void unlinkNeighbors(NodeType* const node) {
+    NodeType* const lesser_neighbor = node->getLesserNeighbor();
+    NodeType* const greater_neighbor = node->getGreaterNeighbor();
+    if (lesser_neighbor) {
+      lesser_neighbor->setGreaterNeighbor(greater_neighbor);
+    }
+    else {
+      least_node = greater_neighbor;
+    }
+    if (greater_neighbor) {
+      greater_neighbor->setLesserNeighbor(lesser_neighbor);
+    }
+    else {
+      greatest_node = lesser_neighbor;
+    }
+  }
+
+  /** Neighbors a hinted search walks along the vine before climbing */
+  static constexpr int LOCAL_SEARCH_LIMIT = 8;
+
+  /**
+   * Releases a node that has already been unlinked from the tree and the vine.
+   */
+  inline void destroyNode(NodeType* const node) {
+    allocator.deallocate(node);
+  }
 
   NodeType* buildNode(KeyType const key, ValueType const value) {
-    NodeType* node = new NodeType();
+    NodeType* node = allocator.allocate();
     node->setKey(key)->addValue(value);
     return node;
   }
+
+private:
+
+  template <class Fn>
+  static inline bool visit(Fn& fn, NodeType* const node) {
+    if constexpr (std::is_void_v<std::invoke_result_t<Fn&, NodeType*>>) {
+      fn(node);
+      return true;
+    }
+    else {
+      return fn(node);
+    }
+  }
+
+  static inline std::size_t getSubtreeSize(NodeType* const node) {
+    return (node) ? node->getSubtreeSize() : 0;
+  }
+
+  /**
+   * Counts the keys less than the given one, or no greater than it when
+   * inclusive, adding up the subtrees left behind on the way down.
+   */
+  std::size_t countLesser(KeyType const key, bool const inclusive) const {
+    std::size_t count = 0;
+    NodeType* node = root;
+    while (node) {
+      int const comparison = compare(key, node->getKey());
+      if (comparison > 0) {
+        count += getSubtreeSize(node->getLesserChild()) + 1;
+        node = node->getGreaterChild();
+      }
+      else if (comparison < 0) {
+        node = node->getLesserChild();
+      }
+      else {
+        count += getSubtreeSize(node->getLesserChild()) + ((inclusive) ? 1 : 0);
+        break;
+      }
+    }
+    return count;
+  }
+
+  NodeType* descend(NodeType* node, KeyType const key) const {
+    while (node) {
+      int const comparison = compare(key, node->getKey());
+      if (comparison > 0) {
+        if (!node->getGreaterChild()) break;
+        node = node->getGreaterChild();
+      }
+      else if (comparison < 0) {
+        if (!node->getLesserChild()) break;
+        node = node->getLesserChild();
+      }
+      else {
+        break;
+      }
+    }
+    return node;
+  }
+
+  /**
+   * Finds the nearest node of a key greater than that of the node. Between
+   * two neighbors, one always has a free child on the side facing the other,
+   * which is where a descent from the root would have stopped.
+   */
+  NodeType* findNearestGreater(KeyType const key, NodeType* node) const {
+    for (int steps = 0; steps < LOCAL_SEARCH_LIMIT; ++steps) {
+      NodeType* const greater_neighbor = node->getGreaterNeighbor();
+      if (!greater_neighbor) return node;
+      int const comparison = compare(key, greater_neighbor->getKey());
+      if (comparison == 0) return greater_neighbor;
+      if (comparison < 0) {
+        return (node->getGreaterChild()) ? greater_neighbor : node;
+      }
+      node = greater_neighbor;
+    }
+
+    // The subtree of a lesser child holds every key between its least node
+    // and its parent, so the key is within the first such subtree whose
+    // parent is greater than the key.
+    while (NodeType* const parent = node->getParent()) {
+      if (node == parent->getLesserChild() && compare(key, parent->getKey()) < 0) {
+        break;
+      }
+      node = parent;
+    }
+    return descend(node, key);
+  }
+
+  NodeType* findNearestLesser(KeyType const key, NodeType* node) const {
+    for (int steps = 0; steps < LOCAL_SEARCH_LIMIT; ++steps) {
+      NodeType* const lesser_neighbor = node->getLesserNeighbor();
+      if (!lesser_neighbor) return node;
+      int const comparison = compare(key, lesser_neighbor->getKey());
+      if (comparison == 0) return lesser_neighbor;
+      if (comparison > 0) {
+        return (node->getLesserChild()) ? lesser_neighbor : node;
+      }
+      node = lesser_neighbor;
+    }
+
+    while (NodeType* const parent = node->getParent()) {
+      if (node == parent->getGreaterChild() && compare(key, parent->getKey()) > 0) {
+        break;
+      }
+      node = parent;
+    }
+    return descend(node, key);
+  }
 };
 
 }
@@ -0,0 +1,5 @@
+#include "vine_cursor.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
@@ -0,0 +1,29 @@
+#ifndef __VST_VINE_CURSOR_H__
+#define __VST_VINE_CURSOR_H__
+
+namespace vst {
+
+/**
+ * A position along the vine, from which RangeIterator and
+ * NearestNeighborIterator read keys and step to neighbors: a pointer to a
+ * node, or a value that behaves like one, such as the entries of a BlockTree
+ * or a FrozenTree. Either converts to false past the ends of the vine, and
+ * VineCursor::get returns what its members are called on.
+ */
+template <class CursorType>
+struct VineCursor {
+  static inline CursorType const& get(CursorType const& cursor) {
+    return cursor;
+  }
+};
+
+template <class NodeType>
+struct VineCursor<NodeType*> {
+  static inline NodeType& get(NodeType* const node) {
+    return *node;
+  }
+};
+
+}
+
+#endif
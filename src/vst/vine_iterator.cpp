@@ -0,0 +1,5 @@
+#include "vine_iterator.h"
+
+// -----------------------------------------------------------------------------
+// Look in the header for the definition ...
+// -----------------------------------------------------------------------------
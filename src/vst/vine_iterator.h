@@ -0,0 +1,86 @@
+#ifndef __VST_VINE_ITERATOR_H__
+#define __VST_VINE_ITERATOR_H__
+
+#include <cstddef>
+#include <iterator>
+
+namespace vst {
+
+/**
+ * STL bidirectional iterator over the nodes of a tree in key order, which
+ * simply follows the vine. Unlike RangeIterator, it is a plain value that
+ * needs neither a heap allocation nor virtual calls.
+ *
+ * The end iterator holds no node, but keeps the address of the greatest node
+ * of its tree so that it can be decremented. Iterators stay valid until the
+ * node they refer to is removed.
+ */
+template <class NodeType>
+class VineIterator {
+public:
+  typedef std::bidirectional_iterator_tag iterator_category;
+  typedef NodeType value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef NodeType* pointer;
+  typedef NodeType& reference;
+
+  VineIterator() {
+    // empty constructor
+  }
+
+  VineIterator(NodeType* const node, NodeType* const* const greatest)
+    : node(node),
+      greatest(greatest) {
+    // empty constructor
+  }
+
+  inline NodeType* getNode() const {
+    return node;
+  }
+
+  inline reference operator*() const {
+    return *node;
+  }
+
+  inline pointer operator->() const {
+    return node;
+  }
+
+  inline VineIterator& operator++() {
+    node = node->getGreaterNeighbor();
+    return *this;
+  }
+
+  inline VineIterator operator++(int) {
+    VineIterator const iter = *this;
+    ++*this;
+    return iter;
+  }
+
+  inline VineIterator& operator--() {
+    node = (node) ? node->getLesserNeighbor() : *greatest;
+    return *this;
+  }
+
+  inline VineIterator operator--(int) {
+    VineIterator const iter = *this;
+    --*this;
+    return iter;
+  }
+
+  inline bool operator==(VineIterator const& other) const {
+    return node == other.node;
+  }
+
+  inline bool operator!=(VineIterator const& other) const {
+    return node != other.node;
+  }
+
+private:
+  NodeType* node = nullptr;
+  NodeType* const* greatest = nullptr;
+};
+
+}
+
+#endif